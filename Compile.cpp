@@ -26,6 +26,8 @@
 #include "Network/HTKAcousticModel.h"
 #include "Network/Dictionary.h"
 #include "Network/FSTAssembly.h"
+#include "Network/GaussianSelection.h"
+#include "Data/DataReader.h"
 
 using namespace Ear;
 
@@ -35,12 +37,24 @@ int main(int argc, char* argv[])
 	CDictionary dict;
 	CFSTAssembly fst;
 	int ret = 0;
+	unsigned int type = EAR_AM_FLOAT;
 
-	char f[PATH_MAX], i[PATH_MAX], o[PATH_MAX], b[PATH_MAX], d[PATH_MAX];
+	char f[PATH_MAX], i[PATH_MAX], o[PATH_MAX], b[PATH_MAX], d[PATH_MAX], g[PATH_MAX];
 
-	if(argc < 4)
+	//the quantization of the model is the first option, the rest of the arguments are shifted
+	if(argc > 2 && strcmp(argv[1], "-q") == 0)
+	{
+		if(strcmp(argv[2], "int8") == 0) type = EAR_AM_INT8;
+		else if(strcmp(argv[2], "fp16") == 0) type = EAR_AM_FP16;
+		else { fprintf(stderr, "Unknown quantization %s\n", argv[2]); return 1; }
+		argv[2] = argv[0]; argv += 2; argc -= 2;
+	}
+
+	if(argc < 4 || argc == 5)
     {
-        printf("Usage: %s <htk model file> <dictionary> <output name prefix>", argv[0]);
+        printf("Usage: %s [-q int8|fp16] <htk model file> <dictionary> <output name prefix> [<codewords> <shortlist> [<strip offset>]]\n", argv[0]);
+        printf("\t -q stores the means and variances of the model quantized to 8 bit integers or 16 bit floats\n");
+        printf("\t the optional arguments build the Gaussian selection of the model\n");
         return 1;
     }
 
@@ -61,9 +75,28 @@ int main(int argc, char* argv[])
 	ret = fst.writeFST(f, i, o);
 	if(ret == EAR_FAIL){ fprintf(stderr, "Error writing output transducer\n"); return 1; }
 
-	ret = fst.writeBin(b, d);
+	ret = fst.writeBin(b, d, type);
 	if(ret == EAR_FAIL){ fprintf(stderr, "Error writing output binary model\n"); return 1; }
 
+	//Gaussian selection is built from the written binary model, so it is indexed the same way as at runtime
+	if(argc >= 6)
+	{
+		CDataHolder res;
+		CGaussianSelection gs;
+
+		strcpy(g, argv[3]);	strcat(g, ".gs");
+
+		ret = res.load(b, d);
+		if(ret == EAR_SUCCESS) ret = res.dequantize();
+		if(ret == EAR_FAIL){ fprintf(stderr, "Error reading output binary model\n"); return 1; }
+
+		ret = gs.build(res.getAcousticData(), atoi(argv[4]), atoi(argv[5]), argc >= 7 ? atoi(argv[6]) : 0);
+		if(ret == EAR_FAIL){ fprintf(stderr, "Error building Gaussian selection\n"); return 1; }
+
+		ret = gs.write(g);
+		if(ret == EAR_FAIL){ fprintf(stderr, "Error writing Gaussian selection\n"); return 1; }
+	}
+
 	return 0;
 		
 }
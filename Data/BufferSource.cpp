@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BufferSource.h"
+
+using namespace Ear;
+
+CBufferSource::CBufferSource(unsigned int _iReadLength) : ADataProcessor()
+{
+    m_pfBuf = NULL;
+    m_iSize = 0;
+    m_iRead = 0;
+    m_iFreq = 0;
+    m_iReadLength = _iReadLength;
+}
+
+CBufferSource::~CBufferSource()
+{
+
+}
+
+void CBufferSource::setBuffer(float *_pfData, unsigned int _iSize, unsigned int _iFreq)
+{
+    m_pfBuf = _pfData;
+    m_iSize = _iSize;
+    m_iFreq = _iFreq;
+    m_iRead = 0;
+}
+
+unsigned int CBufferSource::seek(uint64_t _iSample)
+{
+    if(_iSample > m_iSize) return EAR_FAIL;
+
+    m_iRead = (unsigned int)_iSample;
+    return EAR_SUCCESS;
+}
+
+void CBufferSource::getData(CDataContainer &_pData)
+{
+    /// compute available data
+    unsigned int iAvail = m_iSize - m_iRead;
+    if(iAvail == 0) { _pData.clear(); return; }
+
+    /// copy at most the read length
+    if(iAvail > m_iReadLength){ iAvail = m_iReadLength; }
+    _pData.copy(m_pfBuf + m_iRead, iAvail);
+    _pData.freq() = m_iFreq;
+
+    m_iRead += iAvail;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+ /**
+ * This file contains source serving data that are already present in the memory.
+ */
+
+#ifndef __EAR_BUFFERSOURCE_H_
+#define __EAR_BUFFERSOURCE_H_
+
+#include "Data.h"
+
+namespace Ear
+{
+  /**
+  * The BufferSource is serving data from an array in the memory, in the pieces of specified length.
+  * It is used when the data were already read (for example the whole recording or the computed features)
+  * and need to enter the preprocessing chain again. The array is not copied, it needs to exist while reading.
+  */
+	class CBufferSource : public ADataProcessor
+	{
+	public:
+    /// Initialize the source
+    /// @param [in] _iReadLength length of the data to read in one function call (request)
+		CBufferSource(unsigned int _iReadLength);
+		virtual ~CBufferSource();
+
+	private:
+		float *m_pfBuf; ///< array of the data served
+		unsigned int m_iSize, m_iRead; ///< size of the array and the read cursor
+		unsigned int m_iReadLength, m_iFreq; ///< length of the data to read in one go and the sampling frequency of the data
+
+	public:
+    /// Set the array to read from, the read cursor is moved to the beginning.
+    /// @param [in] _pfData array of the data
+    /// @param [in] _iSize size of the array
+    /// @param [in] _iFreq sampling frequency of the data to pass to the output containers
+		void setBuffer(float *_pfData, unsigned int _iSize, unsigned int _iFreq);
+    /// Getting new data from the array
+    /// @param [in, out] _pData Container to fill with the new data, empty at the end of the array
+		void getData(CDataContainer &_pData);
+    /// Continue the reading from the position in the array
+    /// @param [in] _iSample position in the array
+    /// @return EAR_FAIL if the array is shorter
+		unsigned int seek(uint64_t _iSample);
+	};
+}
+
+#endif
@@ -59,6 +59,11 @@ unsigned int CConfig::load(const char *szFileName)
     return EAR_SUCCESS;
 }
 
+void CConfig::set(const char *szPropertyName, const char *szValue)
+{
+    m_mapConfig[szPropertyName] = szValue;
+}
+
 void CConfig::print()
 {
     map<string, string>::iterator it;
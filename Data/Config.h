@@ -108,6 +108,12 @@ class CConfig
     */
     unsigned int load(const char *szFileName);
     /**
+    * Sets the property, the value of the property read from the file is replaced
+    * @params [in] szPropertyName name of the property
+    * @params [in] szValue value of the property
+    */
+    void set(const char *szPropertyName, const char *szValue);
+    /**
     * Prints the configuration set by the config file to standard output
     */
     void print();
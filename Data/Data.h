@@ -35,7 +35,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <limits.h>
+#include <stdint.h>
 #include <list>
+#include <new>
 
 /// defining PI for easy use in computations later
 #define EAR_PI		3.14159265358979
@@ -57,6 +59,23 @@
 /// generally define none as maximum integer number
 #define NONE UINT_MAX
 
+/// alignment of the data arrays in bytes (enough for 256 bit vector instructions)
+#define EAR_ALIGN 32
+
+/// storage of the variances and means in the binary model, the type is kept in the upper bits of the vector size
+#define EAR_AM_FLOAT	0x0000	///< 32 bit floats
+#define EAR_AM_INT8	0x4000	///< 8 bit indexes into the table of 256 values of each coefficient
+#define EAR_AM_FP16	0x8000	///< 16 bit floats, the precisions are scaled for each coefficient
+/// number of the values in the table of one coefficient of the EAR_AM_INT8 model
+#define EAR_AM_LEVELS	256
+#define EAR_AM_QUANT	0xC000	///< mask of the storage type
+
+/// activation functions of the layers of the neural network
+#define EAR_MLP_LINEAR	0	///< no activation, the last layer is always linear followed by the log softmax
+#define EAR_MLP_RELU	1	///< max(0, x)
+#define EAR_MLP_SIGMOID	2	///< 1 / (1 + exp(-x))
+#define EAR_MLP_TANH	3	///< hyperbolic tangent
+
 /// success constant definition used as return value from funtions
 #define EAR_SUCCESS	1
 /// fail constant definition used as return value from functions
@@ -64,6 +83,8 @@
 
 namespace Ear
 {
+	class CSnapshot;
+
   /**
   * defining the structure of the multidimensional Gauss Probability Density function
   * for the acoustic model
@@ -76,6 +97,35 @@ namespace Ear
       float           fWeight;  ///< weight of the PDF among others PDF for the same state in the model
   }EAR_AM_Pdf;
 
+  /**
+  * defining the Gaussian selection for the acoustic model. The feature space is divided into cells by the codewords
+  * (vector quantization) and for each codeword and state there is a shortlist of the PDFs that are worth scoring
+  * for the feature vectors from the cell of the codeword.
+  */
+  typedef struct
+  {
+     unsigned int    iCodewords;  ///< number of the codewords
+     unsigned int    iOffset;     ///< first coefficient of the feature vector used for the quantization
+     unsigned int    iDim;        ///< number of the coefficients of the codewords
+     unsigned int    iShortlist;  ///< maximum length of the shortlists
+     float           *fWeight;    ///< weights of the coefficients in the distance from the codewords
+     float           *fCodebook;  ///< codewords one after another (iCodewords * iDim)
+     unsigned int    *Shortlists; ///< PDF indexes (from one, NONE for unused) for each codeword and state (iCodewords * number of states * iShortlist)
+  }EAR_AM_Selection;
+
+  /// quantized PDFs as they were stored in the binary model. The scorer uses them directly, the PDFs have no float values
+  /// unless they are dequantized (see CDataHolder::dequantize). The variance and mean are stored as the precision s = sqrt(0.5 * ivar) and the
+  /// scaled mean b = mean * s, the score is then constant - sum((x * s - b)^2). Both have similar range for all PDFs
+  /// unlike the variance, which can span many orders of magnitude.
+  typedef struct
+  {
+     unsigned int    iType;       ///< storage type, EAR_AM_INT8 or EAR_AM_FP16
+     unsigned int    iStride;     ///< number of the values of one PDF, the precisions followed by the scaled means (2 * vector size)
+     float           *fTable;     ///< EAR_AM_INT8 only, EAR_AM_LEVELS values for each position of the row (value = fTable[position * EAR_AM_LEVELS + q])
+     float           *fScale;     ///< EAR_AM_FP16 only, scale of the precision of each coefficient (s = fScale[coefficient] * h)
+     void            *pData;      ///< quantized values, uint8_t or half float (uint16_t) rows of iStride values for each PDF
+  }EAR_AM_Quant;
+
   /// defining top structure of the acoustic model. We do not need the names of the models here, because the FST
   /// refers to the states on its transitions by number in the <i>States</i> array.
 	typedef struct
@@ -86,8 +136,31 @@ namespace Ear
      unsigned int    iPdfsOnState;   ///< number of PDFs on one state
      unsigned int    **States;       ///< array of the PDF indexes for each state in acoustic model
      EAR_AM_Pdf      *Pdfs;          ///< array of all PDFs in the acoustic model
+     EAR_AM_Selection *Selection;    ///< Gaussian selection for the model, NULL if not used
+     EAR_AM_Quant     *Quant;        ///< quantized PDFs, NULL if the model is stored in floats
   }EAR_AM_Info;
 
+  /// one fully connected layer of the neural network, output = activation(weights * input + bias)
+  typedef struct
+  {
+     unsigned int    iIn;         ///< number of the inputs
+     unsigned int    iOut;        ///< number of the outputs
+     unsigned int    iActivation; ///< activation function (EAR_MLP_*)
+     float           *fWeight;    ///< weights, a row of iIn values for each output
+     float           *fBias;      ///< bias of each output
+  }EAR_MLP_Layer;
+
+  /// feed-forward neural network computing the posterior probabilities of the states of the acoustic model. The outputs
+  /// are indexed in the same way as the states, so the network refers to them by the same input symbols.
+  typedef struct
+  {
+     unsigned int    iVectorSize; ///< size of one feature vector
+     unsigned int    iContext;    ///< number of the previous feature vectors spliced before the current one at the input
+     unsigned int    iLayers;     ///< number of the layers
+     EAR_MLP_Layer   *Layers;     ///< layers from the input one
+     float           *fPrior;     ///< logarithm of the prior probability of each output (state)
+  }EAR_MLP;
+
   /**
   * defining transition structure for the finite state transducer (search network)
   * the transition are store typicaly in an array, thus the indexes for start and end state
@@ -116,6 +189,22 @@ namespace Ear
     unsigned int    iSize;        ///< size of the dictionary
   }EAR_Dict;
 
+  /// defining the settings of one acoustic event, its insertion penalty and the thresholds of its detections
+  typedef struct
+  {
+    bool            bPenalty;     ///< the event has its own insertion penalty
+    float           fPenalty;     ///< insertion penalty of the event
+    float           fMinScore;    ///< the lowest mean score of the detection per feature vector
+    float           fMinDur_ms;   ///< the shortest duration of the detection in milliseconds
+  }EAR_Event;
+
+  /// defining the settings of the events, indexed by the output symbols as the dictionary
+  typedef struct
+  {
+    EAR_Event       *pEvents;     ///< array of the settings
+    unsigned int    iSize;        ///< size of the array, the same as the size of the dictionary
+  }EAR_Events;
+
   /**
   * Class for holding the feature vector for the whole time when it passes through preprocessing.
   * Contains convenient functions for appending, prepending, copying data to another container
@@ -125,12 +214,21 @@ namespace Ear
 	{
 	public:
     /// constructor, all set to default values
-		CDataContainer(){iSize = 0; iCap = 0; pfData = NULL;}
+		CDataContainer(){iSize = 0; iCap = 0; iFreq = 0; pfData = NULL;}
+    /// copy constructor, copies the data content of the other container
+		CDataContainer(const CDataContainer &_o){iSize = 0; iCap = 0; iFreq = 0; pfData = NULL; copy((CDataContainer*)&_o);}
+    /// move constructor, takes over the inner array of the other container
+		CDataContainer(CDataContainer &&_o){pfData = _o.pfData; iSize = _o.iSize; iCap = _o.iCap; iFreq = _o.iFreq; _o.pfData = NULL; _o.iSize = 0; _o.iCap = 0;}
     /// destructor, desctruct inner array that holds the data
-		virtual ~CDataContainer(){ if(pfData) delete[] pfData; }
+		virtual ~CDataContainer(){ if(pfData) free(pfData); }
+
+    /// copy assignment, copies the data content of the other container
+		CDataContainer &operator=(const CDataContainer &_o){if(this != &_o) copy((CDataContainer*)&_o); return *this;}
+    /// move assignment, exchanges the inner arrays, so the old array of this container is released with the other one
+		CDataContainer &operator=(CDataContainer &&_o){swap(_o); return *this;}
 
 	private:
-		float *pfData;			  ///< array holding data, the array is dynamically reallocated if needed
+		float *pfData;			  ///< array holding data (aligned to EAR_ALIGN), the array is dynamically reallocated if needed
 		unsigned int iSize;		///< size of the data in the array
 		unsigned int iCap;		///< size of the data that the array can hold
 		unsigned int iFreq;		///< sampling frequency of the data in the container
@@ -147,9 +245,13 @@ namespace Ear
     /// @return reference to the number on the index position
 		inline float &get(const unsigned int _i){ return pfData[_i]; }
     /// Clears the content of the container. The function does not deallocate the inner array
-    /// but writes zeroes the array memory and sets size of the data content to zero
-		void clear() {
-			if(pfData) memset(pfData, 0, iCap * sizeof(float)); iSize = 0;
+    /// nor touches its memory, it only sets size of the data content to zero
+		void clear() { iSize = 0; }
+    /// Writes zeroes to the content of the container from the specified position to its size. Use this
+    /// where the computation needs zeroes, as no other function is zeroing the memory.
+    /// @param [in] _iStart first position to zero
+		void zero(unsigned int _iStart = 0) {
+			if(_iStart < iSize) memset(pfData + _iStart, 0, (iSize - _iStart) * sizeof(float));
 		}
     /// reserves space for the data. The function reallocates the inner array if needed and copy old data
     /// to new array. This does not change the size of the content in the container only its capacity
@@ -157,10 +259,17 @@ namespace Ear
 		void reserve(unsigned int _iSize){
       /// reallocate if the new size is larger than the available capacity
 			if(_iSize > iCap) allocate(_iSize);
-			else {
-        /// capacity is sufficient, just zero the remaining part
-				if(_iSize > iSize) memset(pfData + iSize, 0, (_iSize - iSize) * sizeof(float));
-			}
+		}
+    /// Reserves the space and sets the size of the content. The new part of the content is not initialized.
+    /// @param [in] _iSize new size of the content
+		void resize(unsigned int _iSize){ reserve(_iSize); iSize = _iSize; }
+    /// Exchanges the content of the two containers without copying the data
+    /// @param [in, out] _o the other container
+		void swap(CDataContainer &_o){
+			float *p = pfData; pfData = _o.pfData; _o.pfData = p;
+			unsigned int i = iSize; iSize = _o.iSize; _o.iSize = i;
+			i = iCap; iCap = _o.iCap; _o.iCap = i;
+			i = iFreq; iFreq = _o.iFreq; _o.iFreq = i;
 		}
     /// Function to manually manipulate size of the data in the container
     /// @return reference to the size member variable to change
@@ -219,17 +328,26 @@ namespace Ear
 
 	private:
     /// Function for allocating the inner array of the container. The function copies old data if there
-    /// were any in the container and also zeroes the remaining allocated.
+    /// were any in the container, the remaining part is not initialized. The capacity is rounded up
+    /// to whole blocks of the alignment, so the vector instructions can process the array in whole blocks.
+    /// The capacity grows at least twice, so the appending is not reallocating on each call.
+    /// Throws std::bad_alloc if the memory can not be allocated, the same as the allocation by new.
     /// @param [in] _iSize size of the new inner array (not the data size)
 		void allocate(unsigned int _iSize){
 			float *p = pfData;
-			pfData = new float[_iSize];
+			void *q = NULL;
+			const unsigned int iBlock = EAR_ALIGN / sizeof(float);
+
+			if(iCap && _iSize < 2 * iCap) _iSize = 2 * iCap;
+			_iSize = (_iSize + iBlock - 1) / iBlock * iBlock;
+			if(posix_memalign(&q, EAR_ALIGN, _iSize * sizeof(float))) throw std::bad_alloc();
+
+			pfData = (float*)q;
 			iCap = _iSize;
-			memset(pfData, 0.0, iCap * sizeof(float));
 			if(p && iSize){
 				memcpy(pfData,p,sizeof(float)*iSize);
 			}
-			if(p) delete[] p;
+			if(p) free(p);
 		}
 
     /// Copy function implementation used by every add or copy public functions that are taking another container.
@@ -245,8 +363,8 @@ namespace Ear
 			if(_bAppend) {
 				reserve(iSize + _iLength);
 			} else {
-				reserve(_iLength);
 				clear();
+				reserve(_iLength);
 			}
 
     	memcpy(pfData + iSize, _p->pfData + _iStart, _iLength * sizeof(float));
@@ -283,6 +401,20 @@ namespace Ear
     /// Returns previous processor instance that is serving as the source of new data for the current processor
     /// @return pointer to the previous processor.
 		virtual ADataProcessor* getSource(){return m_pPrev;}
+    /// Write the state kept by the processor between the calls of <i>getData</i> (the buffered data) to the snapshot.
+    /// The processors without such state do not need to implement it.
+    /// @param [in, out] _snap the snapshot
+    /// @return EAR_FAIL if the state can not be saved
+		virtual unsigned int save(CSnapshot &_snap){return EAR_SUCCESS;}
+    /// Read the state written by <i>save</i> of the same processor
+    /// @param [in, out] _snap the snapshot
+    /// @return EAR_FAIL if the snapshot does not match the processor
+		virtual unsigned int restore(CSnapshot &_snap){return EAR_SUCCESS;}
+    /// Move the source of the input signal to the sample, so the data are read from it again. This is used by the restored
+    /// processor, which does not keep the input read before the snapshot. The live sources can not move.
+    /// @param [in] _iSample number of the samples from the beginning of the input
+    /// @return EAR_FAIL if the source can not move there, the reading continues from the current input then
+		virtual unsigned int seek(uint64_t _iSample){return EAR_FAIL;}
 
 	protected:
     /// Function that is accessible only by derived classes for requesting new data. If the previous processor was set,
@@ -360,17 +492,36 @@ namespace Ear
   */
 	class CResult
   {
+	public:
+		CResult() : fConfidence(1) {}
+
 	public:
 	  int64_t         iRevIndex; ///< time from end of hypothesis to the beginning of the event detected
 	  int64_t         iDur;      ///< duration of the event detected
     unsigned int    iId;       ///< id of the event detected (output symbol index)
 		float           fScore;    ///< score (likelihood) of the detection
+		float           fConfidence; ///< posterior probability of the detection (see <i>CConfidence</i>), 1 if not computed
 	};
 
   /**
   * typedef for representing the result as array of the CResult classes.
   */
 	typedef std::list<CResult> CResults;
+
+  /**
+  * One of the alternative hypotheses of the decoding, the acoustic events on its path and its total score.
+  */
+	class CHypothesis
+	{
+	public:
+		CResults        events; ///< the acoustic events of the hypothesis, the oldest one first
+		float           fScore; ///< total score of the hypothesis
+	};
+
+  /**
+  * typedef for the list of the best hypotheses, the best one first.
+  */
+	typedef std::list<CHypothesis> CNBest;
 }
 
 #endif
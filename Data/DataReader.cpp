@@ -19,7 +19,9 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include <limits.h>
+#include <float.h>
 
 #include "DataReader.h"
 #include "Utils.h"
@@ -34,7 +36,14 @@ CDataHolder::CDataHolder()
 	fst.pNet = NULL;
 	am.Pdfs = NULL;
 	am.States = NULL;
+	am.Selection = NULL;
+	am.Quant = NULL;
+	m_pMlp = NULL;
 	mapWords.ppszWords = NULL;
+	events.pEvents = NULL;
+	events.iSize = 0;
+	m_pfPdfs = NULL;
+	m_iStride = 0;
 }
 
 CDataHolder::~CDataHolder()
@@ -47,6 +56,9 @@ CDataHolder::~CDataHolder()
 		delete[] mapWords.ppszWords;
 	}
 
+  /// releasing the settings of the events
+	if(events.pEvents) delete[] events.pEvents;
+
   /// releasing the acoustic model
 	if(am.States){
 
@@ -59,16 +71,30 @@ CDataHolder::~CDataHolder()
 	}
 
   /// releasing the search network
-	if(am.Pdfs){
-		for(unsigned int i = 0; i<am.iNumberOfPdfs; i++) {
-			delete[] am.Pdfs[i].fVar;
-			delete[] am.Pdfs[i].fMean;
-		}
-		delete[] am.Pdfs;
-	}
+	if(am.Pdfs) delete[] am.Pdfs;
+	if(m_pfPdfs) freeAligned(m_pfPdfs);
 
 	if(fst.pNet) delete[] fst.pNet;
 
+  /// releasing the Gaussian selection
+	if(am.Selection){
+		delete[] am.Selection->fWeight;
+		delete[] am.Selection->fCodebook;
+		delete[] am.Selection->Shortlists;
+		delete am.Selection;
+	}
+
+  /// releasing the quantized PDFs
+	if(am.Quant){
+		if(am.Quant->fTable) delete[] am.Quant->fTable;
+		if(am.Quant->fScale) delete[] am.Quant->fScale;
+		free(am.Quant->pData);
+		delete am.Quant;
+	}
+
+  /// releasing the neural network
+	if(m_pMlp) freeMlp(m_pMlp);
+
   /// clearing the hash map of the end state mapping
 	mapStates.clear();
 }
@@ -79,8 +105,9 @@ unsigned int CDataHolder::load(const char *_szFileName, const char *_szIndexName
 	FILE *pf = NULL;
 	char szbuf[5000];
 	unsigned int ubuf = 0;
-	unsigned int i;
+	unsigned int i, iType, iSize;
 	map<unsigned int, unsigned int>::iterator it;
+	EAR_AM_Quant *q = NULL;
 
 	/// read dictionary from the index file
 	pf = fopen(_szIndexName, "r");
@@ -96,7 +123,7 @@ unsigned int CDataHolder::load(const char *_szFileName, const char *_szIndexName
 
   /// seek to the beginnig and now actualy read the names.
 	fseek(pf, 0, SEEK_SET);
-	mapWords.ppszWords = new char*[mapWords.iSize];
+	mapWords.ppszWords = new char*[mapWords.iSize]();
 	while(fscanf(pf, "%s\t%u\n", szbuf, &ubuf) == 2)	{mapWords.ppszWords[ubuf] = cloneString(szbuf);}
 
 	fclose(pf);
@@ -111,6 +138,8 @@ unsigned int CDataHolder::load(const char *_szFileName, const char *_szIndexName
 	if(fread(&am.iNumberOfStates, sizeof(unsigned int), 1, pf) != 1) return EAR_FAIL;
 	if(fread(&am.iNumberOfPdfs, sizeof(unsigned int), 1, pf) != 1) return EAR_FAIL;
 	if(fread(&am.iPdfsOnState, sizeof(unsigned int), 1, pf) != 1) return EAR_FAIL;
+	iType = am.iVectorSize & EAR_AM_QUANT; am.iVectorSize &= ~EAR_AM_QUANT;
+	if(iType != EAR_AM_FLOAT && iType != EAR_AM_INT8 && iType != EAR_AM_FP16) return EAR_FAIL;
 
   /// allocate the PDF indexes array for states and read
 	am.States = new unsigned int*[am.iNumberOfStates];
@@ -122,16 +151,47 @@ unsigned int CDataHolder::load(const char *_szFileName, const char *_szIndexName
 
   /// allocate array of PDFs definitions and read
 	am.Pdfs = new EAR_AM_Pdf[am.iNumberOfPdfs];
-	for(i=0; i<am.iNumberOfPdfs; i++)
+
+	/// quantized PDFs are read as they are, the scorer uses them without the float copy
+	if(iType != EAR_AM_FLOAT)
 	{
-		//allocate space for var and mean
-		am.Pdfs[i].fVar = new float[am.iVectorSize];
-		am.Pdfs[i].fMean = new float[am.iVectorSize];
+		am.Quant = q = new EAR_AM_Quant;
+		q->iType = iType; q->iStride = 2 * am.iVectorSize;
+		q->fTable = NULL; q->fScale = NULL;
+		iSize = iType == EAR_AM_INT8 ? sizeof(uint8_t) : sizeof(uint16_t);
+		q->pData = malloc((size_t)am.iNumberOfPdfs * q->iStride * iSize);
+		if(q->pData == NULL) return EAR_FAIL;
+
+		if(iType == EAR_AM_INT8)
+		{
+			q->fTable = new float[q->iStride * EAR_AM_LEVELS];
+			if(fread(q->fTable, sizeof(float), q->iStride * EAR_AM_LEVELS, pf) != q->iStride * EAR_AM_LEVELS) return EAR_FAIL;
+		}
+		else
+		{
+			q->fScale = new float[am.iVectorSize];
+			if(fread(q->fScale, sizeof(float), am.iVectorSize, pf) != am.iVectorSize) return EAR_FAIL;
+		}
 
-		if(fread(am.Pdfs[i].fVar, sizeof(float), am.iVectorSize, pf) != am.iVectorSize) return EAR_FAIL;
-		if(fread(am.Pdfs[i].fMean, sizeof(float), am.iVectorSize, pf) != am.iVectorSize) return EAR_FAIL;
-		if(fread(&am.Pdfs[i].fgconst, sizeof(float), 1, pf) != 1) return EAR_FAIL;
-		if(fread(&am.Pdfs[i].fWeight, sizeof(float), 1, pf) != 1) return EAR_FAIL;
+		for(i=0; i<am.iNumberOfPdfs; i++)
+		{
+			char *row = (char*)q->pData + (size_t)i * q->iStride * iSize;
+			if(fread(row, iSize, q->iStride, pf) != q->iStride) return EAR_FAIL;
+			if(fread(&am.Pdfs[i].fgconst, sizeof(float), 1, pf) != 1) return EAR_FAIL;
+			if(fread(&am.Pdfs[i].fWeight, sizeof(float), 1, pf) != 1) return EAR_FAIL;
+			am.Pdfs[i].fVar = NULL; am.Pdfs[i].fMean = NULL;
+		}
+	}
+	else
+	{
+		allocPdfs(am.iVectorSize); if(m_pfPdfs == NULL) return EAR_FAIL;
+		for(i=0; i<am.iNumberOfPdfs; i++)
+		{
+			if(fread(am.Pdfs[i].fVar, sizeof(float), am.iVectorSize, pf) != am.iVectorSize) return EAR_FAIL;
+			if(fread(am.Pdfs[i].fMean, sizeof(float), am.iVectorSize, pf) != am.iVectorSize) return EAR_FAIL;
+			if(fread(&am.Pdfs[i].fgconst, sizeof(float), 1, pf) != 1) return EAR_FAIL;
+			if(fread(&am.Pdfs[i].fWeight, sizeof(float), 1, pf) != 1) return EAR_FAIL;
+		}
 	}
 
 	/// Read finite state transducer
@@ -172,6 +232,262 @@ unsigned int CDataHolder::load(const char *_szFileName, const char *_szIndexName
 	return EAR_SUCCESS;
 }
 
+float *CDataHolder::allocPdfs(unsigned int _iVectorSize)
+{
+	float *old = m_pfPdfs, *block;
+	const unsigned int iBlock = EAR_ALIGN / sizeof(float);
+	unsigned int i, iStride;
+
+	/// variance and mean of each PDF are padded to whole blocks of the alignment
+	iStride = 2 * ((_iVectorSize + iBlock - 1) / iBlock * iBlock);
+	block = allocAligned(am.iNumberOfPdfs * iStride);
+	if(block == NULL) return old;
+	m_pfPdfs = block; m_iStride = iStride;
+	memset(m_pfPdfs, 0, sizeof(float) * am.iNumberOfPdfs * m_iStride);
+
+	for(i=0; i<am.iNumberOfPdfs; i++)
+	{
+		am.Pdfs[i].fVar = m_pfPdfs + i * m_iStride;
+		am.Pdfs[i].fMean = am.Pdfs[i].fVar + m_iStride / 2;
+	}
+
+	return old;
+}
+
+unsigned int CDataHolder::strip(unsigned int _iOffset)
+{
+	float *old;
+	unsigned int i, iOldStride = m_iStride;
+
+	if(_iOffset == 0) return EAR_SUCCESS;
+	if(_iOffset >= am.iVectorSize || !am.Pdfs || (!am.Quant && !m_pfPdfs)) return EAR_FAIL;
+
+	/// new block for the remaining coefficients, copy them from the old one, the quantized model has no floats
+	if(m_pfPdfs)
+	{
+		old = allocPdfs(am.iVectorSize - _iOffset);
+		if(old == m_pfPdfs) return EAR_FAIL;	///< allocation failed, the model is not changed
+
+		for(i=0; i<am.iNumberOfPdfs; i++)
+		{
+			memcpy(am.Pdfs[i].fVar, old + i * iOldStride + _iOffset, sizeof(float) * (am.iVectorSize - _iOffset));
+			memcpy(am.Pdfs[i].fMean, old + i * iOldStride + iOldStride / 2 + _iOffset, sizeof(float) * (am.iVectorSize - _iOffset));
+		}
+		freeAligned(old);
+	}
+
+	/// the quantized values are moved the same way, the rows are only shortened in place
+	if(am.Quant)
+	{
+		EAR_AM_Quant *q = am.Quant;
+		unsigned int d = am.iVectorSize, n = d - _iOffset;
+		size_t iSize = q->iType == EAR_AM_INT8 ? sizeof(uint8_t) : sizeof(uint16_t);
+		char *data = (char*)q->pData;
+
+		for(i=0; i<am.iNumberOfPdfs; i++)
+		{
+			memmove(data + i * 2 * n * iSize, data + (i * 2 * d + _iOffset) * iSize, n * iSize);
+			memmove(data + (i * 2 + 1) * n * iSize, data + (i * 2 * d + d + _iOffset) * iSize, n * iSize);
+		}
+		if(q->fTable)
+		{
+			memmove(q->fTable, q->fTable + _iOffset * EAR_AM_LEVELS, sizeof(float) * n * EAR_AM_LEVELS);
+			memmove(q->fTable + n * EAR_AM_LEVELS, q->fTable + (d + _iOffset) * EAR_AM_LEVELS, sizeof(float) * n * EAR_AM_LEVELS);
+		}
+		if(q->fScale) memmove(q->fScale, q->fScale + _iOffset, sizeof(float) * n);
+		q->iStride = 2 * n;
+	}
+
+	am.iVectorSize -= _iOffset;
+
+	/// the Gaussian selection is moved the same way, its removed coefficients are dropped from the codewords
+	if(am.Selection)
+	{
+		EAR_AM_Selection *sel = am.Selection;
+		unsigned int iDrop = sel->iOffset < _iOffset ? _iOffset - sel->iOffset : 0;
+
+		if(iDrop >= sel->iDim) return EAR_FAIL;
+		if(iDrop)
+		{
+			for(i=0; i<sel->iCodewords; i++) memmove(sel->fCodebook + i * (sel->iDim - iDrop), sel->fCodebook + i * sel->iDim + iDrop, sizeof(float) * (sel->iDim - iDrop));
+			memmove(sel->fWeight, sel->fWeight + iDrop, sizeof(float) * (sel->iDim - iDrop));
+			sel->iDim -= iDrop;
+		}
+		sel->iOffset = sel->iOffset + iDrop - _iOffset;
+	}
+
+	return EAR_SUCCESS;
+}
+
+unsigned int CDataHolder::dequantize()
+{
+	unsigned int i;
+
+	/// the float model has the values already, unless they were released
+	if(!am.Pdfs || (!am.Quant && !m_pfPdfs)) return EAR_FAIL;
+	if(m_pfPdfs) return EAR_SUCCESS;
+
+	allocPdfs(am.iVectorSize); if(m_pfPdfs == NULL) return EAR_FAIL;
+	for(i=0; i<am.iNumberOfPdfs; i++) dequantizePdf(am.Quant, i, am.Pdfs[i].fVar, am.Pdfs[i].fMean);
+
+	return EAR_SUCCESS;
+}
+
+void CDataHolder::releasePdfs()
+{
+	unsigned int i;
+
+	if(!m_pfPdfs) return;
+
+	freeAligned(m_pfPdfs); m_pfPdfs = NULL;
+	for(i=0; i<am.iNumberOfPdfs; i++) { am.Pdfs[i].fVar = NULL; am.Pdfs[i].fMean = NULL; }
+}
+
+unsigned int CDataHolder::loadSelection(const char *_szFileName)
+{
+	FILE *pf = NULL;
+	unsigned int iStates = 0, iSize = 0;
+	unsigned int ok = 1;
+	EAR_AM_Selection *sel;
+
+	/// the model needs to be loaded, only one selection at a time
+	if(!am.States || am.Selection) return EAR_FAIL;
+
+	pf = fopen(_szFileName, "rb");
+	if(pf == NULL) return EAR_FAIL;
+
+	sel = new EAR_AM_Selection;
+	sel->fWeight = NULL; sel->fCodebook = NULL; sel->Shortlists = NULL;
+
+	/// read the header, it needs to match the model
+	ok = ok && fread(&sel->iCodewords, sizeof(unsigned int), 1, pf) == 1;
+	ok = ok && fread(&sel->iOffset, sizeof(unsigned int), 1, pf) == 1;
+	ok = ok && fread(&sel->iDim, sizeof(unsigned int), 1, pf) == 1;
+	ok = ok && fread(&sel->iShortlist, sizeof(unsigned int), 1, pf) == 1;
+	ok = ok && fread(&iStates, sizeof(unsigned int), 1, pf) == 1;
+	ok = ok && iStates == am.iNumberOfStates && sel->iOffset + sel->iDim == am.iVectorSize && sel->iCodewords;
+
+	/// read the weights, codewords and shortlists
+	if(ok)
+	{
+		sel->fWeight = new float[sel->iDim];
+		sel->fCodebook = new float[sel->iCodewords * sel->iDim];
+		iSize = sel->iCodewords * iStates * sel->iShortlist;
+		sel->Shortlists = new unsigned int[iSize];
+
+		ok = ok && fread(sel->fWeight, sizeof(float), sel->iDim, pf) == sel->iDim;
+		ok = ok && fread(sel->fCodebook, sizeof(float), sel->iCodewords * sel->iDim, pf) == sel->iCodewords * sel->iDim;
+		ok = ok && fread(sel->Shortlists, sizeof(unsigned int), iSize, pf) == iSize;
+	}
+
+	fclose(pf);
+
+	/// the incomplete selection is not used
+	if(!ok)
+	{
+		if(sel->fWeight) delete[] sel->fWeight;
+		if(sel->fCodebook) delete[] sel->fCodebook;
+		if(sel->Shortlists) delete[] sel->Shortlists;
+		delete sel;
+		return EAR_FAIL;
+	}
+
+	am.Selection = sel;
+	return EAR_SUCCESS;
+}
+
+unsigned int CDataHolder::loadMlp(const char *_szFileName)
+{
+	FILE *pf = NULL;
+	unsigned int ok = 1;
+	unsigned int i, iIn, iMax = 0;
+	long iFile;
+	EAR_MLP *mlp;
+	EAR_MLP_Layer *layer;
+
+	/// the network is needed for checking the outputs, only one neural network at a time
+	if(!fst.pNet || m_pMlp) return EAR_FAIL;
+
+	pf = fopen(_szFileName, "rb");
+	if(pf == NULL) return EAR_FAIL;
+
+	/// the sizes read from the file are checked against its length before anything is allocated
+	fseek(pf, 0, SEEK_END); iFile = ftell(pf); fseek(pf, 0, SEEK_SET);
+
+	mlp = new EAR_MLP;
+	mlp->iLayers = 0; mlp->Layers = NULL; mlp->fPrior = NULL;
+
+	/// read the header
+	ok = ok && fread(&mlp->iVectorSize, sizeof(unsigned int), 1, pf) == 1;
+	ok = ok && fread(&mlp->iContext, sizeof(unsigned int), 1, pf) == 1;
+	ok = ok && fread(&i, sizeof(unsigned int), 1, pf) == 1;
+	ok = ok && i > 0 && mlp->iVectorSize > 0 && (double)i * 3 * sizeof(unsigned int) <= iFile;
+	ok = ok && (double)mlp->iVectorSize * (mlp->iContext + 1) * sizeof(float) <= iFile;
+
+	if(ok)
+	{
+		mlp->Layers = new EAR_MLP_Layer[i];
+		iIn = mlp->iVectorSize * (mlp->iContext + 1);
+	}
+
+	/// read the layers, each takes the outputs of the previous one
+	while(ok && mlp->iLayers < i)
+	{
+		layer = &mlp->Layers[mlp->iLayers];
+		layer->fWeight = NULL; layer->fBias = NULL;
+		mlp->iLayers++;
+
+		ok = ok && fread(&layer->iIn, sizeof(unsigned int), 1, pf) == 1;
+		ok = ok && fread(&layer->iOut, sizeof(unsigned int), 1, pf) == 1;
+		ok = ok && fread(&layer->iActivation, sizeof(unsigned int), 1, pf) == 1;
+		ok = ok && layer->iIn == iIn && layer->iOut > 0 && layer->iActivation <= EAR_MLP_TANH;
+		ok = ok && (double)layer->iIn * layer->iOut * sizeof(float) <= iFile;
+		if(!ok) break;
+
+		layer->fWeight = new float[layer->iIn * layer->iOut];
+		layer->fBias = new float[layer->iOut];
+		ok = ok && fread(layer->fWeight, sizeof(float), layer->iIn * layer->iOut, pf) == layer->iIn * layer->iOut;
+		ok = ok && fread(layer->fBias, sizeof(float), layer->iOut, pf) == layer->iOut;
+		iIn = layer->iOut;
+	}
+
+	/// read the priors of the outputs, there needs to be an output for each input symbol of the network
+	ok = ok && mlp->Layers[mlp->iLayers - 1].iActivation == EAR_MLP_LINEAR;
+	if(ok)
+	{
+		mlp->fPrior = new float[iIn];
+		ok = ok && fread(mlp->fPrior, sizeof(float), iIn, pf) == iIn;
+
+		for(i = 0; i < fst.iSize; i++) if(fst.pNet[i].iIn > iMax) iMax = fst.pNet[i].iIn;
+		ok = ok && iMax <= iIn;
+	}
+
+	fclose(pf);
+
+	/// the incomplete network is not used
+	if(!ok) { freeMlp(mlp); return EAR_FAIL; }
+
+	m_pMlp = mlp;
+	return EAR_SUCCESS;
+}
+
+void CDataHolder::freeMlp(EAR_MLP *_mlp)
+{
+	for(unsigned int i = 0; i < _mlp->iLayers; i++)
+	{
+		if(_mlp->Layers[i].fWeight) delete[] _mlp->Layers[i].fWeight;
+		if(_mlp->Layers[i].fBias) delete[] _mlp->Layers[i].fBias;
+	}
+	if(_mlp->Layers) delete[] _mlp->Layers;
+	if(_mlp->fPrior) delete[] _mlp->fPrior;
+	delete _mlp;
+}
+
+EAR_MLP *CDataHolder::getMlp()
+{
+	return m_pMlp;
+}
+
 EAR_AM_Info *CDataHolder::getAcousticData()
 {
 	return &am;
@@ -186,3 +502,49 @@ EAR_Dict *CDataHolder::getDict()
 {
 	return &mapWords;
 }
+
+unsigned int CDataHolder::loadEvents(const char *_szFileName)
+{
+	FILE *pf = NULL;
+	char szline[5000], szname[5000], szval[3][100];
+	unsigned int i, iSym;
+	bool ok = true;
+
+	if(!mapWords.ppszWords) return EAR_FAIL;
+	pf = fopen(_szFileName, "r");
+	if(pf == NULL) return EAR_FAIL;
+
+	/// all events have the defaults until their lines are read
+	if(events.pEvents) delete[] events.pEvents;
+	events.iSize = mapWords.iSize;
+	events.pEvents = new EAR_Event[events.iSize];
+	for(i=0; i<events.iSize; i++)
+	{
+		events.pEvents[i].bPenalty = false; events.pEvents[i].fPenalty = 0;
+		events.pEvents[i].fMinScore = -FLT_MAX; events.pEvents[i].fMinDur_ms = 0;
+	}
+
+	while(ok && fgets(szline, sizeof(szline), pf))
+	{
+		if(sscanf(szline, "%s", szname) != 1 || szname[0] == '#') continue;
+		ok = sscanf(szline, "%s %99s %99s %99s", szname, szval[0], szval[1], szval[2]) == 4;
+
+		/// the name is looked up in the dictionary, the numbers may not be continuous
+		for(iSym=1; ok && iSym<mapWords.iSize; iSym++) if(mapWords.ppszWords[iSym] && strcmp(mapWords.ppszWords[iSym], szname) == 0) break;
+		ok = ok && iSym < mapWords.iSize;
+		if(!ok) break;
+
+		EAR_Event &e = events.pEvents[iSym];
+		if(strcmp(szval[0], "*") != 0) { e.bPenalty = true; e.fPenalty = (float)atof(szval[0]); }
+		if(strcmp(szval[1], "*") != 0) e.fMinScore = (float)atof(szval[1]);
+		if(strcmp(szval[2], "*") != 0) e.fMinDur_ms = (float)atof(szval[2]);
+	}
+
+	fclose(pf);
+	return ok ? EAR_SUCCESS : EAR_FAIL;
+}
+
+EAR_Events *CDataHolder::getEvents()
+{
+	return events.pEvents ? &events : NULL;
+}
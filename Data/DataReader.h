@@ -53,6 +53,12 @@ namespace Ear
     * 4. Number of PDFs on state - unsigned 4 bytes
     * 5. Array of indexes of PDFs - Number of PDFs * unsigned 4 bytes
     * 6. PDF (variance, mean, gconst, weight) - Number of PDFs * 4 * 4 bytes (float)
+    *
+    * The upper bits of the vector size can mark the quantized PDFs (EAR_AM_INT8 or EAR_AM_FP16, see EAR_AM_Quant).
+    * The precisions and scaled means are then stored instead of the variances and means in 1 byte indexes or 2 bytes
+    * half floats. The PDFs are preceded by the tables of the values of the indexes (2 * vector size * EAR_AM_LEVELS * 4 bytes)
+    * or by the scales of the precisions (vector size * 4 bytes). Only the quantized values are kept, in the <i>Quant</i>
+    * of the acoustic model, the variances and means of the PDFs are NULL (see <i>dequantize</i>).
     * 7. FST size - number of transitions in search network - unsigned 5 bytes
     * 8. FST (start, end, in symbol, out symbol, weight) - FST size * ( 4 * unsigned 4 bytes, 4 bytes (float))
     * @param [in] _szFileName name of the file to read
@@ -69,11 +75,77 @@ namespace Ear
     /// Function for getting dictionary from loaded index file
     /// @return pointer to structure of dictionary
 	  EAR_Dict *getDict();
+    /** Function for loading the settings of the acoustic events from the text file. Each line has the name of the event
+    * from the dictionary, its insertion penalty, the lowest mean score of the detection per feature vector and the shortest
+    * duration of the detection in milliseconds, separated by white spaces, exp. "shot\t-300\t*\t100". The value "*"
+    * leaves the default (the global penalty, no threshold), the lines starting by "#" are comments. The dictionary
+    * needs to be loaded first.
+    * @param [in] _szFileName name of the file to read
+    * @return status of the loading EAR_SUCCESS or EAR_FAIL, fails for the names not in the dictionary
+    */
+	  unsigned int loadEvents(const char *_szFileName);
+    /// Function for getting the settings of the events loaded by <i>loadEvents</i>
+    /// @return pointer to the structure of the settings, NULL if not loaded
+	  EAR_Events *getEvents();
+    /// Remove the first coefficients from all PDFs of the acoustic model. The coefficients that are not scored
+    /// are removed at load time, so the scoring goes only through the remaining ones in the dense memory layout.
+    /// The feature vectors need to be stripped the same way (see CStrip). The gconst of the PDFs is not changed,
+    /// so the scores are the same as the scoring with the offset on the full model.
+    /// @param [in] _iOffset number of the first coefficients to remove
+    /// @return EAR_SUCCESS or EAR_FAIL if the offset is not smaller than the vector size
+	  unsigned int strip(unsigned int _iOffset);
+    /// Fill the variances and means of the PDFs of the quantized acoustic model from the quantized values, for the tools
+    /// that work with the float PDFs (the scorer does not need them). The float model is not changed.
+    /// @return EAR_SUCCESS or EAR_FAIL if the model is not loaded or the allocation failed
+	  unsigned int dequantize();
+    /// Release the variances and means of the PDFs, the scorer keeps its own table derived from them (see
+    /// CAcousticScorer::setAcousticModel), so the model is not in the memory twice. The weights and gconsts stay,
+    /// the quantized values too. The scorer needs to be set before, <i>strip</i> and <i>dequantize</i> are not
+    /// possible after this.
+	  void releasePdfs();
+    /** Function for loading the Gaussian selection of the acoustic model created by the Compile tool. The binary file has following format
+    * 1. Number of codewords, offset of the first coefficient, number of coefficients, shortlist length, number of states - 5 * unsigned 4 bytes
+    * 2. Weights of the coefficients - Number of coefficients * 4 bytes (float)
+    * 3. Codewords - Number of codewords * Number of coefficients * 4 bytes (float)
+    * 4. Shortlists of PDF indexes - Number of codewords * Number of states * Shortlist length * unsigned 4 bytes
+    * The model needs to be loaded first.
+    * @param [in] _szFileName name of the file to read
+    * @return status of the loading EAR_SUCCESS or EAR_FAIL
+    */
+	  unsigned int loadSelection(const char *_szFileName);
+    /** Function for loading the neural network scoring the states instead of the PDFs of the acoustic model. The binary file has following format
+    * 1. Vector size, number of the previous vectors spliced to the input, number of layers - 3 * unsigned 4 bytes
+    * 2. For each layer: number of inputs, number of outputs, activation (EAR_MLP_*) - 3 * unsigned 4 bytes
+    *    weights - number of outputs * number of inputs * 4 bytes (float), a row for each output
+    *    biases - number of outputs * 4 bytes (float)
+    * 3. Logarithm of the prior probability of each output - number of outputs of the last layer * 4 bytes (float)
+    * The first layer has vector size * (number of spliced vectors + 1) inputs, the oldest vector first. The output of the
+    * last layer is the state of the acoustic model (from zero). The search network needs to be loaded first.
+    * @param [in] _szFileName name of the file to read
+    * @return status of the loading EAR_SUCCESS or EAR_FAIL
+    */
+	  unsigned int loadMlp(const char *_szFileName);
+    /// Function for getting the neural network loaded by <i>loadMlp</i>
+    /// @return pointer to the structure of the neural network, NULL if not loaded
+	  EAR_MLP *getMlp();
 
 	private:
 		EAR_AM_Info am;   ///< read acoustic model
 		EAR_FST_Net fst;  ///< read finite state transducer
 		EAR_Dict mapWords;///< read dictionary
+		EAR_Events events;///< read settings of the events
+		float *m_pfPdfs;  ///< one aligned block holding the variances and means of all PDFs, the PDFs are pointing into it
+		unsigned int m_iStride; ///< distance between the variances of the consecutive PDFs in the block
+		EAR_MLP *m_pMlp;  ///< read neural network, NULL if not loaded
+
+    /// Allocate the block for the PDFs of specified vector size and set the pointers of the PDFs into it.
+    /// Each variance and mean array starts aligned and is padded by zeroes.
+    /// @param [in] _iVectorSize size of the PDF vectors
+    /// @return the old block that needs to be released by the caller
+		float *allocPdfs(unsigned int _iVectorSize);
+    /// Release the neural network and its layers
+    /// @param [in] _mlp neural network to release
+		void freeMlp(EAR_MLP *_mlp);
 
     /// Originally the network consists from states that are numbered, so transition is defined
     /// by two states, one starting point and one ending point. We are remembering the transitions
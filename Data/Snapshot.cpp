@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Snapshot.h"
+
+using namespace Ear;
+
+CSnapshot::CSnapshot()
+{
+	m_iRead = 0;
+}
+
+CSnapshot::~CSnapshot()
+{
+}
+
+void CSnapshot::clear()
+{
+	m_data.clear();
+	m_iRead = 0;
+}
+
+void CSnapshot::rewind()
+{
+	m_iRead = 0;
+}
+
+void CSnapshot::write(const void *_p, size_t _iSize)
+{
+	m_data.insert(m_data.end(), (const char*)_p, (const char*)_p + _iSize);
+}
+
+unsigned int CSnapshot::read(void *_p, size_t _iSize)
+{
+	if(_iSize > m_data.size() - m_iRead) return EAR_FAIL;
+
+	if(_iSize) memcpy(_p, &m_data[m_iRead], _iSize);
+	m_iRead += _iSize;
+	return EAR_SUCCESS;
+}
+
+void CSnapshot::write(CDataContainer &_data)
+{
+	write(&_data.size(), sizeof(unsigned int));
+	write(&_data.freq(), sizeof(unsigned int));
+	write(_data.data(), _data.size() * sizeof(float));
+}
+
+unsigned int CSnapshot::read(CDataContainer &_data)
+{
+	unsigned int iSize, iFreq;
+
+	if(read(&iSize, sizeof(iSize)) == EAR_FAIL || read(&iFreq, sizeof(iFreq)) == EAR_FAIL) return EAR_FAIL;
+	if((size_t)iSize * sizeof(float) > m_data.size() - m_iRead) return EAR_FAIL;
+
+	_data.resize(iSize); _data.freq() = iFreq;
+	return read(_data.data(), iSize * sizeof(float));
+}
+
+unsigned int CSnapshot::check(unsigned int _iExpect)
+{
+	unsigned int i;
+
+	if(read(&i, sizeof(i)) == EAR_FAIL) return EAR_FAIL;
+	return i == _iExpect ? EAR_SUCCESS : EAR_FAIL;
+}
+
+unsigned int CSnapshot::save(const char *_szFileName)
+{
+	unsigned int iHead[2] = {SNAPSHOT_MAGIC, SNAPSHOT_VERSION};
+	uint64_t iSize = m_data.size();
+	char tmp[PATH_MAX];
+	FILE *pf = NULL;
+	bool bOk;
+
+	if(snprintf(tmp, PATH_MAX, "%s.tmp", _szFileName) >= PATH_MAX) return EAR_FAIL;
+	pf = fopen(tmp, "wb");
+	if(pf == NULL) return EAR_FAIL;
+
+	bOk = fwrite(iHead, sizeof(iHead), 1, pf) == 1 && fwrite(&iSize, sizeof(iSize), 1, pf) == 1;
+	if(bOk && iSize) bOk = fwrite(&m_data[0], iSize, 1, pf) == 1;
+	if(fclose(pf) != 0) bOk = false;
+
+	/// the complete file replaces the previous snapshot at once
+	if(!bOk || rename(tmp, _szFileName) != 0) { remove(tmp); return EAR_FAIL; }
+	return EAR_SUCCESS;
+}
+
+unsigned int CSnapshot::load(const char *_szFileName)
+{
+	unsigned int iHead[2];
+	uint64_t iSize;
+	FILE *pf = NULL;
+	bool bOk;
+
+	clear();
+	pf = fopen(_szFileName, "rb");
+	if(pf == NULL) return EAR_FAIL;
+
+	bOk = fread(iHead, sizeof(iHead), 1, pf) == 1 && iHead[0] == SNAPSHOT_MAGIC && iHead[1] == SNAPSHOT_VERSION;
+	bOk = bOk && fread(&iSize, sizeof(iSize), 1, pf) == 1;
+	if(bOk) { m_data.resize(iSize); if(iSize) bOk = fread(&m_data[0], iSize, 1, pf) == 1; }
+	fclose(pf);
+
+	if(!bOk) { clear(); return EAR_FAIL; }
+	return EAR_SUCCESS;
+}
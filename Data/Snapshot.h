@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+ /**
+ * This file contains the snapshot of the state of the processing, used to checkpoint and restore a running stream.
+ */
+
+#ifndef __EAR_SNAPSHOT_H_
+#define __EAR_SNAPSHOT_H_
+
+#include <stdint.h>
+#include <vector>
+#include "Data.h"
+
+#define SNAPSHOT_MAGIC	0x53524145	///< "EARS" at the beginning of the snapshot file
+#define SNAPSHOT_VERSION	4	///< version of the layout of the snapshot, the snapshots of other versions are not loaded
+
+namespace Ear
+{
+  /**
+  * Binary snapshot of the state of the processing. The parts of the pipeline (the processors of the frontend, the scorer,
+  * the search and the controllers around it) write their state one after another by <i>save</i> and read it back by
+  * <i>restore</i> in the same order. Only the state changing with the input is written, the restoring instance needs to be
+  * created and initialized by the same settings and models, the sizes written by the parts are checked against it.
+  *
+  * The values are written in the native byte order, so the snapshot is moved only between the same builds of the program.
+  * The memory of the snapshot is kept when cleared, so the periodic snapshots of one stream do not allocate.
+  */
+	class CSnapshot
+	{
+	public:
+		CSnapshot();
+		~CSnapshot();
+
+	private:
+		std::vector<char> m_data; ///< the written state
+		size_t m_iRead; ///< read position in the state
+
+	public:
+    /// Forget the written state and start a new snapshot
+		void clear();
+    /// Start reading the state from the beginning
+		void rewind();
+    /// @return size of the written state in bytes
+		size_t size(){ return m_data.size(); }
+    /// Append the values to the state
+    /// @param [in] _p the values
+    /// @param [in] _iSize size of the values in bytes
+		void write(const void *_p, size_t _iSize);
+    /// Read the next values of the state
+    /// @param [out] _p the values
+    /// @param [in] _iSize size of the values in bytes
+    /// @return EAR_FAIL if the state is shorter
+		unsigned int read(void *_p, size_t _iSize);
+    /// Append the content of the container, its size and frequency
+    /// @param [in] _data the container
+		void write(CDataContainer &_data);
+    /// Read the content of the container written by <i>write</i>
+    /// @param [out] _data the container, resized to the content
+    /// @return EAR_FAIL if the state is shorter
+		unsigned int read(CDataContainer &_data);
+    /// Read the value and compare it with the expected one, used for the sizes the state depends on
+    /// @param [in] _iExpect the expected value
+    /// @return EAR_FAIL if the value differs or the state is shorter
+		unsigned int check(unsigned int _iExpect);
+    /// Write the snapshot to the file. The file is written under a temporary name first and then renamed, so the
+    /// previous snapshot stays complete if the program stops in the middle of the writing.
+    /// @param [in] _szFileName name of the file
+    /// @return success of the writing
+		unsigned int save(const char *_szFileName);
+    /// Read the snapshot from the file written by <i>save</i>, ready for the reading of the state
+    /// @param [in] _szFileName name of the file
+    /// @return EAR_FAIL if the file can not be read or it is not a snapshot of this version
+		unsigned int load(const char *_szFileName);
+	};
+}
+
+#endif
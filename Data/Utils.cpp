@@ -21,6 +21,9 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+
+#include "Data.h"
 
 char *Ear::cloneString(char *_c)
 {
@@ -49,3 +52,71 @@ float *Ear::cloneVector(float *_f, unsigned int _x)
 	memcpy(o, _f, sizeof(float) * _x);
 	return o;
 }
+
+float *Ear::allocAligned(unsigned int _x)
+{
+	void *o = NULL;
+	if(posix_memalign(&o, EAR_ALIGN, sizeof(float) * (_x ? _x : 1))) return NULL;
+	return (float*)o;
+}
+
+void Ear::freeAligned(float *_f)
+{
+	free(_f);
+}
+
+uint16_t Ear::floatToHalf(float _f)
+{
+	union { float f; uint32_t i; } u;
+	uint32_t sign, mant;
+	int exp;
+
+	u.f = _f;
+	sign = (u.i >> 16) & 0x8000;
+	exp = (int)((u.i >> 23) & 0xff) - 127 + 15;
+	mant = u.i & 0x7fffff;
+
+	/// infinity and NaN
+	if(((u.i >> 23) & 0xff) == 0xff) return sign | 0x7c00 | (mant ? 0x200 : 0);
+	/// too large for the half float
+	if(exp >= 31) return sign | 0x7c00;
+
+	/// subnormal half float or zero, the implicit bit of the mantissa is shifted out
+	if(exp <= 0)
+	{
+		if(exp < -10) return sign;
+		mant |= 0x800000;
+		uint32_t shift = 14 - exp;
+		uint32_t h = mant >> shift;
+		uint32_t rest = mant & ((1u << shift) - 1), half = 1u << (shift - 1);
+		if(rest > half || (rest == half && (h & 1))) h++;
+		return sign | h;
+	}
+
+	/// normal number rounded to the nearest even, the carry of the rounding can move into the exponent
+	uint32_t h = ((uint32_t)exp << 10) | (mant >> 13);
+	uint32_t rest = mant & 0x1fff;
+	if(rest > 0x1000 || (rest == 0x1000 && (h & 1))) h++;
+	return sign | h;
+}
+
+void Ear::dequantizePdf(const EAR_AM_Quant *_q, unsigned int _iPdf, float *_pfVar, float *_pfMean)
+{
+	unsigned int j, n = _q->iStride / 2;
+	float s, b;
+
+	for(j=0; j<n; j++)
+	{
+		if(_q->iType == EAR_AM_INT8) {
+			const uint8_t *row = (const uint8_t*)_q->pData + (size_t)_iPdf * _q->iStride;
+			s = _q->fTable[j * EAR_AM_LEVELS + row[j]];
+			b = _q->fTable[(n + j) * EAR_AM_LEVELS + row[n + j]];
+		} else {
+			const uint16_t *row = (const uint16_t*)_q->pData + (size_t)_iPdf * _q->iStride;
+			s = _q->fScale[j] * halfToFloat(row[j]);
+			b = halfToFloat(row[n + j]);
+		}
+		_pfVar[j] = 2.0f * s * s;
+		_pfMean[j] = s > 0 ? b / s : 0.0f;
+	}
+}
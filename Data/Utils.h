@@ -24,6 +24,9 @@
 #ifndef __EAR_UTILS_H_
 #define __EAR_UTILS_H_
 
+#include <stdint.h>
+#include "Data.h"
+
 namespace Ear
 {
   /// Allocate new array and copy string
@@ -43,6 +46,38 @@ namespace Ear
   /// @param [in] _x size of the array to copy
   /// @return copied new array
 	float *cloneVector(float *_f, unsigned int _x);
+  /// Allocate float array aligned to EAR_ALIGN bytes. The array needs to be released by <i>freeAligned</i>
+  /// @param [in] _x size of the array
+  /// @return new array or NULL if the allocation failed
+	float *allocAligned(unsigned int _x);
+  /// Release array allocated by <i>allocAligned</i>
+  /// @param [in] _f array to release
+	void freeAligned(float *_f);
+  /// Convert float to half float (IEEE 754 binary16) rounded to the nearest
+  /// @param [in] _f value to convert
+  /// @return bits of the half float
+	uint16_t floatToHalf(float _f);
+  /// Convert half float to float. Written without branches, so the compiler can vectorize the loops using it.
+  /// @param [in] _h bits of the half float
+  /// @return converted value
+	static inline float halfToFloat(uint16_t _h)
+	{
+		union { float f; uint32_t i; } u;
+
+		/// the exponent and the mantissa are moved to the place, the exponent is rebiased by the multiplication by 2^112
+		/// (it also normalizes the subnormal numbers), the infinities and NaNs get the maximum exponent back
+		u.i = (uint32_t)(_h & 0x7fff) << 13;
+		u.f *= 5.192296858534828e+33f;
+		u.i |= (_h & 0x7c00) == 0x7c00 ? 0x7f800000 : 0;
+		u.i |= (uint32_t)(_h & 0x8000) << 16;
+		return u.f;
+	}
+  /// Dequantize one PDF of the quantized acoustic model (see EAR_AM_Quant), ivar = 2 * s^2 and mean = b / s
+  /// @param [in] _q quantized PDFs of the model
+  /// @param [in] _iPdf index of the PDF
+  /// @param [out] _pfVar inverse variances of all coefficients (_q->iStride / 2 values)
+  /// @param [out] _pfMean means of all coefficients
+	void dequantizePdf(const EAR_AM_Quant *_q, unsigned int _iPdf, float *_pfVar, float *_pfMean);
 }
 
 #endif
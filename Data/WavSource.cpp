@@ -101,6 +101,14 @@ unsigned int CWavSource::load(char *_szFileName)
     return EAR_SUCCESS;
 }
 
+unsigned int CWavSource::seek(uint64_t _iSample)
+{
+    if(_iSample * m_iBytesPerSmp > m_iSize) return EAR_FAIL;
+
+    m_iRead = (unsigned int)(_iSample * m_iBytesPerSmp);
+    return EAR_SUCCESS;
+}
+
 void CWavSource::getData(CDataContainer &_pData)
 {
     /// compute available data
@@ -57,6 +57,10 @@ namespace Ear
     /// @param [in] _szFileName name of the file to read
     /// @return success of the reading.
     unsigned int load(char *_szFileName);
+    /// Continue the reading from the sample of the loaded file
+    /// @param [in] _iSample number of the samples from the beginning of the file
+    /// @return EAR_FAIL if the file is shorter
+    unsigned int seek(uint64_t _iSample);
 	};
 }
 
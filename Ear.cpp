@@ -27,38 +27,118 @@
 #include "Data/DataReader.h"
 #include "Data/WavSource.h"
 #include "Data/MicSource.h"
+#include "Data/Snapshot.h"
 #include "Search/AcousticScorer.h"
+#include "Search/MlpScorer.h"
 #include "Search/Search.h"
+#include "Search/ActivityGate.h"
+#include "Search/Detector.h"
 #include "Features/Feature.h"
 
 #define WAV_READ_CHUNK	1000
 
 using namespace Ear;
 
+//what is needed to print the committed events as they come from the decoder
+typedef struct
+{
+	EAR_Dict *pDict;
+	float fShift_ms;
+	int iBcg;
+	bool bConfidence;
+	float fMinConfidence;
+} printer_t;
+
+//print one event, with its confidence in the last column if it is computed,
+//the events (not the background) with lower confidence than the minimum are not printed
+static void printResult(const printer_t *_p, const CResult &_event)
+{
+	if(_p->bConfidence && (int)_event.iId != _p->iBcg && _event.fConfidence < _p->fMinConfidence) return;
+
+	printf("%f\t%f\t%s\t%f", (float)_event.iRevIndex * _p->fShift_ms / 1000, 
+						   (float) _event.iDur * _p->fShift_ms / 1000, 
+							_p->pDict->ppszWords[_event.iId],
+							_event.fScore);
+	if(_p->bConfidence) printf("\t%f", _event.fConfidence);
+	printf("\n");
+}
+
+//print the event committed by the decoder, the background is not printed
+static void printEvent(void *_pArg, const CResult &_event)
+{
+	printer_t *p = (printer_t*)_pArg;
+	if((int)_event.iId == p->iBcg) return;
+
+	printResult(p, _event);
+}
+
+//keep the final event for printing at the end of the input
+static void keepEvent(void *_pArg, const CResult &_event)
+{
+	((CResults*)_pArg)->push_back(_event);
+}
+
+//write the state of the whole processing to the checkpoint file, the audio source is not included
+static unsigned int checkpoint(CSnapshot &_snap, const char *_szFile, CFeature &_fea, AScorer *_pScorer, CDetector &_det)
+{
+	_snap.clear();
+	if(_fea.save(_snap) == EAR_FAIL || _pScorer->save(_snap) == EAR_FAIL) return EAR_FAIL;
+	_det.save(_snap);
+	return _snap.save(_szFile);
+}
+
 int main(int argc, char* argv[])
 {
 	CConfig cfg;
 	CFeature::Configuration fea_cfg;
 	CFeature fea;
-	char frn_type[100];
 	char model_bin[PATH_MAX];
 	char model_idx[PATH_MAX];
+	char score_form[100];
+	char gs_file[PATH_MAX];
+	char mlp_file[PATH_MAX];
+	char checkpoint_file[PATH_MAX];
+	char event_file[PATH_MAX];
+	EAR_Events *events = NULL;
+	CSnapshot snap;
+	unsigned int checkpoint_interval = 500;
+	int64_t checkpoint_time = 0;
 	ADataProcessor *audio;
 	CAcousticScorer scorer;
+	CMlpScorer mlp;
+	AScorer *pScorer = &scorer;
 	CDataHolder res;
 	CSearch dec;
+	CActivityGate gate;
+	CDetector::Configuration det_cfg;
+	CDetector det;
 	CDataContainer data;
 	CResults result;
 	CResults::iterator it;
+	printer_t printer;
 	int ret = 0;
 	unsigned int strip = 0;
+	unsigned int shortlist = 0;
+	unsigned int block = 1;
+	unsigned int threads = 1;
+	unsigned int dense = SEARCH_DENSE_STATES;
+	float gs_floor = LOG_ZERO;
+	float mlp_scale = 1;
 	float insertionPenalty = 0;
-	int64_t iTime = 0;
-	int bcg_id = 1;
-	int bcg_dur = 10;
 	bool online = false;
 	unsigned int mic_buffer = 8;
 	int mic_freq = 16000;
+	unsigned int preroll = 0;
+	unsigned int skip = 1;
+	unsigned int renorm = 0;
+	unsigned int nbest = 0;
+	unsigned int lattice_alts = 4;
+	float lattice_beam = 10;
+	float confidence_scale = 0;
+	float confidence_beam = 50;
+	float confidence_min = 0;
+	unsigned int confidence_window = 0;
+	unsigned int i;
 
 	if(argc < 1 && argc > 3){
 		fprintf(stderr, "Usage:\n\t%s <configuration file> <wav file>\n \t wav file processing", argv[0]);
@@ -74,8 +154,11 @@ int main(int argc, char* argv[])
 
 	//load some initial properties
     cfg.lookUpBool("ONLINE", &online, false);
-	cfg.lookUpInt("BCG_IDX", &bcg_id, 1);
-	cfg.lookUpInt("BCG_DUR", &bcg_dur, 10);
+	det_cfg.lookUp(cfg);
+	cfg.lookUpString("CHECKPOINT_FILE", checkpoint_file, "");
+	cfg.lookUpUInt("CHECKPOINT_INTERVAL", &checkpoint_interval, 500);
+	//the kept results of the offline processing are not in the checkpoint
+	if(!online) checkpoint_file[0] = '\0';
 
 	//load models and recognition network
     cfg.lookUpString("MODEL_IDX_FILE", model_idx, "model.idx");
@@ -83,14 +166,74 @@ int main(int argc, char* argv[])
 	ret = res.load(model_bin, model_idx);
 	if(ret == EAR_FAIL){ fprintf(stderr, "Error reading model and idx file\n"); return 1; }
 
+	//the insertion penalties and the thresholds of the single events
+	cfg.lookUpString("EVENT_FILE", event_file, "");
+	if(event_file[0] != '\0'){
+		ret = res.loadEvents(event_file);
+		if(ret == EAR_FAIL){ fprintf(stderr, "Error reading event file %s\n", event_file); return 1; }
+		events = res.getEvents();
+	}
+
 	//create scorer for the search algorithm
+	//the coefficients that are not scored are removed from the model and the features
+	//Gaussian selection is indexed by the full model, so it is loaded before the coefficients are removed
+	cfg.lookUpString("GS_FILE", gs_file, "");
+	if(gs_file[0] != '\0'){
+		ret = res.loadSelection(gs_file);
+		if(ret == EAR_FAIL){ fprintf(stderr, "Error reading Gaussian selection file %s\n", gs_file); return 1; }
+	}
 	cfg.lookUpUInt("STRIP_OFFSET",&strip,0);
-	scorer.setAcousticModel(res.getAcousticData(), strip);
+	ret = res.strip(strip);
+	if(ret == EAR_FAIL){ fprintf(stderr, "Error removing %u coefficients from the model\n", strip); return 1; }
+	cfg.lookUpString("SCORE_FORM", score_form, "FOLDED");
+	scorer.setAcousticModel(res.getAcousticData(), 0, strcmp(score_form, "DOT") == 0 ? CAcousticScorer::DOT : CAcousticScorer::FOLDED);
+	//the scorer has its own table of the PDFs, the loaded variances and means are not needed any more
+	res.releasePdfs();
+	cfg.lookUpString("MIXTURE", score_form, "MAX");
+	scorer.changeMixtureMode(strcmp(score_form, "SUM") == 0 ? CAcousticScorer::SUM : CAcousticScorer::MAX);
+	cfg.lookUpUInt("GS_SHORTLIST", &shortlist, 0);
+	cfg.lookUpFloat("GS_FLOOR", &gs_floor, LOG_ZERO);
+	scorer.setSelection(res.getAcousticData()->Selection, shortlist, gs_floor);
+	cfg.lookUpUInt("SCORE_THREADS", &threads, 1);
+	scorer.changeThreads(threads);
+
+	//the neural network scores the states instead of their PDFs, the network refers to the same states
+	cfg.lookUpString("MLP_FILE", mlp_file, "");
+	if(mlp_file[0] != '\0'){
+		ret = res.loadMlp(mlp_file);
+		if(ret == EAR_FAIL){ fprintf(stderr, "Error reading neural network file %s\n", mlp_file); return 1; }
+		cfg.lookUpFloat("MLP_SCALE", &mlp_scale, 1);
+		mlp.setNetwork(res.getMlp(), mlp_scale);
+		pScorer = &mlp;
+	}
 
 	//create search algorithm instance
     cfg.lookUpFloat("INSERT_PENALTY", &insertionPenalty, -100);
-	ret = dec.initialize(res.getFSTData(), &scorer, insertionPenalty);
+	cfg.lookUpUInt("DENSE_STATES", &dense, SEARCH_DENSE_STATES);
+	ret = dec.initialize(res.getFSTData(), pScorer, insertionPenalty, dense);
 	if(ret == EAR_FAIL){ fprintf(stderr, "Error creating search instance\n"); return 1; }
+	//the events not in the search network are left out
+	for(i = 0; events && i < events->iSize; i++) if(events->pEvents[i].bPenalty) dec.changeSymbolPenalty(i, events->pEvents[i].fPenalty);
+	cfg.lookUpUInt("FRAME_SKIP", &skip, 1);
+	dec.changeFrameSkip(skip);
+	cfg.lookUpUInt("SCORE_BLOCK", &block, 1);
+	dec.changeBlockSize(block);
+	cfg.lookUpUInt("SCORE_RENORM", &renorm, 0);
+	dec.changeRenormalization(renorm);
+	cfg.lookUpUInt("NBEST", &nbest, 0);
+	cfg.lookUpUInt("LATTICE_ALTS", &lattice_alts, 4);
+	cfg.lookUpFloat("LATTICE_BEAM", &lattice_beam, 10);
+	if(nbest > 1) dec.changeLattice(lattice_alts, lattice_beam);
+	cfg.lookUpFloat("CONFIDENCE_SCALE", &confidence_scale, 0);
+	cfg.lookUpFloat("CONFIDENCE_BEAM", &confidence_beam, 50);
+	cfg.lookUpUInt("CONFIDENCE_WINDOW", &confidence_window, 0);
+	cfg.lookUpFloat("CONFIDENCE_MIN", &confidence_min, 0);
+	ret = dec.changeConfidence(confidence_scale, confidence_beam, confidence_window);
+	if(ret == EAR_FAIL){ fprintf(stderr, "Error setting the confidence of the events\n"); return 1; }
+
+	//create activity gate in front of the search algorithm
+	cfg.lookUpUInt("GATE_PREROLL", &preroll, 50);
+	gate.initialize(&dec, preroll);
 
 	//initialize audio source
 	if(argc == 3){
@@ -108,31 +251,34 @@ int main(int argc, char* argv[])
 	}
 
 	//configuration for freature extraction
-    cfg.lookUpBool("ZERO_COEF", &fea_cfg.bC0, false);
-    cfg.lookUpBool("ENERGY", &fea_cfg.bEnergy, false);
-    cfg.lookUpBool("RAW_ENERGY", &fea_cfg.bRawE, false);
-	cfg.lookUpFloat("HAMMING",&fea_cfg.fHam, 0.46);
-    cfg.lookUpFloat("WND_LENGTH",&fea_cfg.fLength_ms, 25);
-    cfg.lookUpFloat("PREEM",&fea_cfg.fPreem, 0.97);
-    cfg.lookUpFloat("WND_SHIFT",&fea_cfg.fShift_ms, 10);
-	cfg.lookUpUInt("ACC_WND",&fea_cfg.iAccWin,2);
-    cfg.lookUpUInt("CEP_NUM",&fea_cfg.iCep,12);
-	cfg.lookUpUInt("DEL_WND",&fea_cfg.iDelWin,2);
- 	cfg.lookUpUInt("HI_FREQ",&fea_cfg.iHiFreq_hz,UINT_MAX);
-    cfg.lookUpUInt("LO_FREQ",&fea_cfg.iLoFreq_hz,0);
-    cfg.lookUpUInt("LIFT_COEF",&fea_cfg.iLift,22);
-    cfg.lookUpUInt("MEL_NUM",&fea_cfg.iMel,29);
-    cfg.lookUpUInt("CMN_WND",&fea_cfg.iCMNWin,0);
-	cfg.lookUpString("FRONT_END_TYPE", frn_type, "MFCC");
-    if(strcmp(frn_type, "MFCC") == 0) fea_cfg.iType = CFeature::Configuration::MFCC;
-    if(strcmp(frn_type, "MELSPEC") == 0) fea_cfg.iType = CFeature::Configuration::MELSPEC;
-    if(strcmp(frn_type, "FBANK") == 0) fea_cfg.iType = CFeature::Configuration::FBANK;
-    if(strcmp(frn_type, "DIRECT") == 0) fea_cfg.iType = CFeature::Configuration::DIRECT;
+	fea_cfg.lookUp(cfg);
+	fea_cfg.iStrip = strip;
+	if(argc == 2) fea_cfg.iThreads = 1;	//the microphone input can not be read at once
+
+	//the minimum durations of the events are in the feature vectors
+	for(i = 0; events && i < events->iSize; i++)
+		det.changeThreshold(i, events->pEvents[i].fMinScore, (unsigned int)(events->pEvents[i].fMinDur_ms / fea_cfg.fShift_ms + 0.5f));
 
 	//initialize frontend and set the wav source
 	fea.initialize(fea_cfg);
 	fea.setSource(audio);
 
+	//in online mode the events are printed right when they are final by the detection strategy,
+	//otherwise they are kept for the results at the end
+	printer.pDict = res.getDict(); printer.fShift_ms = fea_cfg.fShift_ms; printer.iBcg = det_cfg.iBackground;
+	printer.bConfidence = confidence_scale > 0; printer.fMinConfidence = confidence_min;
+	if(online) det.initialize(&dec, &gate, det_cfg, printEvent, &printer);
+	else det.initialize(&dec, &gate, det_cfg, keepEvent, &result);
+
+	//continue the stream interrupted after the last checkpoint, the events passed since then are printed again
+	if(checkpoint_file[0] && snap.load(checkpoint_file) == EAR_SUCCESS){
+		if(fea.restore(snap) == EAR_FAIL || pScorer->restore(snap) == EAR_FAIL || det.restore(snap) == EAR_FAIL){
+			fprintf(stderr, "Checkpoint %s does not match the configuration\n", checkpoint_file); return 1;
+		}
+		fprintf(stderr, "Continuing from checkpoint %s at %f s\n", checkpoint_file, (float)det.getTime() * fea_cfg.fShift_ms / 1000);
+		checkpoint_time = det.getTime();
+	}
+
 	//process all data
 	while(1)
 	{
@@ -140,56 +286,59 @@ int main(int argc, char* argv[])
 		fea.getData(data);
 		if(data.size() == 0) break;
 
-		//process the one frame
-		ret = dec.process(data, iTime); iTime++;
-		printf("%10ld\r", iTime);
+		//process the one frame, the final events are passed by the detector
+		ret = det.process(data, fea.isActive());
+		printf("%10ld\r", det.getTime());
 		if(ret == EAR_FAIL){ fprintf(stderr, "Error in processing input data\n"); return 1; }
 
-		//of online results are enabled 
-		if(online){
-
-			//read the current results
-			result.clear();
-			dec.getResults(result);
-			if(result.empty()) continue;
-			CResult *r = &result.back();
-		
-			//output them all
-			if(r->iId == bcg_id && r->iDur > bcg_dur){
-				for(it = result.begin(); it != result.end(); it++){
-	
-					//skip background output
-					if(it->iId == bcg_id) continue;
-
-					printf("%f\t%f\t%s\t%f\n", (float)it->iRevIndex * fea_cfg.fShift_ms / 1000, 
-										   (float) it->iDur * fea_cfg.fShift_ms / 1000, 
-											res.getDict()->ppszWords[it->iId],
-											it->fScore);
-				}
-
-				//reseting decoder in the background hypothesis
-				//so the long term runnig of the system saves memory
-				dec.reset();
-			}
+		//the interval is counted from the last checkpoint, so none is missed when the time does not hit its multiples
+		if(checkpoint_file[0] && checkpoint_interval && det.getTime() - checkpoint_time >= checkpoint_interval){
+			checkpoint_time = det.getTime();
+			ret = checkpoint(snap, checkpoint_file, fea, pScorer, det);
+			if(ret == EAR_FAIL){ fprintf(stderr, "Error writing checkpoint %s, checkpoints disabled\n", checkpoint_file); checkpoint_file[0] = '\0'; }
 		}
 	}
 
 
+	//decode the feature vectors waiting for the block scoring
+	//and pass the events not final until the end of the input
+	ret = det.finish();
+	if(ret == EAR_FAIL){ fprintf(stderr, "Error in processing input data\n"); return 1; }
+
+	//the input ended, the next run starts from the beginning
+	if(checkpoint_file[0]) remove(checkpoint_file);
+
 	//display final results with the background
 	if(!online){
-		result.clear();
-		dec.getResults(result);
-
 		printf("===================================results begin ========================================\n\n");
 		for(it = result.begin(); it != result.end(); it++){
 
-					printf("%f\t%f\t%s\t%f\n", (float)it->iRevIndex * fea_cfg.fShift_ms / 1000, 
-										   (float) it->iDur * fea_cfg.fShift_ms / 1000, 
-											res.getDict()->ppszWords[it->iId],
-											it->fScore);
+					printResult(&printer, *it);
 
 		}
 		printf("===================================results end ==========================================\n\n");
+
+		//display the alternative hypotheses from the best one
+		if(nbest > 1){
+			CNBest alternatives;
+			CNBest::iterator hyp;
+			unsigned int n = 1;
+
+			dec.getNBest(alternatives, nbest);
+			printf("===================================n-best begin =========================================\n\n");
+			for(hyp = alternatives.begin(); hyp != alternatives.end(); hyp++, n++){
+				printf("%u\t%f\n", n, hyp->fScore);
+				//the hypotheses are since the last reset of the decoder, the events before them are final
+				for(it = result.begin(); it != result.end() && !hyp->events.empty() && it->iRevIndex < hyp->events.front().iRevIndex; it++){
+					printResult(&printer, *it);
+				}
+				for(it = hyp->events.begin(); it != hyp->events.end(); it++){
+					if(det.accept(*it)) printResult(&printer, *it);
+				}
+				printf("\n");
+			}
+			printf("===================================n-best end ===========================================\n\n");
+		}
 	}
 
 	delete audio;
@@ -0,0 +1,520 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/time.h>
+#include <vector>
+
+#include "Data/Data.h"
+#include "Data/Config.h"
+#include "Data/DataReader.h"
+#include "Data/WavSource.h"
+#include "Search/AcousticScorer.h"
+#include "Search/MlpScorer.h"
+#include "Search/Search.h"
+#include "Search/BatchSearch.h"
+#include "Search/ActivityGate.h"
+#include "Search/Detector.h"
+#include "Features/Feature.h"
+
+#define WAV_READ_CHUNK	1000
+
+using namespace Ear;
+
+//one labeled event, from the reference or from the detector
+typedef struct
+{
+	float fStart;
+	float fEnd;
+	unsigned int iId;
+	float fConfidence;
+	bool bMatched;
+} event_t;
+
+//counts of the matched events for one label
+typedef struct
+{
+	unsigned int iHit;
+	unsigned int iMiss;
+	unsigned int iFalse;
+} count_t;
+
+//wall clock time in seconds
+static double now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+//keep the final event passed by the detector
+static void keepEvent(void *_pArg, const CResult &_event)
+{
+	((CResults*)_pArg)->push_back(_event);
+}
+
+//read reference labels in the form "<start> <duration> <label>" (times in seconds), the same as the output of the Ear
+static int readLabels(const char *_szFileName, EAR_Dict *_pDict, std::vector<event_t> &_events)
+{
+	char line[1024];
+	char label[1024];
+	float start, dur;
+	unsigned int i;
+	event_t e;
+	FILE *pIn = fopen(_szFileName, "r");
+
+	if(pIn == NULL) return EAR_FAIL;
+
+	while(fgets(line, sizeof(line), pIn)){
+		if(sscanf(line, "%f %f %1023s", &start, &dur, label) != 3) continue;
+
+		for(i = 0; i < _pDict->iSize; i++) if(_pDict->ppszWords[i] && strcmp(_pDict->ppszWords[i], label) == 0) break;
+		if(i == _pDict->iSize){ fprintf(stderr, "Unknown label %s in file %s\n", label, _szFileName); continue; }
+
+		e.fStart = start; e.fEnd = start + dur; e.iId = i; e.fConfidence = 1; e.bMatched = false;
+		_events.push_back(e);
+	}
+
+	fclose(pIn);
+	return EAR_SUCCESS;
+}
+
+//settings of the evaluation read from the configuration file
+typedef struct
+{
+	CFeature::Configuration fea;
+	CDetector::Configuration det;
+	unsigned int strip;
+	unsigned int dense;
+	unsigned int streams;
+	unsigned int nbest;
+	unsigned int lattice_alts;
+	float lattice_beam;
+	float confidence_scale;
+	float confidence_beam;
+	float confidence_min;
+	unsigned int confidence_window;
+	unsigned int skip;
+	unsigned int block;
+	unsigned int renorm;
+	unsigned int preroll;
+	float insertionPenalty;
+	int bcg_id;
+} settings_t;
+
+//the models and the decoding instances shared by all files
+typedef struct
+{
+	CDataHolder res;
+	EAR_Events *events;
+	CAcousticScorer scorer;
+	CMlpScorer mlp;
+	AScorer *pScorer;
+	CSearch dec;
+	CActivityGate gate;
+	CDetector det;
+	CBatchSearch batch;
+	CDataContainer *vectors;
+	CResults result;
+} decoder_t;
+
+//counts and times summed over all files
+typedef struct
+{
+	std::vector<count_t> counts;
+	double hit_confidence;
+	double false_confidence;
+	unsigned int files;
+	unsigned int hyps;
+	int64_t iFrames;
+	double elapsed;
+} summary_t;
+
+//read the settings of the search and the detection
+static void readSettings(CConfig &_cfg, settings_t &_set)
+{
+	_set.det.lookUp(_cfg);
+	_set.bcg_id = _set.det.iBackground;
+
+	_cfg.lookUpUInt("STRIP_OFFSET", &_set.strip, 0);
+	_cfg.lookUpFloat("INSERT_PENALTY", &_set.insertionPenalty, -100);
+	_cfg.lookUpUInt("DENSE_STATES", &_set.dense, SEARCH_DENSE_STATES);
+	_cfg.lookUpUInt("FRAME_SKIP", &_set.skip, 1);
+	_cfg.lookUpUInt("SCORE_BLOCK", &_set.block, 1);
+	_cfg.lookUpUInt("SCORE_RENORM", &_set.renorm, 0);
+	//the lattice is kept only for more than one best hypothesis
+	_cfg.lookUpUInt("NBEST", &_set.nbest, 0);
+	_cfg.lookUpUInt("LATTICE_ALTS", &_set.lattice_alts, 4);
+	_cfg.lookUpFloat("LATTICE_BEAM", &_set.lattice_beam, 10);
+	//the detections with lower confidence than the minimum are left out
+	_cfg.lookUpFloat("CONFIDENCE_SCALE", &_set.confidence_scale, 0);
+	_cfg.lookUpFloat("CONFIDENCE_BEAM", &_set.confidence_beam, 50);
+	_cfg.lookUpUInt("CONFIDENCE_WINDOW", &_set.confidence_window, 0);
+	_cfg.lookUpFloat("CONFIDENCE_MIN", &_set.confidence_min, 0);
+	_cfg.lookUpUInt("BATCH_STREAMS", &_set.streams, 1);
+	_cfg.lookUpUInt("GATE_PREROLL", &_set.preroll, 50);
+
+	//configuration for freature extraction
+	_set.fea.lookUp(_cfg);
+	_set.fea.iStrip = _set.strip;
+}
+
+//load the models and create the scorer
+static int loadModels(CConfig &_cfg, settings_t &_set, decoder_t &_dec)
+{
+	char model_bin[PATH_MAX];
+	char model_idx[PATH_MAX];
+	char score_form[100];
+	char gs_file[PATH_MAX];
+	char mlp_file[PATH_MAX];
+	char event_file[PATH_MAX];
+	unsigned int shortlist = 0;
+	unsigned int threads = 1;
+	float gs_floor = LOG_ZERO;
+	float mlp_scale = 1;
+	int ret = 0;
+
+	//load models and recognition network
+	_cfg.lookUpString("MODEL_IDX_FILE", model_idx, "model.idx");
+	_cfg.lookUpString("MODEL_BIN_FILE", model_bin, "model.bin");
+	ret = _dec.res.load(model_bin, model_idx);
+	if(ret == EAR_FAIL){ fprintf(stderr, "Error reading model and idx file\n"); return EAR_FAIL; }
+
+	//the insertion penalties and the thresholds of the single events
+	_cfg.lookUpString("EVENT_FILE", event_file, "");
+	if(event_file[0] != '\0'){
+		ret = _dec.res.loadEvents(event_file);
+		if(ret == EAR_FAIL){ fprintf(stderr, "Error reading event file %s\n", event_file); return EAR_FAIL; }
+		_dec.events = _dec.res.getEvents();
+	}
+
+	//create scorer for the search algorithm
+	//the coefficients that are not scored are removed from the model and the features
+	//Gaussian selection is indexed by the full model, so it is loaded before the coefficients are removed
+	_cfg.lookUpString("GS_FILE", gs_file, "");
+	if(gs_file[0] != '\0'){
+		ret = _dec.res.loadSelection(gs_file);
+		if(ret == EAR_FAIL){ fprintf(stderr, "Error reading Gaussian selection file %s\n", gs_file); return EAR_FAIL; }
+	}
+	ret = _dec.res.strip(_set.strip);
+	if(ret == EAR_FAIL){ fprintf(stderr, "Error removing %u coefficients from the model\n", _set.strip); return EAR_FAIL; }
+	_cfg.lookUpString("SCORE_FORM", score_form, "FOLDED");
+	_dec.scorer.setAcousticModel(_dec.res.getAcousticData(), 0, strcmp(score_form, "DOT") == 0 ? CAcousticScorer::DOT : CAcousticScorer::FOLDED);
+	//the scorer has its own table of the PDFs, the loaded variances and means are not needed any more
+	_dec.res.releasePdfs();
+	_cfg.lookUpString("MIXTURE", score_form, "MAX");
+	_dec.scorer.changeMixtureMode(strcmp(score_form, "SUM") == 0 ? CAcousticScorer::SUM : CAcousticScorer::MAX);
+	_cfg.lookUpUInt("GS_SHORTLIST", &shortlist, 0);
+	_cfg.lookUpFloat("GS_FLOOR", &gs_floor, LOG_ZERO);
+	_dec.scorer.setSelection(_dec.res.getAcousticData()->Selection, shortlist, gs_floor);
+	_cfg.lookUpUInt("SCORE_THREADS", &threads, 1);
+	_dec.scorer.changeThreads(threads);
+
+	//the neural network scores the states instead of their PDFs, the network refers to the same states
+	_cfg.lookUpString("MLP_FILE", mlp_file, "");
+	if(mlp_file[0] != '\0'){
+		ret = _dec.res.loadMlp(mlp_file);
+		if(ret == EAR_FAIL){ fprintf(stderr, "Error reading neural network file %s\n", mlp_file); return EAR_FAIL; }
+		_cfg.lookUpFloat("MLP_SCALE", &mlp_scale, 1);
+		_dec.mlp.setNetwork(_dec.res.getMlp(), mlp_scale);
+		_dec.pScorer = &_dec.mlp;
+	}
+
+	return EAR_SUCCESS;
+}
+
+//create the search, the streams of the batch and the detector
+static int createSearch(settings_t &_set, decoder_t &_dec)
+{
+	EAR_Events *events = _dec.events;
+	unsigned int i, j;
+	int ret = 0;
+
+	//create search algorithm instance
+	ret = _dec.dec.initialize(_dec.res.getFSTData(), _dec.pScorer, _set.insertionPenalty, _set.dense);
+	if(ret == EAR_FAIL){ fprintf(stderr, "Error creating search instance\n"); return EAR_FAIL; }
+	for(i = 0; events && i < events->iSize; i++) if(events->pEvents[i].bPenalty) _dec.dec.changeSymbolPenalty(i, events->pEvents[i].fPenalty);
+	_dec.dec.changeFrameSkip(_set.skip);
+	_dec.dec.changeBlockSize(_set.block);
+	_dec.dec.changeRenormalization(_set.renorm);
+	if(_set.nbest > 1) _dec.dec.changeLattice(_set.lattice_alts, _set.lattice_beam);
+	ret = _dec.dec.changeConfidence(_set.confidence_scale, _set.confidence_beam, _set.confidence_window);
+	if(ret == EAR_FAIL){ fprintf(stderr, "Error setting the confidence of the events\n"); return EAR_FAIL; }
+
+	//more streams decoded in lockstep by one scorer, each of them gets the same recording
+	if(_set.streams > 1){
+		ret = _dec.batch.initialize(_dec.res.getFSTData(), _dec.pScorer, _set.insertionPenalty, _set.streams, _set.dense);
+		if(ret == EAR_FAIL){ fprintf(stderr, "Error creating batch search instance for %u streams\n", _set.streams); return EAR_FAIL; }
+		//the streams are not controlled by the detector, only their committing is the same
+		for(i = 0; i < _set.streams; i++){
+			CSearch *stream = _dec.batch.getStream(i);
+
+			stream->changeCommit(_set.det.iStrategy == CDetector::Configuration::COMMIT);
+			if(_set.nbest > 1) stream->changeLattice(_set.lattice_alts, _set.lattice_beam);
+			stream->changeConfidence(_set.confidence_scale, _set.confidence_beam, _set.confidence_window);
+			stream->changeRenormalization(_set.renorm);
+			for(j = 0; events && j < events->iSize; j++) if(events->pEvents[j].bPenalty) stream->changeSymbolPenalty(j, events->pEvents[j].fPenalty);
+		}
+		_dec.vectors = new CDataContainer[_set.streams];
+	}
+
+	_dec.gate.initialize(&_dec.dec, _set.preroll);
+	//the detector passes the events of the single stream, it is evaluated the same way as in the Ear
+	_dec.det.initialize(&_dec.dec, &_dec.gate, _set.det, keepEvent, &_dec.result);
+
+	//the thresholds of the events are kept by the detector, the minimum durations are in the feature vectors
+	for(i = 0; events && i < events->iSize; i++)
+		_dec.det.changeThreshold(i, events->pEvents[i].fMinScore, (unsigned int)(events->pEvents[i].fMinDur_ms / _set.fea.fShift_ms + 0.5f));
+
+	return EAR_SUCCESS;
+}
+
+//decode the whole file by the detector, returns the number of the feature vectors
+static int64_t decodeStream(decoder_t &_dec, CFeature &_fea)
+{
+	CDataContainer data;
+	int64_t iTime = 0;
+	int ret = 0;
+
+	while(1)
+	{
+		_fea.getData(data);
+		if(data.size() == 0) break;
+
+		ret = _dec.det.process(data, _fea.isActive()); iTime++;
+		if(ret == EAR_FAIL) return -1;
+	}
+
+	//the vectors waiting for the block scoring and the events not passed yet
+	ret = _dec.det.finish();
+	if(ret == EAR_FAIL) return -1;
+	return iTime;
+}
+
+//decode the whole file by the streams of the batch, the frames without activity are skipped without the pre-roll of the gate
+static int64_t decodeBatch(settings_t &_set, decoder_t &_dec, CFeature &_fea)
+{
+	CDataContainer data;
+	unsigned int i;
+	int64_t iTime = 0;
+	int ret = 0;
+
+	_dec.batch.reset();
+	while(1)
+	{
+		_fea.getData(data);
+		if(data.size() == 0) break;
+
+		for(i = 0; i < _set.streams; i++){
+			if(_fea.isActive()) _dec.vectors[i].copy(&data);
+			else _dec.vectors[i].clear();
+		}
+		ret = _dec.batch.process(_dec.vectors, iTime); iTime++;
+		if(ret == EAR_FAIL) return -1;
+	}
+
+	//all streams have the same results, the first one is evaluated
+	_dec.batch.getStream(0)->getResults(_dec.result);
+	return iTime;
+}
+
+//match the detected events with the reference ones of one file and count them
+static void matchEvents(settings_t &_set, decoder_t &_dec, std::vector<event_t> &_ref, summary_t &_sum)
+{
+	std::vector<event_t> hyp;
+	CResults::iterator it;
+	unsigned int i, j;
+
+	//convert the detected events to seconds, the background is not evaluated
+	for(it = _dec.result.begin(); it != _dec.result.end(); it++){
+		if((int)it->iId == _set.bcg_id) continue;
+		if(_set.confidence_scale > 0 && it->fConfidence < _set.confidence_min) continue;
+		//the events of the detector passed the thresholds already, the ones of the streams did not
+		if(_set.streams > 1 && !_dec.det.accept(*it)) continue;
+
+		event_t e;
+		e.fStart = (float)it->iRevIndex * _set.fea.fShift_ms / 1000;
+		e.fEnd = e.fStart + (float)it->iDur * _set.fea.fShift_ms / 1000;
+		e.iId = it->iId; e.fConfidence = it->fConfidence; e.bMatched = false;
+		hyp.push_back(e);
+	}
+
+	//the detected event is a hit if it overlaps an unmatched reference event with the same label
+	for(i = 0; i < hyp.size(); i++){
+		for(j = 0; j < _ref.size(); j++){
+			if(_ref[j].bMatched || _ref[j].iId != hyp[i].iId) continue;
+			if(hyp[i].fStart >= _ref[j].fEnd || _ref[j].fStart >= hyp[i].fEnd) continue;
+
+			_ref[j].bMatched = hyp[i].bMatched = true;
+			break;
+		}
+
+		if(hyp[i].bMatched) { _sum.counts[hyp[i].iId].iHit++; _sum.hit_confidence += hyp[i].fConfidence; }
+		else { _sum.counts[hyp[i].iId].iFalse++; _sum.false_confidence += hyp[i].fConfidence; }
+	}
+
+	for(j = 0; j < _ref.size(); j++){
+		if((int)_ref[j].iId == _set.bcg_id) continue;
+		if(!_ref[j].bMatched) _sum.counts[_ref[j].iId].iMiss++;
+	}
+}
+
+//display the summary
+static void printSummary(settings_t &_set, decoder_t &_dec, summary_t &_sum)
+{
+	count_t total = {0, 0, 0};
+	unsigned int i;
+
+	printf("%-16s %8s %8s %8s %10s %10s %10s\n", "label", "hits", "misses", "false", "precision", "recall", "f1");
+	for(i = 0; i < _sum.counts.size(); i++){
+		if((int)i == _set.bcg_id) continue;
+		if(_sum.counts[i].iHit + _sum.counts[i].iMiss + _sum.counts[i].iFalse == 0) continue;
+
+		total.iHit += _sum.counts[i].iHit; total.iMiss += _sum.counts[i].iMiss; total.iFalse += _sum.counts[i].iFalse;
+	}
+
+	for(i = 0; i <= _sum.counts.size(); i++){
+		count_t *c = i < _sum.counts.size() ? &_sum.counts[i] : &total;
+		const char *name = i < _sum.counts.size() ? _dec.res.getDict()->ppszWords[i] : "total";
+
+		if(i < _sum.counts.size() && (int)i == _set.bcg_id) continue;
+		if(c->iHit + c->iMiss + c->iFalse == 0) continue;
+
+		float p = c->iHit + c->iFalse ? (float)c->iHit / (c->iHit + c->iFalse) : 0;
+		float r = c->iHit + c->iMiss ? (float)c->iHit / (c->iHit + c->iMiss) : 0;
+		float f = p + r > 0 ? 2 * p * r / (p + r) : 0;
+
+		printf("%-16s %8u %8u %8u %10.4f %10.4f %10.4f\n", name ? name : "", c->iHit, c->iMiss, c->iFalse, p, r, f);
+	}
+
+	double duration = (double)_sum.iFrames * _set.fea.fShift_ms / 1000;
+	printf("\nfiles %u, audio %.2f s, processing %.3f s, real-time factor %.5f\n", _sum.files, duration, _sum.elapsed, duration > 0 ? _sum.elapsed / duration : 0);
+	if(_set.streams > 1) printf("streams %u, real-time factor per stream %.5f\n", _set.streams, duration > 0 ? _sum.elapsed / duration / _set.streams : 0);
+	if(_set.confidence_scale > 0) printf("mean confidence of hits %.4f, false alarms %.4f\n", total.iHit ? _sum.hit_confidence / total.iHit : 0, total.iFalse ? _sum.false_confidence / total.iFalse : 0);
+	if(_set.nbest > 1) printf("best hypotheses per file %.2f (at most %u)\n", _sum.files > 0 ? (float)_sum.hyps / _sum.files : 0, _set.nbest);
+	if(_set.streams == 1){
+		//the latency and the memory of the detection strategy
+		CDetector::Statistics &stats = _dec.det.getStatistics();
+		const char *strategies[] = {"OFFLINE", "BACKGROUND", "COMMIT"};
+		printf("detection %s, events %u, rejected %u, resets %u, latency mean %.3f s, max %.3f s, peak traceback %u records (%.1f kB)\n",
+			strategies[_set.det.iStrategy], stats.iEvents, stats.iRejected, stats.iResets,
+			stats.getMeanLatency() * _set.fea.fShift_ms / 1000, (double)stats.iMaxLatency * _set.fea.fShift_ms / 1000,
+			stats.iPeakTrace, stats.iPeakTrace * sizeof(CTraceRecord) / 1024.0);
+	}
+	if(_dec.pScorer == &_dec.scorer) printf("Gaussians evaluated per frame %.2f\n", _sum.iFrames > 0 ? (double)_dec.scorer.getEvaluated() / _sum.iFrames : 0);
+}
+
+int main(int argc, char* argv[])
+{
+	CConfig cfg;
+	settings_t set;
+	decoder_t *dec = NULL;
+	summary_t sum;
+	char wav[PATH_MAX];
+	char lab[PATH_MAX];
+	char line[2 * PATH_MAX];
+	CNBest alternatives;
+	std::vector<event_t> ref;
+	count_t zero = {0, 0, 0};
+	FILE *pList = NULL;
+	int ret = 0;
+	unsigned int i;
+	int64_t iTime = 0;
+	double start;
+
+	if(argc < 3 || argc % 2 == 0){
+		fprintf(stderr, "Usage:\n\t%s <configuration file> <list file> [<property> <value> ...]\n", argv[0]);
+		fprintf(stderr, "\t each line of the list file contains a wav file and its reference label file\n");
+		fprintf(stderr, "\t <wav file> <label file>, the labels are in the form <start> <duration> <label> in seconds\n");
+		fprintf(stderr, "\t the properties given after the list file replace the ones from the configuration file\n");
+		return 1;
+	}
+
+	//load configuration file
+	ret = cfg.load(argv[1]);
+	if(ret == EAR_FAIL){ fprintf(stderr, "Error reading configuration file\n"); return 1; }
+
+	//the properties from the command-line, so more settings can be compared with the same configuration file
+	for(i = 3; i + 1 < (unsigned int)argc; i += 2) cfg.set(argv[i], argv[i + 1]);
+	readSettings(cfg, set);
+
+	//the instances are large, they are not kept on the stack
+	dec = new decoder_t;
+	dec->events = NULL; dec->pScorer = &dec->scorer; dec->vectors = NULL;
+	if(loadModels(cfg, set, *dec) == EAR_FAIL || createSearch(set, *dec) == EAR_FAIL) return 1;
+
+	sum.counts.assign(dec->res.getDict()->iSize, zero);
+	sum.hit_confidence = 0; sum.false_confidence = 0;
+	sum.files = 0; sum.hyps = 0; sum.iFrames = 0; sum.elapsed = 0;
+
+	pList = fopen(argv[2], "r");
+	if(pList == NULL){ fprintf(stderr, "Error opening list file %s\n", argv[2]); return 1; }
+
+	//process all files in the list
+	while(fgets(line, sizeof(line), pList))
+	{
+		if(sscanf(line, "%s %s", wav, lab) != 2) continue;
+
+		ref.clear();
+		ret = readLabels(lab, dec->res.getDict(), ref);
+		if(ret == EAR_FAIL){ fprintf(stderr, "Error reading label file %s\n", lab); continue; }
+
+		CWavSource audio(WAV_READ_CHUNK);
+		ret = audio.load(wav);
+		if(ret == EAR_FAIL){ fprintf(stderr, "Error loading wav file from file %s\n", wav); continue; }
+
+		//new frontend for each file, so no state is carried between them
+		CFeature fea;
+		fea.initialize(set.fea);
+		fea.setSource(&audio);
+
+		dec->result.clear();
+		dec->det.start();
+		dec->pScorer->reset();
+
+		//decode whole file, loading of the files is not measured
+		start = now();
+		iTime = set.streams > 1 ? decodeBatch(set, *dec, fea) : decodeStream(*dec, fea);
+		if(iTime < 0){ fprintf(stderr, "Error in processing input data\n"); return 1; }
+
+		//the alternative hypotheses are only counted, their reading is part of the processing time
+		if(set.nbest > 1){
+			if(set.streams > 1) dec->batch.getStream(0)->getNBest(alternatives, set.nbest);
+			else dec->dec.getNBest(alternatives, set.nbest);
+			sum.hyps += alternatives.size();
+		}
+		sum.elapsed += now() - start;
+		sum.iFrames += iTime;
+		sum.files++;
+
+		matchEvents(set, *dec, ref, sum);
+	}
+
+	fclose(pList);
+
+	printSummary(set, *dec, sum);
+	if(dec->vectors) delete[] dec->vectors;
+	delete dec;
+
+	return 0;
+}
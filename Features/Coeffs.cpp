@@ -18,6 +18,7 @@
  */
 
 #include "Coeffs.h"
+#include "../Data/Snapshot.h"
 #include <math.h>
 
 using namespace Ear;
@@ -83,7 +84,7 @@ void CDelta::getData(CDataContainer &_pData)
 	_pData.copy(m_pBuffer[m_iWin]);
 
   /// extend its length
-	_pData.reserve((m_iOrd+1)*m_iSize); _pData.size() = (m_iOrd+1)*m_iSize;
+	_pData.resize((m_iOrd+1)*m_iSize);
 
   /// compute the coefficients
 	for(i=(m_iOrd-1)*m_iSize;i<m_iOrd*m_iSize;i++)
@@ -106,6 +107,23 @@ void CDelta::rotate()
     m_pBuffer[0] = tmp;
 }
 
+unsigned int CDelta::save(CSnapshot &_snap)
+{
+	_snap.write(&m_iWin, sizeof(m_iWin)); _snap.write(&m_iOrd, sizeof(m_iOrd));
+	_snap.write(&iDummy, sizeof(iDummy)); _snap.write(&m_iSize, sizeof(m_iSize));
+  /// the buffer is written in its current order, the rotation is not needed to be remembered
+	for(unsigned int i=0;i<m_iBf;i++) _snap.write(*(m_pBuffer[i]));
+	return EAR_SUCCESS;
+}
+
+unsigned int CDelta::restore(CSnapshot &_snap)
+{
+	if(_snap.check(m_iWin) == EAR_FAIL || _snap.check(m_iOrd) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(&iDummy, sizeof(iDummy)) == EAR_FAIL || _snap.read(&m_iSize, sizeof(m_iSize)) == EAR_FAIL) return EAR_FAIL;
+	for(unsigned int i=0;i<m_iBf;i++) if(_snap.read(*(m_pBuffer[i])) == EAR_FAIL) return EAR_FAIL;
+	return EAR_SUCCESS;
+}
+
 CEnergy::CEnergy() : AAuxDataProcessor()
 {
 	m_fEnergy = 0.0;
@@ -130,6 +148,71 @@ void CEnergy::getAuxData(CDataContainer &_pData)
 	_pData[0] = m_fEnergy; _pData.size() = 1;
 }
 
+CActivity::CActivity(float _fEnergy, float _fFlux, unsigned int _iHang) : AAuxDataProcessor()
+{
+	m_fEnergy = _fEnergy; m_fFlux = _fFlux; m_iHang = _iHang;
+  /// the activity is held at the beginning, so the decoder settles and the noise floor adapts
+	m_fFloor = 0.0; m_iCount = _iHang + 1; m_bInit = false;
+}
+
+CActivity::~CActivity()
+{
+}
+
+void CActivity::getData(CDataContainer &_pData)
+{
+	unsigned int i; float e, flux = 0.0, sum = 0.0;
+
+  /// get the spectrum, nothing to decide on empty container
+	actualize(_pData); if(!_pData.size()){return;}
+
+  /// get the energy of the same frame, silent frames are having minus infinity here
+	m_tmp.clear(); actualizeAux(m_tmp);
+	e = m_tmp.size() ? m_tmp[0] : 0.0; if(!(e > 0.0)) e = 0.0;
+
+  /// first frame initializes the noise floor and the smoothed spectrum
+	if(!m_bInit || m_avg.size() != _pData.size())
+	{
+		m_fFloor = e; m_avg.copy(&_pData); m_bInit = true;
+	}
+
+  /// spectral flux, positive changes against the smoothed spectrum normalized by its magnitude
+	for(i=0;i<_pData.size();i++)
+	{
+		if(_pData[i] > m_avg[i]) flux += _pData[i] - m_avg[i];
+		sum += m_avg[i];
+		m_avg[i] = 0.9 * m_avg[i] + 0.1 * _pData[i];
+	}
+	if(sum > 0.0) flux /= sum;
+
+  /// noise floor follows the minimum immediately and rises slowly otherwise
+	if(e < m_fFloor) m_fFloor = e; else m_fFloor += 0.001 * (e - m_fFloor);
+
+  /// start or prolong the hangover if any of the measures is above threshold
+	if(e - m_fFloor > m_fEnergy || flux > m_fFlux) m_iCount = m_iHang + 1;
+	else if(m_iCount) m_iCount--;
+}
+
+void CActivity::getAuxData(CDataContainer &_pData)
+{
+	_pData.reserve(1); _pData.clear();
+	_pData[0] = isActive() ? 1.0 : 0.0; _pData.size() = 1;
+}
+
+unsigned int CActivity::save(CSnapshot &_snap)
+{
+	_snap.write(&m_bInit, sizeof(m_bInit)); _snap.write(&m_fFloor, sizeof(m_fFloor)); _snap.write(&m_iCount, sizeof(m_iCount));
+	_snap.write(m_avg);
+	return EAR_SUCCESS;
+}
+
+unsigned int CActivity::restore(CSnapshot &_snap)
+{
+	if(_snap.read(&m_bInit, sizeof(m_bInit)) == EAR_FAIL || _snap.read(&m_fFloor, sizeof(m_fFloor)) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(&m_iCount, sizeof(m_iCount)) == EAR_FAIL) return EAR_FAIL;
+	return _snap.read(m_avg);
+}
+
 CZeroCoef::CZeroCoef() : AAuxDataProcessor()
 {
 	m_fC0 = 0.0;
@@ -77,6 +77,14 @@ namespace Ear
     * @param [in, out] _pData Container to be filled with new data
     */
 		void getData(CDataContainer &_pData);
+    /// Write the buffered frames to the snapshot
+    /// @param [in, out] _snap the snapshot
+    /// @return success of the writing
+		unsigned int save(CSnapshot &_snap);
+    /// Read the buffered frames from the snapshot
+    /// @param [in, out] _snap the snapshot
+    /// @return EAR_FAIL if the snapshot was written by processor of different setting
+		unsigned int restore(CSnapshot &_snap);
 
 	private:
     /// rotate function for internal buffer
@@ -109,6 +117,59 @@ namespace Ear
 		float m_fEnergy; ///< for remembering the last computed energy coefficient
 	};
 
+  /**
+  * Activity detector of the input signal. The processor is placed after the spectral analysis and
+  * does not change the data passing through it. It combines the frame energy, received from the
+  * additional source (<i>CEnergy</i>), with the spectral flux of the magnitude spectrum. The energy is
+  * compared against slowly adapting noise floor, the flux against the smoothed spectrum of the previous
+  * frames. When any of them exceeds its threshold the activity is signaled and held for the hangover
+  * number of frames.
+  */
+	class CActivity : public AAuxDataProcessor
+	{
+	public:
+    /**
+    * Initialize the detector.
+    * @param [in] _fEnergy threshold of the log energy above the noise floor (natural log, 2.3 equals to 10dB)
+    * @param [in] _fFlux threshold of the normalized spectral flux
+    * @param [in] _iHang number of frames the activity is held after the last detection
+    */
+		CActivity(float _fEnergy, float _fFlux, unsigned int _iHang);
+		virtual ~CActivity();
+
+	private:
+		CDataContainer m_tmp; ///< container for the energy received from additional source
+		CDataContainer m_avg; ///< smoothed magnitude spectrum of the previous frames
+		float m_fEnergy; ///< energy threshold above the noise floor
+		float m_fFlux; ///< spectral flux threshold
+		float m_fFloor; ///< tracked noise floor of the log energy
+		unsigned int m_iHang; ///< hangover length in frames
+		unsigned int m_iCount; ///< remaining frames of the hangover
+		bool m_bInit; ///< whether the noise floor and the smoothed spectrum were initialized
+
+	public:
+    /**
+    * Get new data, updates the activity decision. The data from previous processor are returned unchanged.
+    * @param [in, out] _pData Container to be filled with new data
+    */
+		void getData(CDataContainer &_pData);
+    /**
+    * Get the activity decision of the last frame (one number, 1.0 for activity, 0.0 otherwise)
+    * @param [in, out] _pData Container to be filled with the decision
+    */
+		void getAuxData(CDataContainer &_pData);
+    /// @return true if the activity was detected in the last frame or the hangover is running
+		bool isActive(){ return m_iCount > 0; }
+    /// Write the noise floor, the smoothed spectrum and the hangover to the snapshot
+    /// @param [in, out] _snap the snapshot
+    /// @return success of the writing
+		unsigned int save(CSnapshot &_snap);
+    /// Read the state of the detector from the snapshot
+    /// @param [in, out] _snap the snapshot
+    /// @return EAR_FAIL if the snapshot is shorter
+		unsigned int restore(CSnapshot &_snap);
+	};
+
   /**
   * Computing zero MFCC coefficient, that is in reality similar to the energy one.
   */
@@ -21,19 +21,56 @@
 #include <stdio.h>
 
 #include "../Data/Data.h"
+#include "../Data/Config.h"
 #include "Frame.h"
 #include "Feature.h"
 #include "Transform.h"
 #include "Filter.h"
 #include "Coeffs.h"
+#include "Parallel.h"
+#include "../Data/Snapshot.h"
 
 using namespace Ear;
 
+void CFeature::Configuration::lookUp(CConfig &_cfg)
+{
+  char frn_type[100];
+
+  _cfg.lookUpBool("ZERO_COEF", &bC0, false);
+  _cfg.lookUpBool("ENERGY", &bEnergy, false);
+  _cfg.lookUpBool("RAW_ENERGY", &bRawE, false);
+  _cfg.lookUpFloat("HAMMING", &fHam, 0.46);
+  _cfg.lookUpFloat("WND_LENGTH", &fLength_ms, 25);
+  _cfg.lookUpFloat("PREEM", &fPreem, 0.97);
+  _cfg.lookUpFloat("WND_SHIFT", &fShift_ms, 10);
+  _cfg.lookUpUInt("ACC_WND", &iAccWin, 2);
+  _cfg.lookUpUInt("CEP_NUM", &iCep, 12);
+  _cfg.lookUpUInt("DEL_WND", &iDelWin, 2);
+  _cfg.lookUpUInt("HI_FREQ", &iHiFreq_hz, UINT_MAX);
+  _cfg.lookUpUInt("LO_FREQ", &iLoFreq_hz, 0);
+  _cfg.lookUpUInt("LIFT_COEF", &iLift, 22);
+  _cfg.lookUpUInt("MEL_NUM", &iMel, 29);
+  _cfg.lookUpUInt("CMN_WND", &iCMNWin, 0);
+  _cfg.lookUpBool("GATE", &bGate, false);
+  _cfg.lookUpFloat("GATE_ENERGY", &fGateEnergy, 2.3);
+  _cfg.lookUpFloat("GATE_FLUX", &fGateFlux, 1.0);
+  _cfg.lookUpUInt("GATE_HANG", &iGateHang, 30);
+  _cfg.lookUpUInt("OFFLINE_THREADS", &iThreads, 1);
+
+  /// type of the features
+  _cfg.lookUpString("FRONT_END_TYPE", frn_type, "MFCC");
+  if(strcmp(frn_type, "MFCC") == 0) iType = MFCC;
+  if(strcmp(frn_type, "MELSPEC") == 0) iType = MELSPEC;
+  if(strcmp(frn_type, "FBANK") == 0) iType = FBANK;
+  if(strcmp(frn_type, "DIRECT") == 0) iType = DIRECT;
+}
+
 CFeature::CFeature() : ADataProcessor()
 {
   /// no processor added
   m_pLast = NULL;
   m_pFirst = NULL;
+  m_pActivity = NULL;
 }
 
 CFeature::~CFeature()
@@ -60,6 +97,11 @@ ADataProcessor* CFeature::getSource()
     return m_pFirst->getSource();
 }
 
+bool CFeature::isActive()
+{
+    return m_pActivity ? m_pActivity->isActive() : true;
+}
+
 unsigned int CFeature::initialize(Configuration &_cfg)
 {
   /// if the frontend was initialized before, return fail
@@ -73,20 +115,28 @@ unsigned int CFeature::initialize(Configuration &_cfg)
 	/// check the type of the features to compute
 	if(_cfg.iType > 4) {/*printf("Wrong front-end type\n");*/ return EAR_FAIL;}
 
+  /// the frame based part of the computation is done on more threads for the whole input at once (not with the activity detection
+  /// that depends on the previous frames)
+  if(_cfg.iType != Configuration::DIRECT && _cfg.iThreads > 1 && !_cfg.bGate)
+  {
+    tmp = new CParallel(_cfg, _cfg.iThreads); addProcessor(tmp);
+  }
 	/// if this is not DIRECT frontend, but all the computation is needed
-  if(_cfg.iType != Configuration::DIRECT)
+  else if(_cfg.iType != Configuration::DIRECT)
 	{
 	  /// Create frame from input signal
     tmp = new CFrame(_cfg.fLength_ms, _cfg.fShift_ms); addProcessor(tmp);
     /// Compute raw energy if desired
-    if(_cfg.bEnergy && _cfg.bRawE) {energy = new CEnergy(); addProcessor(energy);}
+    if((_cfg.bEnergy || _cfg.bGate) && _cfg.bRawE) {energy = new CEnergy(); addProcessor(energy);}
     /// Compute preemphasis
     if(_cfg.fPreem > 0){tmp = new CPreem(_cfg.fPreem); addProcessor(tmp);}
     tmp = new CWindow(_cfg.fHam); addProcessor(tmp);
     /// Compute energy if needed
-    if(_cfg.bEnergy && !_cfg.bRawE) {energy = new CEnergy(); addProcessor(energy);}
+    if((_cfg.bEnergy || _cfg.bGate) && !_cfg.bRawE) {energy = new CEnergy(); addProcessor(energy);}
     /// Spectral analysis
     tmp = new CFourier(); addProcessor(tmp);
+    /// Activity detection from the energy and the spectrum
+    if(_cfg.bGate) {m_pActivity = new CActivity(_cfg.fGateEnergy, _cfg.fGateFlux, _cfg.iGateHang); m_pActivity->setAuxSource(energy); addProcessor(m_pActivity);}
     /// Mel filter bank
     tmp = new CMelBank(_cfg.iLoFreq_hz, _cfg.iHiFreq_hz, _cfg.iMel, _cfg.iType != Configuration::MELSPEC); addProcessor(tmp);
     /// compute zero coefficent if required
@@ -102,13 +152,16 @@ unsigned int CFeature::initialize(Configuration &_cfg)
 
     /// Concatenate the zero cefficient and energy
     if(c0)		{tmp = new CConcat(); ((AAuxDataProcessor*)tmp)->setAuxSource(c0); addProcessor(tmp);}
-    if(energy)	{tmp = new CConcat(); ((AAuxDataProcessor*)tmp)->setAuxSource(energy); addProcessor(tmp);}
+    if(_cfg.bEnergy)	{tmp = new CConcat(); ((AAuxDataProcessor*)tmp)->setAuxSource(energy); addProcessor(tmp);}
 	}
 
   /// Compute delta coeffs and acceleration
 	if(_cfg.iDelWin) {tmp = new CDelta(_cfg.iDelWin,1); addProcessor(tmp); }
   if(_cfg.iDelWin && _cfg.iAccWin) {tmp = new CDelta(_cfg.iAccWin,2); addProcessor(tmp); }
 
+  /// Remove the coefficients that are not scored, the delta coefficients may still need them, but the mean normalization does not
+  if(_cfg.iStrip) {tmp = new CStrip(_cfg.iStrip); addProcessor(tmp); }
+
   /// Compute cepstral mean normalization
   if(_cfg.iCMNWin != 0) {tmp = new CCMN(_cfg.iCMNWin); addProcessor(tmp); }
 
@@ -116,6 +169,33 @@ unsigned int CFeature::initialize(Configuration &_cfg)
 	return EAR_SUCCESS;
 }
 
+unsigned int CFeature::save(CSnapshot &_snap)
+{
+	ADataProcessor *tmp = m_pLast;
+
+  /// walk the chain from the last processor to the first one, the restore walks it in the same order
+	while(tmp)
+	{
+		if(tmp->save(_snap) == EAR_FAIL) return EAR_FAIL;
+		if(tmp == m_pFirst) break;
+		tmp = tmp->getSource();
+	}
+	return EAR_SUCCESS;
+}
+
+unsigned int CFeature::restore(CSnapshot &_snap)
+{
+	ADataProcessor *tmp = m_pLast;
+
+	while(tmp)
+	{
+		if(tmp->restore(_snap) == EAR_FAIL) return EAR_FAIL;
+		if(tmp == m_pFirst) break;
+		tmp = tmp->getSource();
+	}
+	return EAR_SUCCESS;
+}
+
 void CFeature::getData(CDataContainer &_pData)
 {
   /// ask last processor for new data
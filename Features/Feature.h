@@ -29,6 +29,9 @@
 
 namespace Ear
 {
+  class CActivity;
+  class CConfig;
+
   /**
   * Top level signal preprocessing class, computing features to enter the recognition/detection
   * process. This class is capable to create frontends with MFCC, MELSPEC and FBANK features.
@@ -57,8 +60,15 @@ namespace Ear
           iMel = 29; iCep = 12; iLift = 22; iAccWin = 2; iDelWin = 2;
           bRawE = 0; bC0 = 1; bEnergy = 0;
           iType = MFCC; iCMNWin = 0;
+          bGate = 0; fGateEnergy = 2.3; fGateFlux = 1.0; iGateHang = 30;
+          iThreads = 1; iStrip = 0;
         }
 
+        /// Read the settings from the configuration file. Properties missing in the file are set to the defaults
+        /// of the configuration file (these differ from the defaults of this class for the zero coefficient)
+        /// @param [in] _cfg loaded configuration file
+        void lookUp(CConfig &_cfg);
+
       public:
           float fLength_ms; ///< window length
           float fShift_ms; ///< window shift
@@ -76,6 +86,12 @@ namespace Ear
           bool bC0; ///< compute the zero MFCC
           bool bEnergy; ///< compute energy coefficient
           unsigned int iType; ///< compute this type of features (MELSPEC, FBANK,  MFCC, DIRECT).
+          bool bGate; ///< detect activity in the input signal (see CActivity)
+          float fGateEnergy; ///< activity threshold of the log energy above the noise floor
+          float fGateFlux; ///< activity threshold of the normalized spectral flux
+          unsigned int iGateHang; ///< frames to hold the activity after last detection
+          unsigned int iThreads; ///< threads computing the features of the whole input at once (see CParallel), 1 for sequential processing
+          unsigned int iStrip; ///< remove first coefficients of the output vector that are not scored (see CStrip), not read from the configuration file
       };
 
     public:
@@ -96,10 +112,24 @@ namespace Ear
     /// Returning last set processor source for this preprocessing
     /// @return pointer to the previous processor.
 		ADataProcessor* getSource();
+    /// Returns activity decision of the input signal. The decision belongs to the last frame read from the source,
+    /// so it runs ahead of the output vectors by the delay of the delta and CMN computation. The hangover should be
+    /// longer than this delay.
+    /// @return true if the activity detection is not configured or the activity was detected
+		bool isActive();
+    /// Write the state of all processors of the chain to the snapshot, the source is not included
+    /// @param [in, out] _snap the snapshot
+    /// @return EAR_FAIL if any of the processors can not be saved
+		unsigned int save(CSnapshot &_snap);
+    /// Read the state of the processors of the chain written by <i>save</i>, the chain needs to be initialized the same way
+    /// @param [in, out] _snap the snapshot
+    /// @return EAR_FAIL if the snapshot does not match the chain
+		unsigned int restore(CSnapshot &_snap);
 
 	private:
 		ADataProcessor *m_pLast;  ///< last processor in the processing chain. This is called for new data
     ADataProcessor *m_pFirst; ///< first processor in the processing chain. This is set with the source of new data
+    CActivity *m_pActivity; ///< activity detector in the processing chain if configured
 
 	private:
     /// Helper function to add new processor into the chain
@@ -18,6 +18,7 @@
  */
 
 #include "Filter.h"
+#include "../Data/Snapshot.h"
 #include <math.h>
 #include <limits.h>
 #include <stdio.h>
@@ -91,7 +92,7 @@ void CMelBank::getData(CDataContainer &_pData)
 	//b++;
 
 	/// get new data for processing
-	m_tmp.clear(); m_tmp.size() = 0; actualize(m_tmp);
+	m_tmp.clear(); actualize(m_tmp);
   /// no data, then return empty
 	if(!m_tmp.size()) {_pData.clear(); return;}
 
@@ -103,8 +104,8 @@ void CMelBank::getData(CDataContainer &_pData)
 	  f.init(m_tmp.size(), 1/((float)m_tmp.size() * ((int)(1.0E7/m_iFreq))/1.0E7));
 	}
 
-	/// of the output container
-	_pData.reserve(f.chans()); _pData.clear();
+	/// of the output container, the filters are accumulated to zeroed output
+	_pData.resize(f.chans()); _pData.zero();
 
 	//printf("%d\n", b);
 
@@ -123,9 +124,6 @@ void CMelBank::getData(CDataContainer &_pData)
 		}
 	}
 
-  /// the output is the same as number of filters
-	_pData.size() = f.chans();
-
 	/// compute the logs of the output coefficients if needed
   if(m_bLogs)
   {
@@ -269,7 +267,7 @@ CCMN::CCMN(unsigned int _iWin) : ADataProcessor()
 
 CCMN::~CCMN()
 {
-	for(unsigned int i=0;i<m_iWin;i++) delete[] m_pBuffer[i];
+	for(unsigned int i=0;i<m_iWin;i++) delete m_pBuffer[i];
 	delete[] m_pBuffer;
 	delete m_pMean;
 	//delete m_pVar;
@@ -292,7 +290,7 @@ void CCMN::getData(CDataContainer &_pData)
       /// get the size of the vectors and reserve space for mean
       /// if there is not enough data to process, return empty container
       if(!m_pBuffer[m_iWrite]->size()) {_pData.size() = 0; return;}
-      m_pMean->reserve(m_pBuffer[m_iWrite]->size());
+      if(m_iWrite == 0) {m_pMean->resize(m_pBuffer[m_iWrite]->size()); m_pMean->zero();}
 
       /// compute the mean (actually only add the vectors together now and divide by number of the vectors in buffer later)
       /// Using this method we can subtract the vector that is about to be removed from buffer and add new one, instead
@@ -315,8 +313,9 @@ void CCMN::getData(CDataContainer &_pData)
     m_iWrite++;
     if(m_iWrite >= m_iWin) m_iWrite -= m_iWin; /// the cursors goes in circles
 
-    /// remove the the old vector that is about to be actualized
-    for(j=0;j<_pData.size();j++)
+    /// remove the the old vector that is about to be actualized (the mean has the size of the vectors,
+    /// the output container is not used for it, so the processor does not depend on what the caller passes)
+    for(j=0;j<m_pMean->size();j++)
     {
       (*(m_pMean))[j] -= (*(m_pBuffer[m_iWrite]))[j];
     }
@@ -350,3 +349,45 @@ void CCMN::getData(CDataContainer &_pData)
   /// FIX: maybe this should be set permanently after that
   if(m_iRead >= m_iWin/2){m_bDel = true;}
 }
+
+unsigned int CCMN::save(CSnapshot &_snap)
+{
+	_snap.write(&m_iWin, sizeof(m_iWin));
+	_snap.write(&m_iRead, sizeof(m_iRead)); _snap.write(&m_iWrite, sizeof(m_iWrite));
+	_snap.write(&m_bInit, sizeof(m_bInit)); _snap.write(&m_bDel, sizeof(m_bDel));
+	_snap.write(*m_pMean);
+	for(unsigned int i=0;i<m_iWin;i++) _snap.write(*(m_pBuffer[i]));
+	return EAR_SUCCESS;
+}
+
+unsigned int CCMN::restore(CSnapshot &_snap)
+{
+	if(_snap.check(m_iWin) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(&m_iRead, sizeof(m_iRead)) == EAR_FAIL || _snap.read(&m_iWrite, sizeof(m_iWrite)) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(&m_bInit, sizeof(m_bInit)) == EAR_FAIL || _snap.read(&m_bDel, sizeof(m_bDel)) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(*m_pMean) == EAR_FAIL) return EAR_FAIL;
+	for(unsigned int i=0;i<m_iWin;i++) if(_snap.read(*(m_pBuffer[i])) == EAR_FAIL) return EAR_FAIL;
+	return EAR_SUCCESS;
+}
+
+CStrip::CStrip(unsigned int _iOffset) : ADataProcessor()
+{
+  m_iOffset = _iOffset;
+}
+
+CStrip::~CStrip()
+{
+}
+
+void CStrip::getData(CDataContainer &_pData)
+{
+  actualize(_pData);
+  if(!_pData.size()) return;
+
+  /// the vector is shorter than the offset, nothing remains
+  if(_pData.size() <= m_iOffset) {_pData.clear(); return;}
+
+  /// shift the remaining coefficients to the beginning
+  memmove(_pData.data(), _pData.data() + m_iOffset, (_pData.size() - m_iOffset) * sizeof(float));
+  _pData.size() -= m_iOffset;
+}
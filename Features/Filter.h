@@ -215,6 +215,36 @@ namespace Ear
 
 	public:
     /// Getting new data from this processor
+    /// @param [in, out] _pData Container to be filled with new data
+		void getData(CDataContainer &_pData);
+    /// Write the buffer of the window and the computed mean to the snapshot
+    /// @param [in, out] _snap the snapshot
+    /// @return success of the writing
+		unsigned int save(CSnapshot &_snap);
+    /// Read the buffer of the window and the mean from the snapshot
+    /// @param [in, out] _snap the snapshot
+    /// @return EAR_FAIL if the snapshot was written with different window length
+		unsigned int restore(CSnapshot &_snap);
+	};
+
+  /**
+  * Removing first coefficients from the feature vector. Some results are showing that skipping the basic coefficients
+  * from scoring is increasing the accuracy of the detection, these coefficients are then removed here from the vector,
+  * so the following processing and the scoring do not need to handle them.
+  */
+	class CStrip : public ADataProcessor
+	{
+	public:
+    /// Initialize the processor
+    /// @param [in] _iOffset number of the first coefficients to remove
+		CStrip(unsigned int _iOffset);
+		virtual ~CStrip();
+
+	private:
+		unsigned int m_iOffset; ///< number of the coefficients to remove
+
+	public:
+    /// Getting new data from this processor
     /// @param [in, out] _pData Container to be filled with new data
 		void getData(CDataContainer &_pData);
 	};
@@ -18,6 +18,7 @@
  */
 
 #include "Frame.h"
+#include "../Data/Snapshot.h"
 //#include <stdio.h>
 
 using namespace Ear;
@@ -26,7 +27,7 @@ CFrame::CFrame(float _fLength, float _fShift) : ADataProcessor()
 {
 	m_fLength = _fLength;
 	m_fShift  = _fShift;
-	m_iPos = 0;
+	m_iPos = 0; m_iBase = 0;
 
 	bf1.size() = 0; bf2.size() = 0;
 }
@@ -38,11 +39,11 @@ CFrame::~CFrame()
 
 void CFrame::getData(CDataContainer &_pData)
 {
-	unsigned int iLength, iShift;
+	unsigned int iLength, iShift, iFilled;
 
 	/// we are getting outside of the temporary buffer, so we need new data
   /// then we set the position to the beginning of this buffer, thus zero
-	if(m_iPos >= bf1.size()){bf1.clear(); actualize(bf1); m_iPos = 0;}
+	if(m_iPos >= bf1.size()){m_iBase += m_iPos; bf1.clear(); actualize(bf1); m_iPos = 0;}
   /// we are getting empty container, return empty container
 	if(!bf1.size()){_pData.clear(); return;}
 
@@ -64,7 +65,7 @@ void CFrame::getData(CDataContainer &_pData)
 		m_iPos += _pData.add(&bf1,m_iPos, iLength - _pData.size());
 
     /// not enough data, we need to get more
-		if(m_iPos >= bf1.size()){bf1.clear(); actualize(bf1); m_iPos = 0;}
+		if(m_iPos >= bf1.size()){m_iBase += m_iPos; bf1.clear(); actualize(bf1); m_iPos = 0;}
 
     /// not enough data to read from source, stop trying
 		if(!bf1.size()){break;}
@@ -76,9 +77,34 @@ void CFrame::getData(CDataContainer &_pData)
   /// there is only 90% of frame filled, return empty container instead
 	if(_pData.size() < iLength * 0.9){_pData.clear(); return;}
 
-	/// set length to output data
-	_pData.size() = iLength;
+	/// set length to output data, the missing part of the last frame is filled with zeroes
+	iFilled = _pData.size(); _pData.resize(iLength); _pData.zero(iFilled);
 
 	/// copy the data to bf2 for remembering the overlap
 	bf2.copy(&_pData);
 }
+
+unsigned int CFrame::save(CSnapshot &_snap)
+{
+  /// the window is compared on restore, the data are meaningful only for the same one
+	_snap.write(&m_fLength, sizeof(m_fLength)); _snap.write(&m_fShift, sizeof(m_fShift));
+	/// the unread part of buf1 stays in the source
+	uint64_t iUsed = m_iBase + m_iPos;
+	_snap.write(&iUsed, sizeof(iUsed));
+	_snap.write(bf2);
+	return EAR_SUCCESS;
+}
+
+unsigned int CFrame::restore(CSnapshot &_snap)
+{
+	float fLength, fShift;
+
+	if(_snap.read(&fLength, sizeof(fLength)) == EAR_FAIL || _snap.read(&fShift, sizeof(fShift)) == EAR_FAIL) return EAR_FAIL;
+	if(fLength != m_fLength || fShift != m_fShift) return EAR_FAIL;
+	if(_snap.read(&m_iBase, sizeof(m_iBase)) == EAR_FAIL || _snap.read(bf2) == EAR_FAIL) return EAR_FAIL;
+
+	/// the source is read again after the used samples, the live one continues where it is
+	bf1.clear(); m_iPos = 0;
+	if(getSource()) getSource()->seek(m_iBase);
+	return EAR_SUCCESS;
+}
@@ -47,10 +47,21 @@ namespace Ear
 		float m_fLength; ///< length of the window
     float m_fShift; ///< shift of the window
 		unsigned int m_iPos; ///< position in the read input stream
+		uint64_t m_iBase; ///< number of the samples read from the source before the ones in buf1
 		CDataContainer bf1, bf2; ///< two temporary containers
 
 	public:
 		void getData(CDataContainer &_pData);
+    /// Write the number of the samples used from the source and the last frame (the overlap) to the snapshot, the unread
+    /// input is read from the source again after the restore (see <i>ADataProcessor::seek</i>)
+    /// @param [in, out] _snap the snapshot
+    /// @return success of the writing
+		unsigned int save(CSnapshot &_snap);
+    /// Read the last frame from the snapshot and move the source after the used samples, the live source continues
+    /// from its current input
+    /// @param [in, out] _snap the snapshot
+    /// @return EAR_FAIL if the snapshot was written with different window
+		unsigned int restore(CSnapshot &_snap);
 	};
 }
 
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <thread>
+#include <vector>
+
+#include "../Data/Data.h"
+#include "../Data/BufferSource.h"
+#include "Parallel.h"
+
+using namespace Ear;
+
+CParallel::CParallel(CFeature::Configuration &_cfg, unsigned int _iThreads) : ADataProcessor()
+{
+  m_cfg = _cfg;
+  m_iThreads = _iThreads ? _iThreads : 1;
+  m_bDone = false;
+  m_pChunks = NULL;
+  m_iChunk = 0; m_iPos = 0; m_iDim = 0;
+
+  /// the chunk chain computes only the frame based part of the features
+  m_cfg.iDelWin = 0; m_cfg.iAccWin = 0; m_cfg.iCMNWin = 0;
+  m_cfg.bGate = false; m_cfg.iThreads = 1; m_cfg.iStrip = 0;
+}
+
+CParallel::~CParallel()
+{
+  if(m_pChunks) delete[] m_pChunks;
+}
+
+void CParallel::processChunk(unsigned int _iChunk, unsigned int _iStart, unsigned int _iSize, unsigned int _iFrames)
+{
+  CBufferSource src(_iSize);
+  CFeature fea;
+  CDataContainer data;
+  unsigned int i = 0;
+
+  /// own preprocessing chain reading the samples of the chunk
+  src.setBuffer(m_samples.data() + _iStart, _iSize, m_samples.freq());
+  fea.initialize(m_cfg);
+  fea.setSource(&src);
+
+  /// compute the frames and store them one after another
+  while(!_iFrames || i < _iFrames)
+  {
+    fea.getData(data);
+    if(!data.size()) break;
+    m_pChunks[_iChunk].add(&data); i++;
+
+    /// all vectors have the same size, remember it from the first chunk
+    if(_iChunk == 0) m_iDim = data.size();
+  }
+}
+
+void CParallel::process()
+{
+  CDataContainer tmp;
+  std::vector<std::thread> threads;
+  unsigned int iLength, iShift, iFrames, iPerChunk, iStart, iEnd, i;
+
+  m_bDone = true;
+
+  /// read the whole input
+  m_samples.clear();
+  while(1)
+  {
+    tmp.clear(); actualize(tmp);
+    if(!tmp.size()) break;
+    m_samples.add(&tmp);
+  }
+  if(!m_samples.size()) return;
+
+  /// compute the frame length and shift in samples in the same way as CFrame and the number of full frames
+  iLength = (unsigned int)(m_samples.freq() * m_cfg.fLength_ms * 0.001);
+  iShift  = (unsigned int)(m_samples.freq() * m_cfg.fShift_ms * 0.001);
+  iFrames = m_samples.size() >= iLength ? (m_samples.size() - iLength) / iShift + 1 : 0;
+
+  /// do not split into chunks smaller than one frame
+  if(m_iThreads > iFrames) m_iThreads = iFrames ? iFrames : 1;
+  iPerChunk = iFrames / m_iThreads;
+  m_pChunks = new CDataContainer[m_iThreads];
+
+  /// each chunk contains samples of its frames, the last one all the remaining samples (it can end with incomplete frame)
+  for(i = 0; i < m_iThreads; i++)
+  {
+    iStart = i * iPerChunk * iShift;
+    if(i == m_iThreads - 1) { threads.push_back(std::thread(&CParallel::processChunk, this, i, iStart, m_samples.size() - iStart, 0)); break; }
+
+    iEnd = ((i + 1) * iPerChunk - 1) * iShift + iLength;
+    threads.push_back(std::thread(&CParallel::processChunk, this, i, iStart, iEnd - iStart, iPerChunk));
+  }
+
+  for(i = 0; i < threads.size(); i++) threads[i].join();
+}
+
+void CParallel::getData(CDataContainer &_pData)
+{
+  /// compute everything on the first request
+  if(!m_bDone) process();
+
+  /// skip to the next chunk with the feature vectors
+  while(m_pChunks && m_iChunk < m_iThreads && m_iPos >= m_pChunks[m_iChunk].size()) { m_iChunk++; m_iPos = 0; }
+  if(!m_pChunks || m_iChunk >= m_iThreads) { _pData.clear(); return; }
+
+  /// return next feature vector
+  _pData.copy(m_pChunks[m_iChunk].data() + m_iPos, m_iDim);
+  _pData.freq() = m_samples.freq();
+  m_iPos += m_iDim;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+ /**
+ * This file contains the processor computing the features of the whole recording in parallel.
+ */
+
+#ifndef __EAR_PARALLEL_H_
+#define __EAR_PARALLEL_H_
+
+#include "../Data/Data.h"
+#include "Feature.h"
+
+namespace Ear
+{
+  /**
+  * Offline processor computing the frame based part of the preprocessing (all up to the delta coefficients) on more threads.
+  * On the first request all the samples are read from the source and split into chunks of whole frames. The neighbouring chunks
+  * overlap by the part of the frame that exceeds the frame shift, so each frame has the same samples as in sequential processing.
+  * Each chunk is processed by its own preprocessing chain in a separate thread and the results are stitched together in the original order.
+  * The feature vectors are then returned one by one, so the processors that need the context of the neighbouring vectors
+  * (delta coefficients and cepstral mean normalization) can follow this processor and work as in sequential processing.
+  * The processing needs the whole input at once, so it can not be used with the live input (microphone).
+  */
+	class CParallel : public ADataProcessor
+	{
+	public:
+    /// Initialize processor.
+    /// @param [in] _cfg configuration of the frame based part of the preprocessing (delta coefficients, CMN and activity detection are not used)
+    /// @param [in] _iThreads number of threads to use
+		CParallel(CFeature::Configuration &_cfg, unsigned int _iThreads);
+		virtual ~CParallel();
+
+	private:
+		CFeature::Configuration m_cfg; ///< configuration of the preprocessing chain of each chunk
+		unsigned int m_iThreads; ///< number of the threads to use
+		bool m_bDone; ///< the whole input was processed
+		CDataContainer m_samples; ///< all samples read from the source
+		CDataContainer *m_pChunks; ///< feature vectors of each chunk (stitched together one after another)
+		unsigned int m_iChunk, m_iPos; ///< current chunk and the position in it for reading the results
+		unsigned int m_iDim; ///< size of the feature vector
+
+	private:
+    /// Read all the samples and compute the feature vectors of all the chunks
+		void process();
+    /// Compute feature vectors of one chunk, this runs in its own thread
+    /// @param [in] _iChunk index of the chunk
+    /// @param [in] _iStart index of the first sample of the chunk
+    /// @param [in] _iSize number of the samples in the chunk
+    /// @param [in] _iFrames number of the frames to compute (0 for all frames that can be computed)
+		void processChunk(unsigned int _iChunk, unsigned int _iStart, unsigned int _iSize, unsigned int _iFrames);
+
+	public:
+		void getData(CDataContainer &_pData);
+    /// The processing of the whole input at once is not checkpointed
+    /// @return always EAR_FAIL
+		unsigned int save(CSnapshot &_snap){ return EAR_FAIL; }
+	};
+}
+
+#endif
@@ -53,8 +53,10 @@ void CFourier::getData(CDataContainer &_pData)
 
 	/// reserve space in the output container for computation
   /// we used the same container for getting new data, it is ok, the algorithm works in-place
-	_pData.reserve(m_iSize);
-	_pData.size() = m_iSize;
+  /// the input is padded with zeroes to the fft width
+	i = _pData.size();
+	_pData.resize(m_iSize);
+	_pData.zero(i);
 
 	/// standard approach to FFT bit-reversing the coefficients first
   /// while threating them asi complex values in order Re(0) Im(1) Re(2) Im(2)
@@ -169,7 +171,7 @@ void CDct::getData(CDataContainer &_pData)
 	if(!m_Tmp.size()){_pData.size() =  0; return;}
 
   /// reserver space for otput
-	_pData.reserve(m_iOutputSize); _pData.clear(); _pData.size() = m_iOutputSize;
+	_pData.resize(m_iOutputSize);
   /// compute normalization factor
 	norm = sqrt(2.0 / m_Tmp.size());
   /// if there is change of input size, reinitialize the transform matrix
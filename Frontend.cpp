@@ -37,7 +37,6 @@ int main(int argc, char* argv[])
 	CFeature::Configuration fea_cfg;
 	CFeature fea;
 	ADataProcessor *audio;
-	char frn_type[100];
 	char model_bin[PATH_MAX];
 	char model_idx[PATH_MAX];
 	CDataContainer data;
@@ -61,26 +60,7 @@ int main(int argc, char* argv[])
 	if(ret == EAR_FAIL){ fprintf(stderr, "Error loading wav file from file %s\n", argv[2]); return 1;}
 
 	//configuration for freature extraction
-  cfg.lookUpBool("ZERO_COEF", &fea_cfg.bC0, false);
-  cfg.lookUpBool("ENERGY", &fea_cfg.bEnergy, false);
-  cfg.lookUpBool("RAW_ENERGY", &fea_cfg.bRawE, false);
-	cfg.lookUpFloat("HAMMING",&fea_cfg.fHam, 0.46);
-  cfg.lookUpFloat("WND_LENGTH",&fea_cfg.fLength_ms, 25);
-  cfg.lookUpFloat("PREEM",&fea_cfg.fPreem, 0.97);
-  cfg.lookUpFloat("WND_SHIFT",&fea_cfg.fShift_ms, 10);
-	cfg.lookUpUInt("ACC_WND",&fea_cfg.iAccWin,2);
-  cfg.lookUpUInt("CEP_NUM",&fea_cfg.iCep,12);
-	cfg.lookUpUInt("DEL_WND",&fea_cfg.iDelWin,2);
- 	cfg.lookUpUInt("HI_FREQ",&fea_cfg.iHiFreq_hz,UINT_MAX);
-  cfg.lookUpUInt("LO_FREQ",&fea_cfg.iLoFreq_hz,0);
-  cfg.lookUpUInt("LIFT_COEF",&fea_cfg.iLift,22);
-  cfg.lookUpUInt("MEL_NUM",&fea_cfg.iMel,29);
-  cfg.lookUpUInt("CMN_WND",&fea_cfg.iCMNWin,0);
-	cfg.lookUpString("FRONT_END_TYPE", frn_type, "MFCC");
-  if(strcmp(frn_type, "MFCC") == 0) fea_cfg.iType = CFeature::Configuration::MFCC;
-  if(strcmp(frn_type, "MELSPEC") == 0) fea_cfg.iType = CFeature::Configuration::MELSPEC;
-  if(strcmp(frn_type, "FBANK") == 0) fea_cfg.iType = CFeature::Configuration::FBANK;
-  if(strcmp(frn_type, "DIRECT") == 0) fea_cfg.iType = CFeature::Configuration::DIRECT;
+	fea_cfg.lookUp(cfg);
 
 	//initialize frontend and set the wav source
 	fea.initialize(fea_cfg);
@@ -17,6 +17,11 @@
  * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <math.h>
+#include <float.h>
+#include <vector>
+#include <algorithm>
+
 #include "FSTAssembly.h"
 #include "Dictionary.h"
 #include "../Data/Utils.h"
@@ -25,6 +30,145 @@
 using namespace std;
 using namespace Ear;
 
+/// Scalar quantizer of the values of one coefficient of all PDFs. The levels are the values themselves if there
+/// are not more of them than EAR_AM_LEVELS, otherwise they are found by the k-means (Lloyd) from the quantiles.
+/// @param [in, out] _v the values, they are sorted
+/// @param [out] _levels EAR_AM_LEVELS sorted levels
+static void scalarLevels(vector<float> &_v, float *_levels)
+{
+	unsigned int i, k, it;
+	vector<float> u;
+	vector<double> sum(EAR_AM_LEVELS);
+	vector<unsigned int> count(EAR_AM_LEVELS);
+
+	if(_v.empty()) { for(k=0;k<EAR_AM_LEVELS;k++) _levels[k] = 0; return; }
+
+	sort(_v.begin(), _v.end());
+	u = _v; u.erase(unique(u.begin(), u.end()), u.end());
+
+	if(u.size() <= EAR_AM_LEVELS)
+	{
+		for(k=0;k<EAR_AM_LEVELS;k++) _levels[k] = u[min<size_t>(k, u.size() - 1)];
+		return;
+	}
+
+	for(k=0;k<EAR_AM_LEVELS;k++) _levels[k] = u[(size_t)((k + 0.5) * u.size() / EAR_AM_LEVELS)];
+	for(it=0;it<20;it++)
+	{
+		fill(sum.begin(), sum.end(), 0.0); fill(count.begin(), count.end(), 0);
+		for(i=0, k=0;i<_v.size();i++)
+		{
+			/// both are sorted, the nearest level only moves up
+			while(k + 1 < EAR_AM_LEVELS && _v[i] - _levels[k] > _levels[k + 1] - _v[i]) k++;
+			sum[k] += _v[i]; count[k]++;
+		}
+		for(k=0;k<EAR_AM_LEVELS;k++) if(count[k]) _levels[k] = sum[k] / count[k];
+	}
+}
+
+/// Index of the nearest level
+/// @param [in] _levels sorted levels
+/// @param [in] _v value
+/// @return index of the level
+static unsigned int nearestLevel(const float *_levels, float _v)
+{
+	unsigned int k = lower_bound(_levels, _levels + EAR_AM_LEVELS, _v) - _levels;
+	if(k == EAR_AM_LEVELS) return k - 1;
+	if(k > 0 && _v - _levels[k - 1] < _levels[k] - _v) return k - 1;
+	return k;
+}
+
+/// Write the PDFs quantized to the storage type as the precisions s = sqrt(0.5 * ivar) and the scaled means b = mean * s
+/// (see EAR_AM_Quant). The precisions are quantized in the logarithm, so their relative error is the same for all of them.
+/// The PDFs with non-finite values are written with infinite gconst, so they are disabled when scored. The gconst of
+/// the other PDFs is corrected for the quantized variances, so the PDFs stay normalized.
+static void writeQuantizedPdfs(FILE *_pf, EAR_AM_Info *_model, unsigned int _iType)
+{
+	unsigned int i, j, d = _model->iVectorSize, n = _model->iNumberOfPdfs;
+	vector<bool> valid(n);
+	vector<float> val(2 * d * n), col, table(2 * d * EAR_AM_LEVELS), scale(d, 1.0f);
+	vector<uint8_t> q8(2 * d);
+	vector<uint16_t> q16(2 * d);
+	float v, vq, gconst;
+
+	/// the precisions and the scaled means of the PDFs with all values finite
+	for(i=0;i<n;i++)
+	{
+		EAR_AM_Pdf *pdf = &_model->Pdfs[i];
+		for(j=0;j<d && isfinite(pdf->fVar[j]) && isfinite(pdf->fMean[j]) && pdf->fVar[j] >= 0;j++);
+		valid[i] = j == d && isfinite(pdf->fgconst);
+
+		for(j=0;j<d;j++)
+		{
+			v = valid[i] ? sqrt(0.5f * pdf->fVar[j]) : 0.0f;
+			val[i * 2 * d + j] = v;
+			val[i * 2 * d + d + j] = valid[i] ? pdf->fMean[j] * v : 0.0f;
+		}
+	}
+
+	/// table of the levels of each position of the row, the precisions in the logarithm
+	if(_iType == EAR_AM_INT8)
+	{
+		for(j=0;j<2 * d;j++)
+		{
+			col.clear();
+			for(i=0;i<n;i++) if(valid[i]) col.push_back(j < d ? log(max(val[i * 2 * d + j], FLT_MIN)) : val[i * 2 * d + j]);
+			scalarLevels(col, &table[j * EAR_AM_LEVELS]);
+		}
+	}
+
+	/// the precisions are scaled by their geometric mean, so they fit into the range of the half float
+	if(_iType == EAR_AM_FP16)
+	{
+		for(j=0;j<d;j++)
+		{
+			double lsum = 0.0; unsigned int cnt = 0;
+			for(i=0;i<n;i++) if(valid[i] && val[i * 2 * d + j] > 0) { lsum += log(val[i * 2 * d + j]); cnt++; }
+			if(cnt) scale[j] = exp(lsum / cnt);
+		}
+		fwrite(&scale[0], sizeof(float), d, _pf);
+	}
+
+	/// the levels are written as the values
+	if(_iType == EAR_AM_INT8)
+	{
+		vector<float> out(table);
+		for(j=0;j<d * EAR_AM_LEVELS;j++) out[j] = exp(table[j]);
+		fwrite(&out[0], sizeof(float), 2 * d * EAR_AM_LEVELS, _pf);
+	}
+
+	for(i=0;i<n;i++)
+	{
+		gconst = valid[i] ? _model->Pdfs[i].fgconst : INFINITY;
+
+		for(j=0;j<2 * d;j++)
+		{
+			v = val[i * 2 * d + j];
+
+			/// quantize and take the value back
+			if(_iType == EAR_AM_INT8)
+			{
+				const float *levels = &table[j * EAR_AM_LEVELS];
+				q8[j] = nearestLevel(levels, j < d ? log(max(v, FLT_MIN)) : v);
+				vq = j < d ? exp(levels[q8[j]]) : levels[q8[j]];
+			}
+			else
+			{
+				q16[j] = floatToHalf(j < d ? v / scale[j] : v);
+				vq = j < d ? halfToFloat(q16[j]) * scale[j] : halfToFloat(q16[j]);
+			}
+
+			/// log(ivar) = log(2) + 2 * log(s)
+			if(valid[i] && j < d) gconst += 2.0f * (log(max(v, FLT_MIN)) - log(max(vq, FLT_MIN)));
+		}
+
+		if(_iType == EAR_AM_INT8) fwrite(&q8[0], sizeof(uint8_t), 2 * d, _pf);
+		else fwrite(&q16[0], sizeof(uint16_t), 2 * d, _pf);
+		fwrite(&gconst, sizeof(float), 1, _pf);
+		fwrite(&_model->Pdfs[i].fWeight, sizeof(float), 1, _pf);
+	}
+}
+
 CFSTAssembly::CFSTAssembly()
 {
 
@@ -247,11 +391,12 @@ int CFSTAssembly::writeOSymFile(const char *_szFileName)
 	return EAR_SUCCESS;
 }
 
-int CFSTAssembly::writeBin(const char *_szOut, const char *_szOutIndex)
+int CFSTAssembly::writeBin(const char *_szOut, const char *_szOutIndex, unsigned int _iType)
 {
 	FILE *pf = NULL;
 	unsigned int i;
 	unsigned int size;
+	unsigned short header;
 	multimap<unsigned int, EAR_FST_Trn*>::iterator it;
 	EAR_FST_Trn *t;
 
@@ -261,8 +406,10 @@ int CFSTAssembly::writeBin(const char *_szOut, const char *_szOutIndex)
 	EAR_AM_Info *model = m_model->getAcousticModel();
 	if(model == NULL) return EAR_FAIL;
 
-	//write vector size
-	fwrite(&model->iVectorSize, sizeof(unsigned short), 1, pf);
+	//write vector size, together with the storage type of the pdfs
+	if(model->iVectorSize & EAR_AM_QUANT) { fclose(pf); return EAR_FAIL; }
+	header = model->iVectorSize | _iType;
+	fwrite(&header, sizeof(unsigned short), 1, pf);
 
 	//write number of states
 	fwrite(&model->iNumberOfStates, sizeof(unsigned int), 1, pf);
@@ -278,7 +425,8 @@ int CFSTAssembly::writeBin(const char *_szOut, const char *_szOutIndex)
 		fwrite(model->States[i], sizeof(unsigned int), model->iPdfsOnState, pf);
 
 	//go through pdfs and write
-	for(i=0;i<model->iNumberOfPdfs;i++)
+	if(_iType != EAR_AM_FLOAT) writeQuantizedPdfs(pf, model, _iType);
+	else for(i=0;i<model->iNumberOfPdfs;i++)
 	{
 		fwrite(model->Pdfs[i].fVar, sizeof(float), model->iVectorSize, pf);
 		fwrite(model->Pdfs[i].fMean, sizeof(float), model->iVectorSize, pf);
@@ -84,8 +84,9 @@ namespace Ear
     /// along with the index transforming inner number representations to the actual event names
     /// @param [in] _szOut path of the output binary file
     /// @param [in] _szOutIndex path to the output index file
+    /// @param [in] _iType storage of the variances and means of the PDFs (EAR_AM_FLOAT, EAR_AM_INT8 or EAR_AM_FP16)
     /// @return success state of the function
-		int writeBin(const char *_szOut, const char *_szOutIndex);
+		int writeBin(const char *_szOut, const char *_szOutIndex, unsigned int _iType = EAR_AM_FLOAT);
     /// Writing only the FST network mostly for debuging purposes in openFST format.
     /// Output can be later used for example for drawing out the network
     /// @param [in] _szFstName path to the text output FST file
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "GaussianSelection.h"
+
+/// number of the k-means iterations
+#define KMEANS_ITERATIONS 20
+
+using namespace Ear;
+
+CGaussianSelection::CGaussianSelection()
+{
+	memset(&m_sel, 0, sizeof(m_sel));
+	m_iStates = 0;
+}
+
+CGaussianSelection::~CGaussianSelection()
+{
+	if(m_sel.fWeight) delete[] m_sel.fWeight;
+	if(m_sel.fCodebook) delete[] m_sel.fCodebook;
+	if(m_sel.Shortlists) delete[] m_sel.Shortlists;
+}
+
+float CGaussianSelection::distance(EAR_AM_Pdf *_pdf, unsigned int _iCodeword)
+{
+	unsigned int j; float d, sx = 0.0;
+	float *c = m_sel.fCodebook + _iCodeword * m_sel.iDim;
+
+	for(j=0;j<m_sel.iDim;j++) {d = _pdf->fMean[m_sel.iOffset + j] - c[j]; sx += d * d * m_sel.fWeight[j];}
+	return sx;
+}
+
+float CGaussianSelection::likelihood(EAR_AM_Pdf *_pdf, unsigned int _iCodeword)
+{
+	unsigned int j; float d, sx = 0.0;
+	float *c = m_sel.fCodebook + _iCodeword * m_sel.iDim;
+
+	for(j=0;j<m_sel.iDim;j++) {d = c[j] - _pdf->fMean[m_sel.iOffset + j]; sx += d * d * _pdf->fVar[m_sel.iOffset + j];}
+	return log(_pdf->fWeight) - 0.5 * (_pdf->fgconst + sx);
+}
+
+int CGaussianSelection::build(EAR_AM_Info *_am, unsigned int _iCodewords, unsigned int _iShortlist, unsigned int _iOffset)
+{
+	unsigned int i, j, k, s, it, best;
+	float d, dbest;
+	std::vector<unsigned int> valid, assign, count;
+	std::vector<double> sum;
+	std::vector<std::pair<float, unsigned int> > cand;
+
+	if(!_am || _iOffset >= _am->iVectorSize || !_iCodewords || !_iShortlist) return EAR_FAIL;
+
+	m_sel.iCodewords = _iCodewords;
+	m_sel.iOffset = _iOffset;
+	m_sel.iDim = _am->iVectorSize - _iOffset;
+	m_sel.iShortlist = _iShortlist < _am->iPdfsOnState ? _iShortlist : _am->iPdfsOnState;
+	m_iStates = _am->iNumberOfStates;
+
+	/// only PDFs with finite parameters are clustered
+	for(i=0;i<_am->iNumberOfPdfs;i++)
+	{
+		EAR_AM_Pdf *p = &_am->Pdfs[i];
+		for(j=0;j<_am->iVectorSize && isfinite(p->fVar[j]) && isfinite(p->fMean[j]);j++);
+		if(j == _am->iVectorSize && p->fWeight > 0 && isfinite(p->fgconst)) valid.push_back(i);
+	}
+	if(valid.size() < _iCodewords) return EAR_FAIL;
+
+	/// weights of the coefficients are the average inverse variances
+	m_sel.fWeight = new float[m_sel.iDim];
+	for(j=0;j<m_sel.iDim;j++)
+	{
+		double w = 0.0;
+		for(i=0;i<valid.size();i++) w += _am->Pdfs[valid[i]].fVar[_iOffset + j];
+		m_sel.fWeight[j] = w / valid.size();
+	}
+
+	/// initial codewords are the means of the PDFs evenly spread over the model
+	m_sel.fCodebook = new float[m_sel.iCodewords * m_sel.iDim];
+	for(k=0;k<m_sel.iCodewords;k++)
+		memcpy(m_sel.fCodebook + k * m_sel.iDim, _am->Pdfs[valid[(size_t)k * valid.size() / m_sel.iCodewords]].fMean + _iOffset, sizeof(float) * m_sel.iDim);
+
+	/// k-means, the empty clusters keep their codeword
+	assign.resize(valid.size()); count.resize(m_sel.iCodewords); sum.resize(m_sel.iCodewords * m_sel.iDim);
+	for(it=0;it<KMEANS_ITERATIONS;it++)
+	{
+		std::fill(count.begin(), count.end(), 0); std::fill(sum.begin(), sum.end(), 0.0);
+
+		for(i=0;i<valid.size();i++)
+		{
+			EAR_AM_Pdf *p = &_am->Pdfs[valid[i]];
+			best = 0; dbest = distance(p, 0);
+			for(k=1;k<m_sel.iCodewords;k++) {d = distance(p, k); if(d < dbest) {dbest = d; best = k;}}
+
+			assign[i] = best; count[best]++;
+			for(j=0;j<m_sel.iDim;j++) sum[best * m_sel.iDim + j] += p->fMean[_iOffset + j];
+		}
+
+		for(k=0;k<m_sel.iCodewords;k++)
+		{
+			if(!count[k]) continue;
+			for(j=0;j<m_sel.iDim;j++) m_sel.fCodebook[k * m_sel.iDim + j] = sum[k * m_sel.iDim + j] / count[k];
+		}
+	}
+
+	/// shortlists, the PDFs of the state with the highest likelihood in the codeword
+	m_sel.Shortlists = new unsigned int[m_sel.iCodewords * m_iStates * m_sel.iShortlist];
+	for(k=0;k<m_sel.iCodewords;k++)
+	{
+		for(s=0;s<m_iStates;s++)
+		{
+			unsigned int *list = m_sel.Shortlists + (k * m_iStates + s) * m_sel.iShortlist;
+
+			cand.clear();
+			for(i=0;i<_am->iPdfsOnState;i++)
+			{
+				unsigned int pdf = _am->States[s][i];
+				if(pdf == NONE) continue;
+
+				d = likelihood(&_am->Pdfs[pdf - 1], k);
+				if(!(d > -INFINITY)) continue;
+				cand.push_back(std::make_pair(-d, pdf));
+			}
+
+			i = cand.size() < m_sel.iShortlist ? cand.size() : m_sel.iShortlist;
+			std::partial_sort(cand.begin(), cand.begin() + i, cand.end());
+
+			for(j=0;j<m_sel.iShortlist;j++) list[j] = j < i ? cand[j].second : NONE;
+		}
+	}
+
+	return EAR_SUCCESS;
+}
+
+int CGaussianSelection::write(const char *_szOut)
+{
+	FILE *pf = NULL;
+
+	if(!m_sel.Shortlists) return EAR_FAIL;
+
+	pf = fopen(_szOut, "wb");
+	if(pf == NULL) return EAR_FAIL;
+
+	fwrite(&m_sel.iCodewords, sizeof(unsigned int), 1, pf);
+	fwrite(&m_sel.iOffset, sizeof(unsigned int), 1, pf);
+	fwrite(&m_sel.iDim, sizeof(unsigned int), 1, pf);
+	fwrite(&m_sel.iShortlist, sizeof(unsigned int), 1, pf);
+	fwrite(&m_iStates, sizeof(unsigned int), 1, pf);
+	fwrite(m_sel.fWeight, sizeof(float), m_sel.iDim, pf);
+	fwrite(m_sel.fCodebook, sizeof(float), m_sel.iCodewords * m_sel.iDim, pf);
+	fwrite(m_sel.Shortlists, sizeof(unsigned int), m_sel.iCodewords * m_iStates * m_sel.iShortlist, pf);
+
+	fclose(pf);
+	return EAR_SUCCESS;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+ /**
+ * Building the Gaussian selection for the acoustic model. This is part of the conversion tool, the selection
+ * is built from the native binary model and written to its own binary file.
+ */
+
+#ifndef __EAR_GAUSSIANSELECTION_H_
+#define __EAR_GAUSSIANSELECTION_H_
+
+#include "../Data/Data.h"
+
+namespace Ear
+{
+  /**
+  * Gaussian selection builder. The means of all PDFs of the model are clustered by k-means into the codebook,
+  * the distance is weighted by the average inverse variance of each coefficient. For each codeword and state
+  * the PDFs with the highest likelihood in the codeword are kept in the shortlist. At runtime the feature vector
+  * is quantized to the nearest codeword and only the PDFs in its shortlists are scored (see CAcousticScorer).
+  */
+	class CGaussianSelection
+	{
+	public:
+		CGaussianSelection();
+		~CGaussianSelection();
+
+	public:
+    /// Build the codebook and the shortlists
+    /// @param [in] _am acoustic model in native format
+    /// @param [in] _iCodewords number of the codewords
+    /// @param [in] _iShortlist maximum length of the shortlist for each codeword and state
+    /// @param [in] _iOffset first coefficient used (the coefficients stripped at runtime should not be used)
+    /// @return success state of the function
+		int build(EAR_AM_Info *_am, unsigned int _iCodewords, unsigned int _iShortlist, unsigned int _iOffset);
+    /// Write the selection in binary format (see CDataHolder::loadSelection)
+    /// @param [in] _szOut path of the output file
+    /// @return success state of the function
+		int write(const char *_szOut);
+
+	private:
+		EAR_AM_Selection m_sel; ///< the built selection
+		unsigned int m_iStates; ///< number of the states of the model
+
+    /// Weighted distance of the PDF mean from the codeword
+    /// @param [in] _pdf the PDF
+    /// @param [in] _iCodeword index of the codeword
+    /// @return the distance
+		float distance(EAR_AM_Pdf *_pdf, unsigned int _iCodeword);
+    /// Log likelihood of the weighted PDF in the codeword
+    /// @param [in] _pdf the PDF
+    /// @param [in] _iCodeword index of the codeword
+    /// @return the log likelihood
+		float likelihood(EAR_AM_Pdf *_pdf, unsigned int _iCodeword);
+	};
+}
+
+#endif
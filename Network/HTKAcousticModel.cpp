@@ -530,6 +530,8 @@ EAR_AM_Info *CHTKAcousticModel::getAcousticModel()
 	out->iNumberOfPdfs = m_HTK_info.iPdfs;
 	out->iNumberOfStates = m_HTK_info.iStates;
 	out->iPdfsOnState = pdfsOnState;
+	out->Selection = NULL;
+	out->Quant = NULL;
 
   /// allocating states and pdfs
 	out->States = new unsigned int*[out->iNumberOfStates];
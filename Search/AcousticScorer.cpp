@@ -25,108 +25,666 @@
 
 #include "AcousticScorer.h"
 #include "../Data/Data.h"
+#include "../Data/Utils.h"
+
+/// number of the PDFs in one tile of the block scoring, the part of the table for the tile stays in the cache
+#define SCORE_TILE 128
 
 using namespace Ear;
 
+/// Approximation of exp(x) for x <= 0 (relative error about 1e-7) written so that the compiler can vectorize
+/// the loops using it. x = n * ln(2) + r, the exp(r) is computed by a polynomial and 2^n is composed in the exponent bits.
+static inline float expNeg(float _x)
+{
+	union { float f; int i; } u;
+	float n, r, p;
+
+	if(_x < -87.0f) _x = -87.0f;
+	n = (float)(int)(_x * 1.44269504f - 0.5f);
+	r = _x - n * 0.693359375f + n * 2.12194440e-4f;
+
+	p = 1.9875691500e-4f;
+	p = p * r + 1.3981999507e-3f;
+	p = p * r + 8.3334519073e-3f;
+	p = p * r + 4.1665795894e-2f;
+	p = p * r + 1.6666665459e-1f;
+	p = p * r + 5.0000001201e-1f;
+	p = p * r * r + r + 1.0f;
+
+	u.i = ((int)n + 127) << 23;
+	return p * u.f;
+}
+
 CAcousticScorer::CAcousticScorer()
 {
 	am = NULL;
 	scores = NULL;
+	m_iGeneration = 0;
+	m_piStamp = NULL;
 	vector = NULL;
+	m_iStrip_offset = 0;
+	m_iForm = FOLDED;
+	m_iDim = 0; m_iStride = 0;
+	m_pfTable = NULL;
+	m_pfConst = NULL;
+	m_pfInput = NULL;
+	m_iMixture = MAX;
+	m_pfMix = NULL;
+	m_pSel = NULL;
+	m_iShortlist = 0;
+	m_fFloor = LOG_ZERO;
+	m_pShortlists = NULL;
+	m_iEvaluated = 0;
+	m_iBlock = 0; m_pfTile = NULL;
+	m_pfBlockIn = NULL; m_pfBlockLik = NULL; m_pfBlockScores = NULL;
+	m_pfRow = NULL;
+	m_iQuant = EAR_AM_FLOAT;
+	m_pfPdf = NULL;
+	m_piStateStart = NULL; m_piStatePdfs = NULL;
+	m_pfPdfScores = NULL; m_piPdfStamp = NULL;
+	m_piWork = NULL; m_iWork = 0; m_iNext = 0;
+	m_ppfWorkMix = NULL; m_piWorkEvaluated = NULL; m_iWorkers = 0;
 }
 
 CAcousticScorer::~CAcousticScorer()
 {
 	/// deleting the cache memory for already computed scores
 	if(scores != NULL) delete[] scores;
+	if(m_piStamp) delete[] m_piStamp;
+	/// deleting the derived tables of the PDFs
+	if(m_pfTable) freeAligned(m_pfTable);
+	if(m_pfConst) freeAligned(m_pfConst);
+	if(m_pfInput) freeAligned(m_pfInput);
+	if(m_pfMix) freeAligned(m_pfMix);
+	if(m_pfPdf) delete[] m_pfPdf;
+	freeBlock();
+	/// deleting the PDFs of the states and the cache of the shared PDFs
+	if(m_piStateStart) delete[] m_piStateStart;
+	if(m_piStatePdfs) delete[] m_piStatePdfs;
+	if(m_pfPdfScores) freeAligned(m_pfPdfScores);
+	if(m_piPdfStamp) delete[] m_piPdfStamp;
+	/// the threads are finished before the buffers of the workers are deleted
+	m_pool.stop();
+	if(m_ppfWorkMix)
+	{
+		for(unsigned int i=0;i<m_iWorkers;i++) freeAligned(m_ppfWorkMix[i]);
+		delete[] m_ppfWorkMix;
+	}
+	if(m_piWorkEvaluated) delete[] m_piWorkEvaluated;
+	if(m_piWork) delete[] m_piWork;
+}
+
+void CAcousticScorer::freeBlock()
+{
+	if(m_pfBlockIn) freeAligned(m_pfBlockIn);
+	if(m_pfBlockLik) freeAligned(m_pfBlockLik);
+	if(m_pfBlockScores) freeAligned(m_pfBlockScores);
+	if(m_pfTile) freeAligned(m_pfTile);
+	m_pfTile = NULL;
+	m_pfBlockIn = NULL; m_pfBlockLik = NULL; m_pfBlockScores = NULL;
+	m_iBlock = 0; m_pfRow = NULL;
 }
 
-void CAcousticScorer::setAcousticModel(EAR_AM_Info *_am, unsigned int _iStrip_offset)
+float CAcousticScorer::pdfRow(unsigned int _iPdf, unsigned int _iForm, float *_row)
 {
+	unsigned int j;
+	EAR_AM_Pdf *pdf = &(am->Pdfs[_iPdf]);
+	const float *var = pdf->fVar, *mean = pdf->fMean;
+	double c = log(pdf->fWeight) - 0.5 * pdf->fgconst;
+
+	/// the quantized model has no float values, they are dequantized only for the derivation
+	if(am->Quant) { var = m_pfPdf; mean = m_pfPdf + am->iVectorSize; dequantizePdf(am->Quant, _iPdf, m_pfPdf, m_pfPdf + am->iVectorSize); }
+
+	for(j=0;j<m_iDim;j++)
+	{
+		if(_iForm == DOT)
+		{
+			_row[j] = mean[m_iStrip_offset + j] * var[m_iStrip_offset + j];
+			_row[m_iDim + j] = -0.5 * var[m_iStrip_offset + j];
+			c -= 0.5 * (double)mean[m_iStrip_offset + j] * mean[m_iStrip_offset + j] * var[m_iStrip_offset + j];
+		}
+		else
+		{
+			_row[j] = mean[m_iStrip_offset + j];
+			_row[m_iDim + j] = 0.5 * var[m_iStrip_offset + j];
+		}
+	}
+
+	/// broken PDFs (infinite variance or mean) would give undefined values in some of the formulations,
+	/// they never win the maximum in the original formulation, so they are disabled by the lowest score
+	for(j=0;j<am->iVectorSize && isfinite(var[j]) && isfinite(mean[j]);j++);
+	if(j < am->iVectorSize || !isfinite(c))
+	{
+		memset(_row, 0, sizeof(float) * 2 * m_iDim);
+		return -INFINITY;
+	}
+
+	return c;
+}
+
+void CAcousticScorer::setAcousticModel(EAR_AM_Info *_am, unsigned int _iStrip_offset, unsigned int _iForm)
+{
+	unsigned int i, j, n, iRows;
+	const unsigned int iBlock = EAR_ALIGN / sizeof(float);
+	unsigned int *refs;
+	bool shared = false;
+
 	/// set acoustic model
 	am = _am;
 	/// set strip offset
 	m_iStrip_offset = _iStrip_offset;
+	m_iForm = _iForm;
+	m_iDim = am->iVectorSize > m_iStrip_offset ? am->iVectorSize - m_iStrip_offset : 0;
+	m_pSel = NULL; m_pShortlists = NULL;
+	m_iEvaluated = 0;
+	freeBlock();
 
-	/// allocate memory for the score cache
+	/// allocate memory for the score cache, no score is valid before the first vector
+	if(scores) delete[] scores;
+	if(m_piStamp) delete[] m_piStamp;
 	scores = new float[am->iNumberOfStates];
-	/// reset the memory
-	memset(scores, 0.0, sizeof(float) * am->iNumberOfStates);
+	m_piStamp = new unsigned int[am->iNumberOfStates];
+	memset(m_piStamp, 0, sizeof(unsigned int) * am->iNumberOfStates);
+	m_iGeneration = 0;
+
+	/// allocate the tables, each row is aligned and padded by zeroes
+	if(m_pfTable) freeAligned(m_pfTable);
+	if(m_pfConst) freeAligned(m_pfConst);
+	if(m_pfInput) freeAligned(m_pfInput);
+	if(m_pfMix) freeAligned(m_pfMix);
+	if(m_pfPdf) delete[] m_pfPdf;
+	m_pfMix = allocAligned(am->iPdfsOnState);
+	m_pfPdf = am->Quant ? new float[2 * am->iVectorSize] : NULL;
+	m_iStride = (2 * m_iDim + iBlock - 1) / iBlock * iBlock;
+	/// the quantized model is scored from its quantized values, the table has only one row used for the constants
+	m_iQuant = am->Quant && m_iForm == FOLDED ? am->Quant->iType : EAR_AM_FLOAT;
+	iRows = m_iQuant == EAR_AM_FLOAT ? am->iNumberOfPdfs : 1;
+	m_pfTable = allocAligned(iRows * m_iStride);
+	m_pfConst = allocAligned(am->iNumberOfPdfs);
+	m_pfInput = allocAligned(m_iStride);
+	memset(m_pfTable, 0, sizeof(float) * iRows * m_iStride);
+	memset(m_pfInput, 0, sizeof(float) * m_iStride);
+
+	/// fold the constants of each PDF and prepare its row of the scored coefficients only
+	for(i=0;i<am->iNumberOfPdfs;i++) m_pfConst[i] = pdfRow(i, m_iForm, m_pfTable + (iRows > 1 ? i * m_iStride : 0));
+
+	/// the PDFs of the states are stored one after another without the unused ones, the PDFs referenced
+	/// from more states (tied models) are remembered during one vector
+	if(m_piStateStart) delete[] m_piStateStart;
+	if(m_piStatePdfs) delete[] m_piStatePdfs;
+	if(m_pfPdfScores) freeAligned(m_pfPdfScores);
+	if(m_piPdfStamp) delete[] m_piPdfStamp;
+	m_pfPdfScores = NULL; m_piPdfStamp = NULL;
+
+	refs = new unsigned int[am->iNumberOfPdfs];
+	memset(refs, 0, sizeof(unsigned int) * am->iNumberOfPdfs);
+	m_piStateStart = new unsigned int[am->iNumberOfStates + 1];
+	for(i=0, n=0;i<am->iNumberOfStates;i++)
+	{
+		m_piStateStart[i] = n;
+		for(j=0;j<am->iPdfsOnState;j++) if(am->States[i][j] != NONE) n++;
+	}
+	m_piStateStart[am->iNumberOfStates] = n;
+
+	m_piStatePdfs = new unsigned int[n ? n : 1];
+	for(i=0, n=0;i<am->iNumberOfStates;i++)
+		for(j=0;j<am->iPdfsOnState;j++)
+		{
+			if(am->States[i][j] == NONE) continue;
+			m_piStatePdfs[n++] = am->States[i][j] - 1;
+			if(++refs[am->States[i][j] - 1] > 1) shared = true;
+		}
+	delete[] refs;
+
+	if(shared)
+	{
+		m_pfPdfScores = allocAligned(am->iNumberOfPdfs);
+		m_piPdfStamp = new unsigned int[am->iNumberOfPdfs];
+		memset(m_piPdfStamp, 0, sizeof(unsigned int) * am->iNumberOfPdfs);
+	}
+
+	/// the buffers of the workers depend on the size of the model
+	allocWork();
+}
+
+void CAcousticScorer::changeMixtureMode(unsigned int _iMode)
+{
+	m_iMixture = _iMode;
+	if(scores) nextGeneration();
+}
+
+void CAcousticScorer::nextGeneration()
+{
+	/// after the overflow the old stamps could become valid again, so they are cleared
+	if(++m_iGeneration == 0)
+	{
+		memset(m_piStamp, 0, sizeof(unsigned int) * am->iNumberOfStates);
+		if(m_piPdfStamp) memset(m_piPdfStamp, 0, sizeof(unsigned int) * am->iNumberOfPdfs);
+		m_iGeneration = 1;
+	}
+}
+
+void CAcousticScorer::setSelection(EAR_AM_Selection *_sel, unsigned int _iShortlist, float _fFloor)
+{
+	m_pSel = _sel; m_pShortlists = NULL;
+	if(m_pSel == NULL) return;
+
+	m_iShortlist = _iShortlist == 0 || _iShortlist > m_pSel->iShortlist ? m_pSel->iShortlist : _iShortlist;
+	m_fFloor = _fFloor;
 }
 
 int CAcousticScorer::set(CDataContainer *_vector)
 {
+	unsigned int j, k;
+
 	/// check vector size, it needs to be equal to the model used
 	if(_vector->size() != am->iVectorSize) {
-		fprintf(stderr, "AcousticScorer: Incompatible features: model: %d, input: %d\n", _vector->size(), am->iVectorSize);
+		fprintf(stderr, "AcousticScorer: Incompatible features: model: %d, input: %d\n", am->iVectorSize, _vector->size());
 		return EAR_FAIL;
 	}
 
 	/// set current vector;
 	vector  = _vector;
+	input(*vector, m_pfInput);
+
+	/// quantize the vector to the nearest codeword of the Gaussian selection
+	if(m_pSel)
+	{
+		const float *x = &(*vector)[m_pSel->iOffset];
+		float d, best = FLT_MAX;
+
+		for(k=0;k<m_pSel->iCodewords;k++)
+		{
+			const float *c = m_pSel->fCodebook + k * m_pSel->iDim;
+			float sx = 0.0;
 
-	/// reset the score cache
-	memset(scores, 0.0, sizeof(float) * am->iNumberOfStates);
+			#pragma omp simd reduction(+:sx)
+			for(j=0;j<m_pSel->iDim;j++) {d = x[j] - c[j]; sx += d * d * m_pSel->fWeight[j];}
+
+			if(sx < best) {best = sx; m_pShortlists = m_pSel->Shortlists + k * am->iNumberOfStates * m_pSel->iShortlist;}
+		}
+	}
+
+	/// the single vector is scored, not the block
+	m_pfRow = NULL;
+
+	/// the cached scores of the states and the shared PDFs are for the previous vector
+	nextGeneration();
 
 	return EAR_SUCCESS;
 }
 
-float CAcousticScorer::getScore(unsigned int _Index)
+void CAcousticScorer::input(CDataContainer &_vector, float *_pfInput)
 {
-	unsigned int i,j;
-	unsigned int *pdfs;
-	unsigned int Index = _Index - 1;	/// as zero is reserved for empty symbol the indexes are shifted by one. The actual index of state in ascoustic model is less by one
-	EAR_AM_Pdf *pdf = NULL;
-	float score = -1.0E10;	/// holding maximum score of the computed from each individual PDFs
-	float sx	= 0.0;
-	float xmu	= 0.0;
+	unsigned int j;
 
-	/// check if the score was already computed, if so, return the cached value
-	if(scores[Index] != 0.0) return scores[Index];
+	/// the scored part of the vector (and its squares for the dot product form)
+	for(j=0;j<m_iDim;j++) _pfInput[j] = _vector[m_iStrip_offset + j];
+	/// the scales of the precisions of the half float model are applied to the vector instead of each PDF
+	if(m_iQuant == EAR_AM_FP16) for(j=0;j<m_iDim;j++) _pfInput[j] *= am->Quant->fScale[m_iStrip_offset + j];
+	if(m_iForm == DOT) for(j=0;j<m_iDim;j++) _pfInput[m_iDim + j] = _pfInput[j] * _pfInput[j];
+}
 
-	/// get PDFs of the state to compute the score
-	pdfs = am->States[Index];
+inline float CAcousticScorer::pdfScore(unsigned int _iPdf, const float *_pfInput)
+{
+	unsigned int j;
+	const float *x = _pfInput;
+	float sx = 0.0, xmu;
 
-	/// go through PDFs and compute the overall score
-	for(i=0;i<am->iPdfsOnState;i++)
+	/// 8 bit indexes of the precisions and the scaled means, their values are in the tables of each coefficient
+	if(m_iQuant == EAR_AM_INT8)
 	{
-		/// if the PDF does not exists, skip and go to next one
-		/// this can happen as the model can have less PDFs for some state as originally stated
-		/// if the model was trained with HTK toolkit, the toolkit tends to drop some inefficient PDFs
-		/// and not include them to the resulting models.
-		if(pdfs[i] == NONE) continue;
+		const uint8_t *qs = (const uint8_t*)am->Quant->pData + (size_t)_iPdf * am->Quant->iStride + m_iStrip_offset;
+		const uint8_t *qb = qs + am->Quant->iStride / 2;
+		const float *ts = am->Quant->fTable + m_iStrip_offset * EAR_AM_LEVELS;
+		const float *tb = ts + am->Quant->iStride / 2 * EAR_AM_LEVELS;
 
-		/// get the PDF information for computing the score
-		pdf = &(am->Pdfs[pdfs[i]-1]);
+		#pragma omp simd reduction(+:sx)
+		for(j=0;j<m_iDim;j++)
+		{
+			xmu = x[j] * ts[j * EAR_AM_LEVELS + qs[j]] - tb[j * EAR_AM_LEVELS + qb[j]];
+			sx += xmu * xmu;
+		}
 
-		/// prepare working variables
-		xmu = 0.0; sx = 0.0;
+		return m_pfConst[_iPdf] - sx;
+	}
 
-		/// include precomputed value of the PDF
-		sx += pdf->fgconst;
+	/// half float precisions and scaled means, the vector is already scaled
+	if(m_iQuant == EAR_AM_FP16)
+	{
+		const uint16_t *hs = (const uint16_t*)am->Quant->pData + (size_t)_iPdf * am->Quant->iStride + m_iStrip_offset;
+		const uint16_t *hb = hs + am->Quant->iStride / 2;
 
-		/// compute the PDF
-		for(j=m_iStrip_offset;j<am->iVectorSize;j++)
+		#pragma omp simd reduction(+:sx)
+		for(j=0;j<m_iDim;j++)
 		{
-			xmu = (*(vector))[j] - pdf->fMean[j];
-			sx += xmu * xmu * pdf->fVar[j];
+			xmu = x[j] * halfToFloat(hs[j]) - halfToFloat(hb[j]);
+			sx += xmu * xmu;
 		}
 
-		/// half of it according formula.
-		sx *= -0.5;
+		return m_pfConst[_iPdf] - sx;
+	}
+
+	const float *row = m_pfTable + _iPdf * m_iStride;
 
-		/// we are working with the logarithm values always as the original values are getting really small,
-		/// and the precision of the computer is not sufficient and will round them to zero
-    sx += log(pdf->fWeight);
+	/// the dot product of the row with the input [x, x^2], the padding of both is zero
+	if(m_iForm == DOT)
+	{
+		#pragma omp simd reduction(+:sx)
+		for(j=0;j<m_iStride;j++) sx += row[j] * x[j];
 
-		/// we are computing the scores for each PDF function for the same state and instead of summing the probabilities
-		/// we take the maximum one.
-		if(sx > score) { score = sx; }
-  }
+		return m_pfConst[_iPdf] + sx;
+	}
+
+	/// weighted distance from the mean, the variance is already halved
+	const float *hvar = row + m_iDim;
+	#pragma omp simd reduction(+:sx)
+	for(j=0;j<m_iDim;j++)
+	{
+		xmu = x[j] - row[j];
+		sx += xmu * xmu * hvar[j];
+	}
+
+	return m_pfConst[_iPdf] - sx;
+}
+
+float CAcousticScorer::getScore(unsigned int _Index)
+{
+	unsigned int Index = _Index - 1;	/// as zero is reserved for empty symbol the indexes are shifted by one. The actual index of state in ascoustic model is less by one
+	float score;
+
+	/// the scores of the whole block are already computed
+	if(m_pfRow) return m_pfRow[Index];
+
+	/// check if the score was already computed, if so, return the cached value
+	if(m_piStamp[Index] == m_iGeneration) return scores[Index];
+
+	score = stateScore(Index, m_pfMix, NULL);
 
 	//register computed score
 	scores[Index] = score;
+	m_piStamp[Index] = m_iGeneration;
 
 	//return computed score
 	return score;
 }
+
+inline float CAcousticScorer::stateScore(unsigned int _iIndex, float *_pfMix, uint64_t *_piEvaluated)
+{
+	unsigned int i, n = 0, count;
+	unsigned int *pdfs;
+	float score;
+
+	/// only the PDFs from the shortlist of the current codeword
+	if(m_pShortlists)
+	{
+		pdfs = m_pShortlists + _iIndex * m_pSel->iShortlist;
+
+		/// if the PDF does not exists, skip and go to next one
+		/// this can happen as the shortlist of the state can be shorter than the others
+		if(_piEvaluated) { for(i=0;i<m_iShortlist;i++) if(pdfs[i] != NONE) _pfMix[n++] = pdfScore(pdfs[i]-1, m_pfInput); }
+		else { for(i=0;i<m_iShortlist;i++) if(pdfs[i] != NONE) _pfMix[n++] = sharedScore(pdfs[i]-1); }
+	}
+	else
+	{
+		/// get PDFs of the state to compute the score, the PDFs dropped by the HTK toolkit as inefficient are
+		/// already removed, so the states can have different number of the PDFs
+		pdfs = m_piStatePdfs + m_piStateStart[_iIndex];
+		count = m_piStateStart[_iIndex + 1] - m_piStateStart[_iIndex];
+
+		/// compute the PDF, we are working with the logarithm values always as the original values are getting really small,
+		/// and the precision of the computer is not sufficient and will round them to zero
+		if(_piEvaluated) { for(i=0;i<count;i++) _pfMix[n++] = pdfScore(pdfs[i], m_pfInput); }
+		else { for(i=0;i<count;i++) _pfMix[n++] = sharedScore(pdfs[i]); }
+	}
+
+	/// the workers do not share the cache of the PDFs, each PDF is counted
+	if(_piEvaluated) *_piEvaluated += n;
+
+	score = mixture(_pfMix, n);
+
+	/// the PDFs out of the shortlist are not scored, so the score is only bounded from below
+	if(m_pShortlists && score < m_fFloor) score = m_fFloor;
+
+	return score;
+}
+
+void CAcousticScorer::changeThreads(unsigned int _iThreads)
+{
+	m_pool.start(_iThreads);
+	if(am) allocWork();
+}
+
+void CAcousticScorer::allocWork()
+{
+	unsigned int i;
+
+	if(m_ppfWorkMix)
+	{
+		for(i=0;i<m_iWorkers;i++) freeAligned(m_ppfWorkMix[i]);
+		delete[] m_ppfWorkMix;
+	}
+	if(m_piWorkEvaluated) delete[] m_piWorkEvaluated;
+	if(m_piWork) delete[] m_piWork;
+
+	m_iWorkers = m_pool.size();
+	m_ppfWorkMix = new float*[m_iWorkers];
+	for(i=0;i<m_iWorkers;i++) m_ppfWorkMix[i] = allocAligned(am->iPdfsOnState);
+	m_piWorkEvaluated = new uint64_t[m_iWorkers];
+	m_piWork = new unsigned int[am->iNumberOfStates];
+	m_iWork = 0;
+}
+
+void CAcousticScorer::prefetch(const unsigned int *_piStates, unsigned int _iCount)
+{
+	unsigned int i, Index;
+
+	if(!isParallel()) return;
+
+	/// the states are stamped already when collected, so the repeated ones are computed only once, the cache is
+	/// not read before the pool finishes
+	for(i=0, m_iWork=0;i<_iCount;i++)
+	{
+		Index = _piStates[i] - 1;
+		if(m_piStamp[Index] == m_iGeneration) continue;
+		m_piStamp[Index] = m_iGeneration;
+		m_piWork[m_iWork++] = Index;
+	}
+	if(!m_iWork) return;
+
+	m_iNext = 0;
+	m_pool.run(scoreWork, this);
+
+	for(i=0;i<m_iWorkers;i++) m_iEvaluated += m_piWorkEvaluated[i];
+}
+
+void CAcousticScorer::scoreWork(void *_pArg, unsigned int _iWorker)
+{
+	CAcousticScorer *s = (CAcousticScorer*)_pArg;
+	uint64_t iEvaluated = 0;
+	unsigned int i;
+
+	/// the states are taken one by one, so the workers finish at about the same time
+	while((i = s->m_iNext.fetch_add(1)) < s->m_iWork)
+		s->scores[s->m_piWork[i]] = s->stateScore(s->m_piWork[i], s->m_ppfWorkMix[_iWorker], &iEvaluated);
+
+	s->m_piWorkEvaluated[_iWorker] = iEvaluated;
+}
+
+inline float CAcousticScorer::sharedScore(unsigned int _iPdf)
+{
+	/// no PDF is shared, each is computed once anyway
+	if(!m_piPdfStamp) { m_iEvaluated++; return pdfScore(_iPdf, m_pfInput); }
+
+	if(m_piPdfStamp[_iPdf] != m_iGeneration)
+	{
+		m_pfPdfScores[_iPdf] = pdfScore(_iPdf, m_pfInput);
+		m_piPdfStamp[_iPdf] = m_iGeneration;
+		m_iEvaluated++;
+	}
+
+	return m_pfPdfScores[_iPdf];
+}
+
+inline float CAcousticScorer::mixture(const float *_pfMix, unsigned int _iCount)
+{
+	unsigned int i;
+	float score = -1.0E10;	/// holding maximum score of the computed from each individual PDFs
+
+	/// we are computing the scores for each PDF function for the same state and instead of summing the probabilities
+	/// we take the maximum one.
+	for(i=0;i<_iCount;i++) if(_pfMix[i] > score) score = _pfMix[i];
+
+	/// the exact mixture likelihood, the sum is relative to the maximum, so it does not underflow
+	if(m_iMixture == SUM && _iCount > 1)
+	{
+		float sum = 0.0;
+		#pragma omp simd reduction(+:sum)
+		for(i=0;i<_iCount;i++) sum += expNeg(_pfMix[i] - score);
+		score += log(sum);
+	}
+
+	return score;
+}
+
+int CAcousticScorer::setBlock(CDataContainer *_vectors, unsigned int _iFrames)
+{
+	unsigned int i, k, p, s, t, n;
+
+	for(k=0;k<_iFrames;k++) if(_vectors[k].size() != am->iVectorSize) {
+		fprintf(stderr, "AcousticScorer: Incompatible features: model: %d, input: %d\n", am->iVectorSize, _vectors[k].size());
+		return EAR_FAIL;
+	}
+
+	/// buffers for the block, the padding of the vectors stays zero
+	if(_iFrames > m_iBlock)
+	{
+		if(m_pfBlockIn) freeAligned(m_pfBlockIn);
+		if(m_pfBlockLik) freeAligned(m_pfBlockLik);
+		if(m_pfBlockScores) freeAligned(m_pfBlockScores);
+		m_iBlock = _iFrames;
+		m_pfBlockIn = allocAligned(m_iBlock * m_iStride);
+		m_pfBlockLik = allocAligned(m_iBlock * am->iNumberOfPdfs);
+		m_pfBlockScores = allocAligned(m_iBlock * am->iNumberOfStates);
+		memset(m_pfBlockIn, 0, sizeof(float) * m_iBlock * m_iStride);
+	}
+	if(m_iQuant != EAR_AM_FLOAT && !m_pfTile) m_pfTile = allocAligned(SCORE_TILE * m_iStride);
+
+	/// the vectors are prepared the same way as the single one
+	for(k=0;k<_iFrames;k++) input(_vectors[k], m_pfBlockIn + k * m_iStride);
+
+	/// the same table as for the single vector, scored by the tiles of the PDFs that stay in the cache for all
+	/// vectors of the block, so the table is read from the memory once for the block, the quantized rows of the
+	/// tile are decoded once for the block too
+	for(p=0;p<am->iNumberOfPdfs;p+=SCORE_TILE)
+	{
+		t = am->iNumberOfPdfs - p < SCORE_TILE ? am->iNumberOfPdfs - p : SCORE_TILE;
+		if(m_iQuant == EAR_AM_FLOAT) scoreTile(m_pfTable + p * m_iStride, p, t, _iFrames);
+		else { decodeTile(p, t); scoreTile(m_pfTile, p, t, _iFrames); }
+	}
+
+	/// combine the PDF scores of all states for each vector
+	for(k=0;k<_iFrames;k++)
+	{
+		const float *lik = m_pfBlockLik + k * am->iNumberOfPdfs;
+		for(s=0;s<am->iNumberOfStates;s++)
+		{
+			for(i=m_piStateStart[s], n=0;i<m_piStateStart[s + 1];i++) m_pfMix[n++] = lik[m_piStatePdfs[i]];
+			m_pfBlockScores[k * am->iNumberOfStates + s] = mixture(m_pfMix, n);
+		}
+	}
+	m_iEvaluated += (uint64_t)_iFrames * am->iNumberOfPdfs;
+
+	m_pfRow = m_pfBlockScores;
+	return EAR_SUCCESS;
+}
+
+void CAcousticScorer::decodeTile(unsigned int _iFirst, unsigned int _iCount)
+{
+	unsigned int i, j;
+	const unsigned int iStride = am->Quant->iStride;
+
+	/// the precisions and the scaled means as they are used by the kernel of the single vector
+	for(i=0;i<_iCount;i++)
+	{
+		float *s = m_pfTile + i * m_iStride, *b = s + m_iDim;
+
+		if(m_iQuant == EAR_AM_INT8)
+		{
+			const uint8_t *qs = (const uint8_t*)am->Quant->pData + (size_t)(_iFirst + i) * iStride + m_iStrip_offset;
+			const uint8_t *qb = qs + iStride / 2;
+			const float *ts = am->Quant->fTable + m_iStrip_offset * EAR_AM_LEVELS;
+			const float *tb = ts + iStride / 2 * EAR_AM_LEVELS;
+
+			for(j=0;j<m_iDim;j++) { s[j] = ts[j * EAR_AM_LEVELS + qs[j]]; b[j] = tb[j * EAR_AM_LEVELS + qb[j]]; }
+		}
+		else
+		{
+			const uint16_t *hs = (const uint16_t*)am->Quant->pData + (size_t)(_iFirst + i) * iStride + m_iStrip_offset;
+			const uint16_t *hb = hs + iStride / 2;
+
+			#pragma omp simd
+			for(j=0;j<m_iDim;j++) { s[j] = halfToFloat(hs[j]); b[j] = halfToFloat(hb[j]); }
+		}
+	}
+}
+
+void CAcousticScorer::scoreTile(const float *_pfRows, unsigned int _iFirst, unsigned int _iCount, unsigned int _iFrames)
+{
+	unsigned int i, j, k, m;
+	const float *x[4];
+	float *l[4];
+
+	/// four vectors at once, so each value of the row loaded is used four times, the missing vectors of the last
+	/// four repeat the last vector (its scores are written more times)
+	for(k=0;k<_iFrames;k+=4)
+	{
+		for(m=0;m<4;m++)
+		{
+			x[m] = m_pfBlockIn + (k + m < _iFrames ? k + m : _iFrames - 1) * m_iStride;
+			l[m] = m_pfBlockLik + (k + m < _iFrames ? k + m : _iFrames - 1) * am->iNumberOfPdfs + _iFirst;
+		}
+		const float *x0 = x[0], *x1 = x[1], *x2 = x[2], *x3 = x[3];
+
+		for(i=0;i<_iCount;i++)
+		{
+			const float *row = _pfRows + i * m_iStride, *h = row + m_iDim;
+			const float c = m_pfConst[_iFirst + i];
+			float s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0, d0, d1, d2, d3;
+
+			/// the same formulas as in <i>pdfScore</i>
+			if(m_iForm == DOT)
+			{
+				#pragma omp simd reduction(+:s0,s1,s2,s3)
+				for(j=0;j<m_iStride;j++) { s0 += row[j] * x0[j]; s1 += row[j] * x1[j]; s2 += row[j] * x2[j]; s3 += row[j] * x3[j]; }
+				l[0][i] = c + s0; l[1][i] = c + s1; l[2][i] = c + s2; l[3][i] = c + s3;
+				continue;
+			}
+
+			if(m_iQuant != EAR_AM_FLOAT)
+			{
+				#pragma omp simd reduction(+:s0,s1,s2,s3)
+				for(j=0;j<m_iDim;j++)
+				{
+					d0 = x0[j] * row[j] - h[j]; d1 = x1[j] * row[j] - h[j]; d2 = x2[j] * row[j] - h[j]; d3 = x3[j] * row[j] - h[j];
+					s0 += d0 * d0; s1 += d1 * d1; s2 += d2 * d2; s3 += d3 * d3;
+				}
+			}
+			else
+			{
+				#pragma omp simd reduction(+:s0,s1,s2,s3)
+				for(j=0;j<m_iDim;j++)
+				{
+					d0 = x0[j] - row[j]; d1 = x1[j] - row[j]; d2 = x2[j] - row[j]; d3 = x3[j] - row[j];
+					s0 += d0 * d0 * h[j]; s1 += d1 * d1 * h[j]; s2 += d2 * d2 * h[j]; s3 += d3 * d3 * h[j];
+				}
+			}
+			l[0][i] = c - s0; l[1][i] = c - s1; l[2][i] = c - s2; l[3][i] = c - s3;
+		}
+	}
+}
+
+void CAcousticScorer::selectFrame(unsigned int _iFrame)
+{
+	m_pfRow = m_pfBlockScores + _iFrame * am->iNumberOfStates;
+}
@@ -25,7 +25,11 @@
 #ifndef __EAR_ACOUSTICSCORER_H_
 #define __EAR_ACOUSTICSCORER_H_
 
+#include <stdint.h>
+
 #include "../Data/Data.h"
+#include "Scorer.h"
+#include "WorkerPool.h"
 
 namespace Ear
 {
@@ -35,17 +39,35 @@ namespace Ear
 	* Some results are showing that skipping the basic coefficients from scoring
 	* is increasing the accuracy of the detection and classification.
 	*/
-	class CAcousticScorer
+	class CAcousticScorer : public AScorer
 	{
 	public:
 		CAcousticScorer();
 		~CAcousticScorer();
 
 	public:
-		/// Setting acoustic model that will be used for scoring purposes.
+		/// Formulation of the PDF score computation. All are precomputing the constant part of the score for each PDF
+		/// log(weight) - 0.5 * gconst when the model is set.
+		enum _ScoreForm_ {
+			FOLDED, ///< constant - sum((x - mean)^2 * 0.5 * ivar), computed directly on the quantized values for the quantized model
+			DOT     ///< quadratic expansion, constant + [mean * ivar, -0.5 * ivar] . [x, x^2], the constant includes -0.5 * sum(mean^2 * ivar)
+		};
+
+		/// Combination of the PDF scores of one state
+		enum _MixtureMode_ {
+			MAX, ///< maximum of the weighted PDF scores (Viterbi approximation of the mixture)
+			SUM  ///< logarithm of the sum of the weighted PDF likelihoods (exact likelihood of the mixture)
+		};
+
+	public:
+		/// Setting acoustic model that will be used for scoring purposes. The tables of the derived PDF values
+		/// for the selected formulation are built here, the single vector and the blocks are scored from the same table.
+		/// The variances and means of the PDFs are not used after that (see CDataHolder::releasePdfs), the quantized
+		/// values are, as they are scored directly in FOLDED form.
 		/// @param [in] _am acoustic model information in native format
 		/// @param [in] _iStrip_offset strip the first offset coefficients
-		void setAcousticModel(EAR_AM_Info *_am, unsigned int _iStrip_offset);
+		/// @param [in] _iForm formulation of the score computation (see _ScoreForm_)
+		void setAcousticModel(EAR_AM_Info *_am, unsigned int _iStrip_offset, unsigned int _iForm = FOLDED);
 		/// Getting the score for particular model. This function provides the scoring computation
 		/// @param [in] _Index the index of the state to score
 		/// @return total score computed using current vector and PDFs functions belogning to specified state
@@ -55,12 +77,141 @@ namespace Ear
 		/// @param [in] _vector Container containing the current input feature vector
 		/// @return success state of setting new vector for scoring
 		int set(CDataContainer *_vector);
+		/// Change the combination of the PDF scores of the state
+		/// @param [in] _iMode mixture mode (see _MixtureMode_)
+		void changeMixtureMode(unsigned int _iMode);
+		/// Set the Gaussian selection. The current vector is quantized to the nearest codeword of the selection
+		/// and only the PDFs in the shortlist of the codeword are scored for each state.
+		/// @param [in] _sel Gaussian selection of the model set in setAcousticModel, NULL disables the selection
+		/// @param [in] _iShortlist maximum number of the PDFs scored for each state, 0 for the whole shortlist
+		/// @param [in] _fFloor the lowest score of the state, protects against the PDFs missing in the shortlist
+		void setSelection(EAR_AM_Selection *_sel, unsigned int _iShortlist = 0, float _fFloor = LOG_ZERO);
+		/// Number of the PDF scores computed since the model was set
+		/// @return count of the computed PDF scores
+		uint64_t getEvaluated() {return m_iEvaluated;};
+		/// Score a block of the feature vectors at once. The log likelihoods of all PDFs for all vectors are computed
+		/// by the tiles of the table, each tile is read once for all vectors of the block, after that the scores of all
+		/// states are combined for each vector. The scores are the same as of the single vectors in the same form,
+		/// the Gaussian selection is not used here. The scores of the vector are used after the <i>selectFrame</i>.
+		/// @param [in] _vectors array of the feature vectors
+		/// @param [in] _iFrames number of the vectors in the array
+		/// @return success state of the function (fails if a vector does not match the model)
+		int setBlock(CDataContainer *_vectors, unsigned int _iFrames);
+		/// Use the scores of one vector of the block for the following calls of <i>getScore</i>
+		/// @param [in] _iFrame index of the vector in the block passed to <i>setBlock</i>
+		void selectFrame(unsigned int _iFrame);
+		/// Set the number of the threads computing the scores. With more than one thread the scores are not computed on request
+		/// in <i>getScore</i>, but the states needed for the current vector are passed to <i>prefetch</i> first and their scores
+		/// are computed by the pool of the workers at once.
+		/// @param [in] _iThreads number of the threads including the calling one (1 or 0 to compute the scores on request)
+		void changeThreads(unsigned int _iThreads);
+		/// @return true if the states needed for the current vector should be passed to <i>prefetch</i> before scoring
+		bool isParallel() {return m_pool.size() > 1 && !m_pfRow;};
+		/// Compute the scores of the states for the current vector by all threads, the following calls of <i>getScore</i>
+		/// for these states return the cached scores. The states already computed for the vector are skipped.
+		/// @param [in] _piStates indexes of the states in the same form as for <i>getScore</i>, can be repeated
+		/// @param [in] _iCount number of the states
+		void prefetch(const unsigned int *_piStates, unsigned int _iCount);
 
 	private:
 		EAR_AM_Info *am;	///< remembering the acoustic model pointer
 		float *scores;	///< scores already computed for particular input feature vector (caching purposes)
+		/// Generation of the cached scores, it is increased with each new vector. A cached score is valid only if its stamp
+		/// equals the current generation, so the cache is not cleared for each vector.
+		unsigned int m_iGeneration;
+		unsigned int *m_piStamp; ///< generation in which the score of each state was computed
 		CDataContainer *vector; ///< feature vector the will be used for scoring (current set)
 		unsigned int m_iStrip_offset; ///< set offset for scoring.
+
+		unsigned int m_iForm; ///< formulation of the score computation
+		unsigned int m_iDim; ///< number of the scored coefficients (without the stripped ones)
+		unsigned int m_iStride; ///< distance between the rows of the consecutive PDFs in the table
+		float *m_pfTable; ///< row for each PDF, [mean, 0.5 * ivar] for FOLDED or [mean * ivar, -0.5 * ivar] for DOT form
+		float *m_pfConst; ///< constant part of the score of each PDF
+		float *m_pfInput; ///< scored part of the current vector, [x] for FOLDED or [x, x^2] for DOT form
+		unsigned int m_iMixture; ///< combination of the PDF scores of the state
+		float *m_pfMix; ///< scores of the PDFs of one state for the log-sum-exp
+
+		EAR_AM_Selection *m_pSel; ///< Gaussian selection, NULL when all PDFs of the state are scored
+		unsigned int m_iShortlist; ///< number of the PDFs scored from the shortlist
+		float m_fFloor; ///< the lowest score of the state with the Gaussian selection
+		unsigned int *m_pShortlists; ///< shortlists of the codeword nearest to the current vector
+		uint64_t m_iEvaluated; ///< number of the computed PDF scores
+
+		unsigned int m_iBlock; ///< number of the vectors the block buffers are allocated for
+		float *m_pfBlockIn; ///< scored part of the vectors in the block, a row of <i>m_iStride</i> like <i>m_pfInput</i> for each vector
+		float *m_pfBlockLik; ///< scores of all PDFs for each vector in the block
+		float *m_pfBlockScores; ///< scores of all states for each vector in the block
+		float *m_pfTile; ///< precisions and scaled means of the quantized PDFs of one tile decoded for the block, rows like <i>m_pfTable</i>
+		float *m_pfRow; ///< scores of the states of the selected vector of the block, NULL when the single vector is set
+
+		unsigned int *m_piStateStart; ///< position of the first PDF of each state in <i>m_piStatePdfs</i>, one more for the end of the last state
+		unsigned int *m_piStatePdfs; ///< PDF indexes (from zero) of all states one after another, without the unused (NONE) ones
+		float *m_pfPdfScores; ///< scores of the PDFs computed for the current vector, used when the PDFs are shared by more states
+		unsigned int *m_piPdfStamp; ///< generation in which the score of each PDF was computed, NULL when no PDF is shared
+
+		unsigned int m_iQuant; ///< storage type of the scored PDFs, the quantized ones are used instead of the table in FOLDED form
+		float *m_pfPdf; ///< variances and means of one PDF dequantized for <i>pdfRow</i>, NULL for the float model
+
+		CWorkerPool m_pool; ///< threads computing the scores of the prefetched states
+		unsigned int *m_piWork; ///< indexes (from zero) of the states to compute by the pool
+		unsigned int m_iWork; ///< number of the states to compute by the pool
+		std::atomic<unsigned int> m_iNext; ///< position of the next state to compute in <i>m_piWork</i>
+		unsigned int m_iWorkers; ///< number of the workers the buffers are allocated for
+		float **m_ppfWorkMix; ///< buffer for the PDF scores of one state for each worker
+		uint64_t *m_piWorkEvaluated; ///< number of the PDF scores computed by each worker in the current job
+
+	private:
+		/// Prepare the scored part of the feature vector for the formulation
+		/// @param [in] _vector feature vector of the model size
+		/// @param [out] _pfInput <i>m_iStride</i> values, the padding is not written
+		void input(CDataContainer &_vector, float *_pfInput);
+		/// Compute the score of one PDF against the prepared vector
+		/// @param [in] _iPdf index of the PDF in the model (from zero)
+		/// @param [in] _pfInput vector prepared by <i>input</i>
+		/// @return logarithm of the weighted likelihood
+		inline float pdfScore(unsigned int _iPdf, const float *_pfInput);
+		/// Score of the PDF for the current vector, the PDFs shared by more states are computed only once for the vector
+		/// @param [in] _iPdf index of the PDF in the model (from zero)
+		/// @return logarithm of the weighted likelihood
+		inline float sharedScore(unsigned int _iPdf);
+		/// Combine the scores of the PDFs of one state by the mixture mode
+		/// @param [in] _pfMix scores of the PDFs
+		/// @param [in] _iCount number of the PDF scores
+		/// @return score of the state
+		inline float mixture(const float *_pfMix, unsigned int _iCount);
+		/// Compute the score of one state for the current vector
+		/// @param [in] _iIndex index of the state (from zero)
+		/// @param [in] _pfMix buffer for the scores of the PDFs of the state
+		/// @param [out] _piEvaluated counter of the computed PDF scores, NULL to use the cache of the shared PDFs instead (not thread safe)
+		/// @return score of the state
+		inline float stateScore(unsigned int _iIndex, float *_pfMix, uint64_t *_piEvaluated);
+		/// Job of the worker pool, computes the states from <i>m_piWork</i> until none is left
+		/// @param [in] _pArg scorer instance
+		/// @param [in] _iWorker index of the worker
+		static void scoreWork(void *_pArg, unsigned int _iWorker);
+		/// Allocate the buffers of the workers for the current model and number of the threads
+		void allocWork();
+		/// Derive the row of the table and the constant of the PDF for the formulation
+		/// @param [in] _iPdf index of the PDF in the model (from zero)
+		/// @param [in] _iForm formulation of the score computation (see _ScoreForm_)
+		/// @param [out] _row row of the table of 2 * m_iDim values
+		/// @return constant part of the score, -INFINITY for the broken PDFs
+		float pdfRow(unsigned int _iPdf, unsigned int _iForm, float *_row);
+		/// Decode the quantized PDFs of one tile to <i>m_pfTile</i>, [s, b] for each PDF
+		/// @param [in] _iFirst index of the first PDF of the tile (from zero)
+		/// @param [in] _iCount number of the PDFs of the tile
+		void decodeTile(unsigned int _iFirst, unsigned int _iCount);
+		/// Score the PDFs of one tile for all vectors of the block to <i>m_pfBlockLik</i>
+		/// @param [in] _pfRows rows of the PDFs of the tile in the layout of <i>m_pfTable</i>
+		/// @param [in] _iFirst index of the first PDF of the tile (from zero)
+		/// @param [in] _iCount number of the PDFs of the tile
+		/// @param [in] _iFrames number of the vectors in <i>m_pfBlockIn</i>
+		void scoreTile(const float *_pfRows, unsigned int _iFirst, unsigned int _iCount, unsigned int _iFrames);
+		/// Release the tables and buffers of the block scoring
+		void freeBlock();
+		/// Invalidate all cached scores by moving to the next generation
+		void nextGeneration();
 	};
 }
 
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ActivityGate.h"
+#include "../Data/Snapshot.h"
+
+using namespace Ear;
+
+CActivityGate::CActivityGate()
+{
+	m_pSearch = NULL;
+	m_pRoll = NULL;
+	m_piRoll = NULL;
+	m_iRoll = 0; m_iHead = 0; m_iCount = 0;
+	m_bOpen = true;
+}
+
+CActivityGate::~CActivityGate()
+{
+	if(m_pRoll) delete[] m_pRoll;
+	if(m_piRoll) delete[] m_piRoll;
+}
+
+unsigned int CActivityGate::initialize(CSearch *_pSearch, unsigned int _iPreRoll)
+{
+	if(!_pSearch || m_pSearch) return EAR_FAIL;
+	m_pSearch = _pSearch;
+
+	/// allocate the pre-roll buffer
+	m_iRoll = _iPreRoll;
+	if(m_iRoll) { m_pRoll = new CDataContainer[m_iRoll]; m_piRoll = new int64_t[m_iRoll]; }
+
+	reset();
+	return EAR_SUCCESS;
+}
+
+void CActivityGate::reset()
+{
+	m_iHead = 0; m_iCount = 0;
+	m_bOpen = true;
+}
+
+void CActivityGate::flush()
+{
+	unsigned int i;
+
+	/// the newest vector of the buffer is the last one skipped
+	if(m_bOpen || !m_iCount) return;
+	i = m_iHead + m_iCount - 1; if(i >= m_iRoll) i -= m_iRoll;
+	m_pSearch->fastForward(m_piRoll[i]);
+	m_iHead = 0; m_iCount = 0;
+}
+
+void CActivityGate::save(CSnapshot &_snap)
+{
+	unsigned int i, j;
+
+	_snap.write(&m_iRoll, sizeof(m_iRoll)); _snap.write(&m_bOpen, sizeof(m_bOpen));
+	/// the buffered vectors from the oldest one, the restored buffer starts at the beginning
+	_snap.write(&m_iCount, sizeof(m_iCount));
+	for(i=0, j=m_iHead;i<m_iCount;i++, j = j + 1 < m_iRoll ? j + 1 : 0) { _snap.write(m_pRoll[j]); _snap.write(&m_piRoll[j], sizeof(int64_t)); }
+}
+
+unsigned int CActivityGate::restore(CSnapshot &_snap)
+{
+	unsigned int iCount;
+
+	reset();
+	if(_snap.check(m_iRoll) == EAR_FAIL || _snap.read(&m_bOpen, sizeof(m_bOpen)) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(&iCount, sizeof(iCount)) == EAR_FAIL || iCount > m_iRoll) return EAR_FAIL;
+	for(;m_iCount<iCount;m_iCount++)
+		if(_snap.read(m_pRoll[m_iCount]) == EAR_FAIL || _snap.read(&m_piRoll[m_iCount], sizeof(int64_t)) == EAR_FAIL) { reset(); return EAR_FAIL; }
+	return EAR_SUCCESS;
+}
+
+unsigned int CActivityGate::process(CDataContainer &_pData, int64_t _iIndex, bool _bActive)
+{
+	unsigned int i, ret;
+
+	if(!_pData.size()) return EAR_FAIL;
+
+	/// no activity, remember the vector, the decoder is moved in time only over the vectors leaving the pre-roll, so
+	/// each vector is either skipped or decoded once and the time of the decoder never goes back
+	if(!_bActive)
+	{
+		m_bOpen = false;
+		if(!m_iRoll) { m_pSearch->fastForward(_iIndex); return EAR_SUCCESS; }
+
+		/// the buffer is full, the oldest vector is skipped and rewritten
+		i = m_iHead + m_iCount; if(i >= m_iRoll) i -= m_iRoll;
+		if(m_iCount == m_iRoll) { m_pSearch->fastForward(m_piRoll[m_iHead]); m_iHead++; if(m_iHead >= m_iRoll) m_iHead = 0; }
+		else m_iCount++;
+
+		m_pRoll[i].copy(&_pData); m_piRoll[i] = _iIndex;
+		return EAR_SUCCESS;
+	}
+
+	/// the gate is opening, replay the pre-roll from the oldest vector
+	if(!m_bOpen)
+	{
+		for(; m_iCount; m_iCount--)
+		{
+			ret = m_pSearch->process(m_pRoll[m_iHead], m_piRoll[m_iHead]);
+			if(ret == EAR_FAIL) return EAR_FAIL;
+			m_iHead++; if(m_iHead >= m_iRoll) m_iHead = 0;
+		}
+		m_iHead = 0; m_bOpen = true;
+	}
+
+	return m_pSearch->process(_pData, _iIndex);
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+ /**
+ *	Gating of the decoding process by the activity in the input signal.
+ */
+
+#ifndef __EAR_ACTIVITYGATE_H_
+#define __EAR_ACTIVITYGATE_H_
+
+#include "../Data/Data.h"
+#include "Search.h"
+
+namespace Ear
+{
+	/**
+	* Gate in front of the search process. While the gate is closed (no activity in the input signal) the feature vectors
+	* are not scored nor propagated through the search network, the decoder is only fast-forwarded in time and stays in the
+	* hypothesis it had, normally the background. The last feature vectors are remembered in the pre-roll buffer and when the
+	* gate opens they are replayed into the decoder first, so the beginning of the event is not lost. The decoder is
+	* fast-forwarded only over the vectors leaving the buffer, so the decoder is behind the input by the buffered vectors
+	* while the gate is closed, and a pause shorter than the pre-roll is decoded the same as without the gate.
+	*/
+	class CActivityGate
+	{
+	public:
+		CActivityGate();
+		~CActivityGate();
+
+	private:
+		CSearch *m_pSearch; ///< gated search instance
+		CDataContainer *m_pRoll; ///< circular pre-roll buffer of the feature vectors
+		int64_t *m_piRoll; ///< time indexes of the feature vectors in the pre-roll buffer
+		unsigned int m_iRoll; ///< size of the pre-roll buffer
+		unsigned int m_iHead; ///< position of the oldest feature vector in the pre-roll buffer
+		unsigned int m_iCount; ///< number of feature vectors in the pre-roll buffer
+		bool m_bOpen; ///< state of the gate
+
+	public:
+		/// Initialize the gate.
+		/// @param [in] _pSearch search instance to feed with the feature vectors
+		/// @param [in] _iPreRoll number of the feature vectors to replay when the gate opens
+		/// @return success of the initialization
+		unsigned int initialize(CSearch *_pSearch, unsigned int _iPreRoll);
+		/// Process new feature vector. If the activity is present, the vector is passed to the search process (after the
+		/// pre-roll buffer if the gate was closed). Otherwise the vector is remembered and the decoder is fast-forwarded
+		/// over the oldest vector of the full buffer.
+		/// @param [in] _pData Container containing new feature vector
+		/// @param [in] _iIndex time index of the feature vector
+		/// @param [in] _bActive activity decision for the feature vector
+		/// @return success status of the search process
+		unsigned int process(CDataContainer &_pData, int64_t _iIndex, bool _bActive);
+		/// @return true if the feature vectors are passed to the search process
+		bool isOpen(){ return m_bOpen; }
+		/// Fast-forward the decoder over the vectors waiting in the pre-roll buffer of the closed gate, at the end of the input.
+		/// The buffer is emptied, the gate stays closed.
+		void flush();
+		/// Forget the content of the pre-roll buffer and open the gate, used together with resetting the decoder.
+		void reset();
+		/// Write the state of the gate and the pre-roll buffer to the snapshot, the search is saved separately
+		/// @param [in, out] _snap the snapshot
+		void save(CSnapshot &_snap);
+		/// Read the state of the gate written by <i>save</i>
+		/// @param [in, out] _snap the snapshot
+		/// @return EAR_FAIL if the snapshot was written with different pre-roll length
+		unsigned int restore(CSnapshot &_snap);
+	};
+}
+
+#endif
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "BatchSearch.h"
+
+using namespace Ear;
+
+CBatchSearch::CBatchSearch()
+{
+	m_pScorer = NULL;
+	m_pSearch = NULL;
+	m_iStreams = 0;
+	m_pVectors = NULL;
+	m_piActive = NULL;
+}
+
+CBatchSearch::~CBatchSearch()
+{
+	if(m_pSearch) delete[] m_pSearch;
+	if(m_pVectors) delete[] m_pVectors;
+	if(m_piActive) delete[] m_piActive;
+}
+
+unsigned int CBatchSearch::initialize(EAR_FST_Net *_pNet, AScorer *_pScorer, float _fWordInsPenalty, unsigned int _iStreams, unsigned int _iDenseStates)
+{
+	unsigned int i;
+
+	if(!_pNet || !_pScorer || !_iStreams || m_pSearch) return EAR_FAIL;
+	/// the block of the scorer holds the vectors of different streams
+	if(_pScorer->getContext()) return EAR_FAIL;
+
+	m_pScorer = _pScorer;
+	m_iStreams = _iStreams;
+	m_pSearch = new CSearch[m_iStreams];
+	m_pVectors = new CDataContainer[m_iStreams];
+	m_piActive = new unsigned int[m_iStreams];
+
+	for(i=0;i<m_iStreams;i++) if(m_pSearch[i].initialize(_pNet, _pScorer, _fWordInsPenalty, _iDenseStates) == EAR_FAIL) return EAR_FAIL;
+
+	return EAR_SUCCESS;
+}
+
+unsigned int CBatchSearch::process(CDataContainer *_pData, int64_t _iIndex)
+{
+	unsigned int i, n = 0;
+	CDataContainer *pBlock = _pData;
+
+	if(!m_pSearch) return EAR_FAIL;
+
+	/// the streams without a vector only move in time
+	for(i=0;i<m_iStreams;i++)
+	{
+		if(_pData[i].size()) m_piActive[n++] = i;
+		else m_pSearch[i].fastForward(_iIndex);
+	}
+	if(!n) return EAR_SUCCESS;
+
+	/// the vectors of the active streams need to be one block, they are copied only if some stream is missing
+	if(n < m_iStreams)
+	{
+		for(i=0;i<n;i++) m_pVectors[i].copy(&_pData[m_piActive[i]]);
+		pBlock = m_pVectors;
+	}
+
+	/// score all vectors at once and propagate each stream by its own
+	if(m_pScorer->setBlock(pBlock, n) == EAR_FAIL) return EAR_FAIL;
+	for(i=0;i<n;i++)
+	{
+		m_pScorer->selectFrame(i);
+		if(m_pSearch[m_piActive[i]].processScored(_iIndex) == EAR_FAIL) return EAR_FAIL;
+	}
+
+	return EAR_SUCCESS;
+}
+
+void CBatchSearch::reset()
+{
+	for(unsigned int i=0;i<m_iStreams;i++) m_pSearch[i].reset();
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+ /**
+ *	Decoding of more input streams by one network and one scorer in lockstep.
+ */
+
+#ifndef __EAR_BATCHSEARCH_H_
+#define __EAR_BATCHSEARCH_H_
+
+#include "../Data/Data.h"
+#include "Scorer.h"
+#include "Search.h"
+
+namespace Ear
+{
+	/**
+	*	Lockstep decoding of more streams (e.g. microphones) with the same model. Each stream has its own search instance,
+	* they are kept one after another in one array, but all of them share the search network and the scorer. The streams
+	* are advanced by one feature vector at once, the vectors of all streams are scored as one block by the scorer (see
+	* <i>CAcousticScorer::setBlock</i>) while the model is read only once,
+	* and then the tokens of the streams are propagated one stream after another.
+	*
+	* The scorer can not depend on the previous vectors of the input (see <i>AScorer::getContext</i>), as the block holds
+	* the vectors of different streams. The results, the resets and the other settings of the streams are available
+	* by their search instances, except the frame skipping and the block scoring, which the streams can not use.
+	*/
+	class CBatchSearch
+	{
+	public:
+		CBatchSearch();
+		~CBatchSearch();
+
+	private:
+		AScorer *m_pScorer; ///< scorer shared by the streams
+		CSearch *m_pSearch; ///< search instances of the streams
+		unsigned int m_iStreams; ///< number of the streams
+		CDataContainer *m_pVectors; ///< feature vectors of the streams with a vector, when some stream has none
+		unsigned int *m_piActive; ///< streams with a feature vector in the current time
+
+	public:
+		/// Create the search instances of the streams
+		/// @param [in] _pNet search network
+		/// @param [in] _pScorer scorer shared by all streams
+		/// @param [in] _fWordInsPenalty insertion penalty (see <i>CSearch::initialize</i>)
+		/// @param [in] _iStreams number of the streams
+		/// @param [in] _iDenseStates the networks up to this number of the states are decoded by the dense Viterbi
+		/// @return EAR_FAIL if the search instances can not be created or the scorer depends on the previous vectors
+		unsigned int initialize(EAR_FST_Net *_pNet, AScorer *_pScorer, float _fWordInsPenalty, unsigned int _iStreams, unsigned int _iDenseStates = SEARCH_DENSE_STATES);
+		/// Consume one feature vector of each stream. The vectors are scored at once and the tokens of each stream are
+		/// propagated by its vector. The streams without a vector (empty container) are only fast-forwarded
+		/// (see <i>CSearch::fastForward</i>), their hypotheses get the mean score per vector of the best one instead of
+		/// a score of the missing vector.
+		/// @param [in] _pData array of the feature vectors, one for each stream
+		/// @param [in] _iIndex time index of the vectors
+		/// @return success status of the process (EAR_FAIL if a vector does not match with the acoustic model or some
+		/// stream has the frame skipping or the block scoring set)
+		unsigned int process(CDataContainer *_pData, int64_t _iIndex);
+		/// Reset the decoding of all streams
+		void reset();
+		/// @param [in] _iStream index of the stream
+		/// @return search instance of the stream, NULL if there is no such stream
+		CSearch *getStream(unsigned int _iStream) {return _iStream < m_iStreams ? m_pSearch + _iStream : NULL;};
+		/// @return number of the streams
+		unsigned int size() {return m_iStreams;};
+	};
+}
+
+#endif
@@ -0,0 +1,387 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <math.h>
+#include <algorithm>
+
+#include "Confidence.h"
+#include "../Data/Snapshot.h"
+
+using namespace Ear;
+
+CConfidence::CConfidence()
+{
+	m_iStates = 0; m_iSymbols = 0; m_iInputs = 0; m_piSymbol = NULL;
+	m_iFull = 0; m_piFullFrom = NULL; m_piFullTo = NULL; m_piFullIn = NULL; m_pfFullNet = NULL; m_piFullChange = NULL; m_pdFull = NULL;
+	m_iEmpty = 0; m_piEmptyFrom = NULL; m_piEmptyTo = NULL; m_pfEmptyNet = NULL; m_piEmptyChange = NULL; m_pdEmpty = NULL;
+	m_fScale = 1; m_dBeam = 0; m_iWindow = 0; m_iSlots = 1;
+	m_pdAlpha = NULL; m_pdEntry = NULL; m_pdInput = NULL; m_pdLimit = NULL;
+	m_piStamp = NULL; m_pfScore = NULL; m_piNeeded = NULL;
+	m_pdBeta = NULL; m_pdNext = NULL; m_pfPost = NULL;
+	m_iSteps = 0; m_iFirst = 0; m_iBase = 0;
+}
+
+CConfidence::~CConfidence()
+{
+	if(m_piSymbol) delete[] m_piSymbol;
+	if(m_piFullFrom) delete[] m_piFullFrom;
+	if(m_piFullTo) delete[] m_piFullTo;
+	if(m_piFullIn) delete[] m_piFullIn;
+	if(m_pfFullNet) delete[] m_pfFullNet;
+	if(m_piFullChange) delete[] m_piFullChange;
+	if(m_pdFull) delete[] m_pdFull;
+	if(m_piEmptyFrom) delete[] m_piEmptyFrom;
+	if(m_piEmptyTo) delete[] m_piEmptyTo;
+	if(m_pfEmptyNet) delete[] m_pfEmptyNet;
+	if(m_piEmptyChange) delete[] m_piEmptyChange;
+	if(m_pdEmpty) delete[] m_pdEmpty;
+	if(m_pdAlpha) delete[] m_pdAlpha;
+	if(m_pdEntry) delete[] m_pdEntry;
+	if(m_pdInput) delete[] m_pdInput;
+	if(m_pdLimit) delete[] m_pdLimit;
+	if(m_piStamp) delete[] m_piStamp;
+	if(m_pfScore) delete[] m_pfScore;
+	if(m_piNeeded) delete[] m_piNeeded;
+	if(m_pdBeta) delete[] m_pdBeta;
+	if(m_pdNext) delete[] m_pdNext;
+	if(m_pfPost) delete[] m_pfPost;
+}
+
+unsigned int CConfidence::initialize(EAR_FST_Net *_pNet, unsigned int _iStates, float _fScale, float _fBeam, unsigned int _iWindow, const float *_pfPenalty, unsigned int _iSkip)
+{
+	unsigned int i, j, n, iFrom, iTo, iSym;
+	std::vector<unsigned int> order, rank, in;
+	std::vector<bool> seen;
+	bool bChange = true;
+
+	if(!_pNet || m_piSymbol || _fScale <= 0) return EAR_FAIL;
+	m_iStates = _iStates; m_fScale = _fScale; m_dBeam = exp(-_fBeam); m_iWindow = _iWindow;
+
+	/// the transitions to the end state do not lead to any state, the others are split by the input symbol
+	for(i=0;i<_pNet->iSize;i++)
+	{
+		if(_pNet->pNet[i].iEnd == UNDEF_STATE || _pNet->pNet[i].iEnd == END_STATE) continue;
+		if(_pNet->pNet[i].iIn == EPS_SYM) m_iEmpty++; else m_iFull++;
+		if(_pNet->pNet[i].iOut >= m_iSymbols) m_iSymbols = _pNet->pNet[i].iOut + 1;
+		if(_pNet->pNet[i].iIn >= m_iInputs) m_iInputs = _pNet->pNet[i].iIn + 1;
+	}
+	m_piFullFrom = new unsigned int[m_iFull]; m_piFullTo = new unsigned int[m_iFull]; m_piFullIn = new unsigned int[m_iFull];
+	m_pfFullNet = new float[m_iFull]; m_pdFull = new double[m_iFull]; m_piFullChange = new unsigned int[m_iFull];
+	m_piEmptyFrom = new unsigned int[m_iEmpty]; m_piEmptyTo = new unsigned int[m_iEmpty];
+	m_pfEmptyNet = new float[m_iEmpty]; m_pdEmpty = new double[m_iEmpty]; m_piEmptyChange = new unsigned int[m_iEmpty];
+
+	/// the symbol of the state is the one on the transitions entering it, or the one of their start state if they do not have
+	/// any, repeated until no state changes
+	m_piSymbol = new unsigned int[m_iStates];
+	seen.assign(m_iStates, false);
+	for(i=0;i<m_iStates;i++) m_piSymbol[i] = NONE;
+	while(bChange)
+	{
+		bChange = false;
+		for(i=0;i<_pNet->iSize;i++)
+		{
+			if(_pNet->pNet[i].iEnd == UNDEF_STATE || _pNet->pNet[i].iEnd == END_STATE) continue;
+			iFrom = _pNet->pNet[i].iStart; iTo = _pNet->pNet[_pNet->pNet[i].iEnd].iStart;
+			if(!_pNet->pNet[i].iOut && !seen[iFrom]) continue;
+			iSym = _pNet->pNet[i].iOut ? _pNet->pNet[i].iOut : m_piSymbol[iFrom];
+
+			if(!seen[iTo]) { seen[iTo] = true; m_piSymbol[iTo] = iSym; bChange = true; }
+			else if(m_piSymbol[iTo] != iSym && m_piSymbol[iTo] != NONE) { m_piSymbol[iTo] = NONE; bChange = true; }
+		}
+	}
+
+	/// the empty transitions are ordered by their start states, so the state has all its scores before it passes them on
+	rank.assign(m_iStates, 0); in.assign(m_iStates, 0);
+	for(i=0;i<_pNet->iSize;i++)
+	{
+		if(_pNet->pNet[i].iEnd == UNDEF_STATE || _pNet->pNet[i].iEnd == END_STATE || _pNet->pNet[i].iIn != EPS_SYM) continue;
+		in[_pNet->pNet[_pNet->pNet[i].iEnd].iStart]++;
+	}
+	for(i=0;i<m_iStates;i++) if(!in[i]) order.push_back(i);
+	for(n=0;n<order.size();n++)
+	{
+		rank[order[n]] = n;
+		/// the transitions of one state follow each other in the network
+		for(i=0;i<_pNet->iSize;i++)
+		{
+			if(_pNet->pNet[i].iStart != order[n]) continue;
+			for(;i<_pNet->iSize && _pNet->pNet[i].iStart == order[n];i++)
+			{
+				if(_pNet->pNet[i].iEnd == UNDEF_STATE || _pNet->pNet[i].iEnd == END_STATE || _pNet->pNet[i].iIn != EPS_SYM) continue;
+				if(!--in[_pNet->pNet[_pNet->pNet[i].iEnd].iStart]) order.push_back(_pNet->pNet[_pNet->pNet[i].iEnd].iStart);
+			}
+			break;
+		}
+	}
+	if(order.size() < m_iStates) return EAR_FAIL;
+
+	/// the transitions, the symbol is changed the same way as by the tokens, if the start state has another one
+	for(i=0, j=0, n=0;i<_pNet->iSize;i++)
+	{
+		if(_pNet->pNet[i].iEnd == UNDEF_STATE || _pNet->pNet[i].iEnd == END_STATE) continue;
+		iFrom = _pNet->pNet[i].iStart; iTo = _pNet->pNet[_pNet->pNet[i].iEnd].iStart;
+		iSym = _pNet->pNet[i].iOut != m_piSymbol[iFrom] ? _pNet->pNet[i].iOut : EPS_SYM;
+		if(_pNet->pNet[i].iIn != EPS_SYM)
+		{
+			m_piFullFrom[j] = iFrom; m_piFullTo[j] = iTo; m_piFullIn[j] = _pNet->pNet[i].iIn;
+			m_pfFullNet[j] = -_pNet->pNet[i].fWeight; m_piFullChange[j] = iSym; j++;
+		}
+		else
+		{
+			m_piEmptyFrom[n] = iFrom; m_piEmptyTo[n] = iTo;
+			m_pfEmptyNet[n] = -_pNet->pNet[i].fWeight; m_piEmptyChange[n] = iSym; n++;
+		}
+	}
+	for(i=1;i<m_iEmpty;i++)
+	{
+		/// insertion keeps the order of the transitions of one state
+		for(j=i;j>0 && rank[m_piEmptyFrom[j - 1]] > rank[m_piEmptyFrom[j]];j--)
+		{
+			std::swap(m_piEmptyFrom[j], m_piEmptyFrom[j - 1]); std::swap(m_piEmptyTo[j], m_piEmptyTo[j - 1]);
+			std::swap(m_pfEmptyNet[j], m_pfEmptyNet[j - 1]); std::swap(m_piEmptyChange[j], m_piEmptyChange[j - 1]);
+		}
+	}
+	weigh(_pfPenalty, _iSkip);
+
+	/// the probabilities of the vectors in the window are kept for the backward pass, two windows long
+	m_iSlots = m_iWindow ? 2 * m_iWindow : 1;
+	m_pdAlpha = new double[m_iStates * m_iSlots];
+	m_pdEntry = new double[m_iStates * m_iSlots];
+	m_pdInput = new double[m_iInputs * m_iSlots];
+	m_pdLimit = new double[m_iSlots];
+	m_piStamp = new unsigned int[m_iInputs];
+	m_pfScore = new float[m_iInputs];
+	m_piNeeded = new unsigned int[m_iInputs];
+	m_pdBeta = new double[m_iStates]; m_pdNext = new double[m_iStates];
+	m_pfPost = new float[m_iSymbols];
+
+	reset();
+	return EAR_SUCCESS;
+}
+
+void CConfidence::weigh(const float *_pfPenalty, unsigned int _iSkip)
+{
+	unsigned int i;
+
+	for(i=0;i<m_iFull;i++) m_pdFull[i] = exp(m_fScale * (m_pfFullNet[i]*_iSkip + _pfPenalty[m_piFullChange[i]]));
+	for(i=0;i<m_iEmpty;i++) m_pdEmpty[i] = exp(m_fScale * (m_pfEmptyNet[i] + _pfPenalty[m_piEmptyChange[i]]));
+}
+
+void CConfidence::reset()
+{
+	unsigned int i;
+	double *pdAlpha = m_pdAlpha + (m_iSlots - 1) * m_iStates;
+
+	/// all paths start in the start state, the empty transitions are passed at once, the vector before the first one
+	/// is the last slot
+	for(i=0;i<m_iStates;i++) pdAlpha[i] = 0;
+	pdAlpha[START_STATE] = 1;
+	for(i=0;i<m_iEmpty;i++) pdAlpha[m_piEmptyTo[i]] += pdAlpha[m_piEmptyFrom[i]] * m_pdEmpty[i];
+	m_pdLimit[m_iSlots - 1] = m_dBeam;
+
+	for(i=0;i<m_iInputs;i++) m_piStamp[i] = NONE;
+	m_iSteps = 0; m_iFirst = 0; m_iBase = 0;
+	m_index.clear();
+	m_sum.assign(m_iSymbols, 0);
+}
+
+void CConfidence::step(AScorer *_pScorer, unsigned int _iSkip, int64_t _iIndex)
+{
+	unsigned int i, n = 0, iSlot = m_iSteps % m_iSlots;
+	const double *pdPrev = m_pdAlpha + ((m_iSteps + m_iSlots - 1) % m_iSlots) * m_iStates;
+	double *pdAlpha = m_pdAlpha + iSlot * m_iStates, *pdEntry = m_pdEntry + iSlot * m_iStates, *pdInput = m_pdInput + iSlot * m_iInputs;
+	double dLimit = m_pdLimit[(m_iSteps + m_iSlots - 1) % m_iSlots], dMax = 0;
+	float fMax = LOG_ZERO, fScale = m_fScale * _iSkip;
+	double *pdRow;
+
+	/// the input symbols of the transitions followed from the states above the beam
+	for(i=0;i<m_iFull;i++)
+	{
+		if(pdPrev[m_piFullFrom[i]] < dLimit || m_piStamp[m_piFullIn[i]] == m_iSteps) continue;
+		m_piStamp[m_piFullIn[i]] = m_iSteps; m_piNeeded[n++] = m_piFullIn[i];
+		m_pfScore[m_piFullIn[i]] = fScale * _pScorer->getScore(m_piFullIn[i]);
+		if(m_pfScore[m_piFullIn[i]] > fMax) fMax = m_pfScore[m_piFullIn[i]];
+	}
+	for(i=0;i<n;i++) pdInput[m_piNeeded[i]] = exp(m_pfScore[m_piNeeded[i]] - fMax);
+
+	/// the sum of the paths entering each state by the vector
+	for(i=0;i<m_iStates;i++) pdEntry[i] = 0;
+	for(i=0;i<m_iFull;i++)
+	{
+		if(pdPrev[m_piFullFrom[i]] < dLimit) continue;
+		pdEntry[m_piFullTo[i]] += pdPrev[m_piFullFrom[i]] * m_pdFull[i] * pdInput[m_piFullIn[i]];
+	}
+
+	/// relative to the best state again
+	for(i=0;i<m_iStates;i++) if(pdEntry[i] > dMax) dMax = pdEntry[i];
+	if(dMax > 0) for(i=0;i<m_iStates;i++) pdEntry[i] /= dMax;
+	for(i=0;i<m_iStates;i++) pdAlpha[i] = pdEntry[i];
+	for(i=0;i<m_iEmpty;i++) pdAlpha[m_piEmptyTo[i]] += pdAlpha[m_piEmptyFrom[i]] * m_pdEmpty[i];
+	for(i=0, dMax=0;i<m_iStates;i++) if(pdAlpha[i] > dMax) dMax = pdAlpha[i];
+	m_pdLimit[iSlot] = dMax * m_dBeam;
+
+	/// the posteriors from the past vectors, replaced by the backward pass later
+	posteriors(pdEntry, NULL);
+	m_index.push_back(_iIndex);
+	m_sum.resize(m_sum.size() + m_iSymbols);
+	pdRow = &m_sum[m_sum.size() - m_iSymbols];
+	for(i=0;i<m_iSymbols;i++) pdRow[i] = pdRow[(int)i - (int)m_iSymbols] + m_pfPost[i];
+	m_iSteps++;
+
+	if(!m_iWindow) m_iFirst = m_iSteps;
+	else if(m_iSteps - m_iFirst == m_iSlots) backward();
+}
+
+void CConfidence::posteriors(const double *_pdEntry, const double *_pdBeta)
+{
+	unsigned int i;
+	double dSum = 0, d;
+
+	/// the states without the symbol are in the sum of all paths only
+	for(i=0;i<m_iSymbols;i++) m_pfPost[i] = 0;
+	for(i=0;i<m_iStates;i++)
+	{
+		d = _pdBeta ? _pdEntry[i] * _pdBeta[i] : _pdEntry[i];
+		dSum += d;
+		if(m_piSymbol[i] != NONE) m_pfPost[m_piSymbol[i]] += d;
+	}
+	if(dSum > 0) for(i=0;i<m_iSymbols;i++) m_pfPost[i] /= dSum;
+}
+
+void CConfidence::backward()
+{
+	unsigned int i, t, k, iLast = m_iSteps - m_iWindow, iSlot, iPrev;
+	std::vector<float> post((iLast - m_iFirst) * m_iSymbols);
+	std::vector<double> prev;
+	double dMax, *pdInput, *pdRow, dPost;
+
+	/// nothing is known after the last vector
+	for(i=0;i<m_iStates;i++) m_pdNext[i] = 1;
+
+	for(t=m_iSteps;t-->m_iFirst;)
+	{
+		iSlot = t % m_iSlots;
+
+		/// the posteriors of the vectors with the whole window after them
+		if(t < iLast)
+		{
+			posteriors(m_pdEntry + iSlot * m_iStates, m_pdNext);
+			for(k=0;k<m_iSymbols;k++) post[(t - m_iFirst) * m_iSymbols + k] = m_pfPost[k];
+		}
+		if(t == m_iFirst) break;
+
+		/// the states of the previous time continue by the same transitions as followed by the forward pass and then
+		/// by the empty ones
+		iPrev = (t - 1) % m_iSlots; pdInput = m_pdInput + iSlot * m_iInputs;
+		for(i=0;i<m_iStates;i++) m_pdBeta[i] = 0;
+		for(i=0;i<m_iFull;i++)
+		{
+			if(m_pdAlpha[iPrev * m_iStates + m_piFullFrom[i]] < m_pdLimit[iPrev]) continue;
+			m_pdBeta[m_piFullFrom[i]] += m_pdFull[i] * pdInput[m_piFullIn[i]] * m_pdNext[m_piFullTo[i]];
+		}
+		for(i=m_iEmpty;i-->0;) m_pdBeta[m_piEmptyFrom[i]] += m_pdEmpty[i] * m_pdBeta[m_piEmptyTo[i]];
+
+		for(i=0, dMax=0;i<m_iStates;i++) if(m_pdBeta[i] > dMax) dMax = m_pdBeta[i];
+		for(i=0;i<m_iStates;i++) m_pdNext[i] = dMax > 0 ? m_pdBeta[i] / dMax : 0;
+	}
+
+	/// the cumulative rows are summed again from the replaced posteriors, the later ones keep their own
+	pdRow = &m_sum[(m_iFirst - m_iBase) * m_iSymbols];
+	prev.assign(pdRow, pdRow + m_iSymbols);
+	for(t=m_iFirst;t<m_iSteps;t++)
+	{
+		pdRow = &m_sum[(t + 1 - m_iBase) * m_iSymbols];
+		for(k=0;k<m_iSymbols;k++)
+		{
+			dPost = t < iLast ? post[(t - m_iFirst) * m_iSymbols + k] : pdRow[k] - prev[k];
+			prev[k] = pdRow[k];
+			pdRow[k] = pdRow[(int)k - (int)m_iSymbols] + dPost;
+		}
+	}
+
+	m_iFirst = iLast;
+}
+
+float CConfidence::get(const CResult &_event)
+{
+	std::vector<int64_t>::iterator first, last;
+	unsigned int iFirst, iLast;
+
+	if(_event.iId >= m_iSymbols) return 1;
+
+	/// the vectors of the event, its duration ends by the next one
+	first = std::lower_bound(m_index.begin(), m_index.end(), _event.iRevIndex);
+	last = std::lower_bound(first, m_index.end(), _event.iRevIndex + _event.iDur);
+	if(first == last) return 1;
+
+	iFirst = first - m_index.begin(); iLast = last - m_index.begin();
+	return (float)((m_sum[iLast * m_iSymbols + _event.iId] - m_sum[iFirst * m_iSymbols + _event.iId]) / (iLast - iFirst));
+}
+
+void CConfidence::release(int64_t _iIndex)
+{
+	unsigned int n = std::lower_bound(m_index.begin(), m_index.end(), _iIndex) - m_index.begin();
+
+	/// the vectors waiting for the backward pass stay
+	if(n > m_iFirst - m_iBase) n = m_iFirst - m_iBase;
+
+	/// the arrays are moved only when the released part is at least as long as the rest, so each row is moved once on average
+	if(!n || 2 * n < m_index.size()) return;
+	m_index.erase(m_index.begin(), m_index.begin() + n);
+	m_sum.erase(m_sum.begin(), m_sum.begin() + n * m_iSymbols);
+	m_iBase += n;
+}
+
+void CConfidence::save(CSnapshot &_snap)
+{
+	unsigned int iKept = m_index.size();
+
+	_snap.write(&m_iStates, sizeof(m_iStates)); _snap.write(&m_iInputs, sizeof(m_iInputs));
+	_snap.write(&m_iSymbols, sizeof(m_iSymbols)); _snap.write(&m_iSlots, sizeof(m_iSlots));
+	_snap.write(&m_iSteps, sizeof(m_iSteps)); _snap.write(&m_iFirst, sizeof(m_iFirst)); _snap.write(&m_iBase, sizeof(m_iBase));
+	/// the scores of the input symbols are stamped by the step, the older stamps are not compared with anything
+	_snap.write(m_pdAlpha, m_iStates * m_iSlots * sizeof(double));
+	_snap.write(m_pdEntry, m_iStates * m_iSlots * sizeof(double));
+	_snap.write(m_pdInput, m_iInputs * m_iSlots * sizeof(double));
+	_snap.write(m_pdLimit, m_iSlots * sizeof(double));
+	_snap.write(&iKept, sizeof(iKept));
+	if(iKept) _snap.write(&m_index[0], iKept * sizeof(int64_t));
+	if(m_iSymbols) _snap.write(&m_sum[0], (iKept + 1) * m_iSymbols * sizeof(double));
+}
+
+unsigned int CConfidence::restore(CSnapshot &_snap)
+{
+	unsigned int iKept;
+
+	if(_snap.check(m_iStates) == EAR_FAIL || _snap.check(m_iInputs) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.check(m_iSymbols) == EAR_FAIL || _snap.check(m_iSlots) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(&m_iSteps, sizeof(m_iSteps)) == EAR_FAIL || _snap.read(&m_iFirst, sizeof(m_iFirst)) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(&m_iBase, sizeof(m_iBase)) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(m_pdAlpha, m_iStates * m_iSlots * sizeof(double)) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(m_pdEntry, m_iStates * m_iSlots * sizeof(double)) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(m_pdInput, m_iInputs * m_iSlots * sizeof(double)) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(m_pdLimit, m_iSlots * sizeof(double)) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(&iKept, sizeof(iKept)) == EAR_FAIL) return EAR_FAIL;
+	m_index.resize(iKept); m_sum.resize((iKept + 1) * m_iSymbols);
+	if(iKept && _snap.read(&m_index[0], iKept * sizeof(int64_t)) == EAR_FAIL) return EAR_FAIL;
+	if(m_iSymbols && _snap.read(&m_sum[0], (iKept + 1) * m_iSymbols * sizeof(double)) == EAR_FAIL) return EAR_FAIL;
+	for(unsigned int i=0;i<m_iInputs;i++) m_piStamp[i] = NONE;
+	return EAR_SUCCESS;
+}
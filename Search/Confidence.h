@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+ /**
+ *	Confidence of the detected events from their posterior probabilities.
+ */
+
+#ifndef __EAR_CONFIDENCE_H_
+#define __EAR_CONFIDENCE_H_
+
+#include <vector>
+
+#include "../Data/Data.h"
+#include "Scorer.h"
+
+namespace Ear
+{
+	/**
+	*	Posterior probabilities of the output symbols computed alongside the Viterbi search. The forward pass sums the scores
+	* of all paths in the search network instead of taking the best one, the scores are scaled down first so the posteriors
+	* are not all zeros and ones. The states reached only by the paths much worse than the best one are pruned by the beam.
+	* Each state of the network belongs to the output symbol of the transitions entering it, the posterior of the symbol in a
+	* time is the part of the sum of the paths ending in its states.
+	*
+	* Without the window the posteriors are known right after the forward pass, from the past vectors only. With the window
+	* the backward pass runs over the last feature vectors each time the window is full, so the posteriors of the older half
+	* of it see the following vectors too. The vectors still in the window keep the posteriors of the forward pass.
+	*
+	* The confidence of the event is the mean posterior of its symbol over its feature vectors. The cumulative sums of the
+	* posteriors are kept for all processed vectors since the reset, until the events ending before them are released.
+	*/
+	class CConfidence
+	{
+	public:
+		CConfidence();
+		~CConfidence();
+
+	private:
+		unsigned int m_iStates; ///< number of the states of the network (without the end state)
+		unsigned int m_iSymbols; ///< number of the output symbols (the largest one plus one)
+		unsigned int m_iInputs; ///< number of the input symbols (the largest one plus one)
+		unsigned int *m_piSymbol; ///< output symbol of each state, NONE if it is reached by more symbols or none
+
+		unsigned int m_iFull; ///< number of the transitions consuming the feature vector
+		unsigned int *m_piFullFrom; ///< start state of each such transition
+		unsigned int *m_piFullTo; ///< end state of each such transition
+		unsigned int *m_piFullIn; ///< input symbol of each such transition
+		float *m_pfFullNet; ///< weight of each such transition, without the penalty
+		unsigned int *m_piFullChange; ///< output symbol the transition changes to (its penalty is added), EPS_SYM for none
+		double *m_pdFull; ///< probability of each such transition, the scaled weight including the penalty
+		unsigned int m_iEmpty; ///< number of the transitions with the empty input symbol
+		unsigned int *m_piEmptyFrom; ///< start state of each such transition, the transitions are in the topological order
+		unsigned int *m_piEmptyTo; ///< end state of each such transition
+		float *m_pfEmptyNet; ///< weight of each such transition, without the penalty
+		unsigned int *m_piEmptyChange; ///< output symbol the empty transition changes to, EPS_SYM for none
+		double *m_pdEmpty; ///< probability of each such transition
+
+		float m_fScale; ///< scale of all scores
+		double m_dBeam; ///< pruning beam of the forward pass, as the ratio of the probabilities
+		unsigned int m_iWindow; ///< number of the following vectors seen by the backward pass, 0 for the forward pass only
+		unsigned int m_iSlots; ///< number of the vectors kept for the backward pass, two windows (one without the window)
+
+		/// The forward pass keeps the probabilities of the paths relative to the best one, so they do not run out of the
+		/// precision, and only the states above the beam are followed. The scores of the input symbols are scaled to the
+		/// probabilities once for each vector, the transitions only multiply them.
+		double *m_pdAlpha; ///< probabilities of the states after the empty transitions, for each kept vector
+		double *m_pdEntry; ///< probabilities of the states entered by the vector, for each kept vector
+		double *m_pdInput; ///< probabilities of the input symbols, for each kept vector
+		double *m_pdLimit; ///< the lowest probability of the state followed after each kept vector
+		unsigned int *m_piStamp; ///< the last vector each input symbol was scored for
+		float *m_pfScore; ///< scaled score of each input symbol for the current vector
+		unsigned int *m_piNeeded; ///< input symbols scored for the current vector
+		double *m_pdBeta; ///< backward probabilities of the states
+		double *m_pdNext; ///< backward probabilities of the states in the following time
+		float *m_pfPost; ///< posteriors of the symbols in one time
+		unsigned int m_iSteps; ///< number of the processed feature vectors since the reset
+		unsigned int m_iFirst; ///< first vector waiting for the backward pass
+
+		unsigned int m_iBase; ///< number of the released vectors, not kept in the following arrays
+		std::vector<int64_t> m_index; ///< time index of each kept vector
+		std::vector<double> m_sum; ///< cumulative sums of the posteriors of the symbols, one row before each kept vector and one after all
+
+	public:
+		/// Initialize the forward pass on the search network
+		/// @param [in] _pNet search network, the end states of the transitions are the indexes of the transitions
+		/// @param [in] _iStates number of the states of the network without the end state
+		/// @param [in] _fScale scale of the scores
+		/// @param [in] _fBeam pruning beam, in the scaled scores
+		/// @param [in] _iWindow number of the following feature vectors for the backward pass, 0 for no backward pass
+		/// @param [in] _pfPenalty insertion penalties of the output symbols of the search, see <i>weigh</i>
+		/// @param [in] _iSkip frame skipping of the search, see <i>weigh</i>
+		/// @return success of the initialization, fails if the empty transitions form a loop
+		unsigned int initialize(EAR_FST_Net *_pNet, unsigned int _iStates, float _fScale, float _fBeam, unsigned int _iWindow, const float *_pfPenalty, unsigned int _iSkip);
+		/// Start again in the start state of the network and forget all posteriors
+		void reset();
+		/// Forward pass through one feature vector
+		/// @param [in] _pScorer scorer with the current feature vector set
+		/// @param [in] _iSkip number of the vectors the score stands for (frame skipping)
+		/// @param [in] _iIndex time index of the feature vector
+		void step(AScorer *_pScorer, unsigned int _iSkip, int64_t _iIndex);
+		/// Set the probabilities of the transitions, whenever the penalties or the frame skipping of the search change
+		/// @param [in] _pfPenalty insertion penalty of each output symbol, zero for EPS_SYM
+		/// @param [in] _iSkip number of the vectors the propagated one stands for, multiplies the weights consuming it
+		void weigh(const float *_pfPenalty, unsigned int _iSkip);
+		/// @param [in] _event the event of the search
+		/// @return mean posterior of the symbol of the event over its feature vectors, 1 if none of them was processed
+		float get(const CResult &_event);
+		/// Forget the posteriors of the feature vectors before the time, no event will be asked for them
+		/// @param [in] _iIndex time index of the first vector kept
+		void release(int64_t _iIndex);
+		/// Write the probabilities of the kept vectors and the sums of the posteriors to the snapshot
+		/// @param [in, out] _snap the snapshot
+		void save(CSnapshot &_snap);
+		/// Read the state written by <i>save</i> of the confidence with the same network and window
+		/// @param [in, out] _snap the snapshot
+		/// @return EAR_FAIL if the snapshot does not match
+		unsigned int restore(CSnapshot &_snap);
+
+	private:
+		/// Compute the posteriors of the symbols in one time from the probabilities of the states
+		/// @param [in] _pdEntry forward probabilities of the states entered by the vector
+		/// @param [in] _pdBeta backward probabilities of the same states, NULL for none
+		void posteriors(const double *_pdEntry, const double *_pdBeta);
+		/// Backward pass over the vectors waiting for it, the posteriors of the vectors before the last <i>m_iWindow</i>
+		/// ones are replaced
+		void backward();
+	};
+}
+
+#endif
@@ -0,0 +1,551 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include "DenseSearch.h"
+#include "../Data/Snapshot.h"
+
+/// the largest number of the compiled arcs for one transition of the network
+#define DENSE_ARCS_PER_TRANSITION 16
+/// number of the new records of the trace when the unused ones are removed
+#define DENSE_TRACE 1024
+
+using namespace Ear;
+
+CDenseSearch::CDenseSearch() : m_trace(DENSE_TRACE)
+{
+	m_pNet = NULL;
+	m_iStates = 0; m_iEndState = 0;
+	m_iArcs = 0; m_iSteps = 0; m_iReset = 0;
+	m_piDst = NULL; m_piSrc = NULL; m_piObs = NULL; m_pfWeight = NULL; m_iSkip = 1;
+	m_piPath = NULL; m_piSteps = NULL; m_pbLabel = NULL; m_piPos = NULL;
+	m_iObs = 0; m_piObsSrc = NULL; m_piObsIn = NULL; m_pfObs = NULL;
+	for(unsigned int i=0;i<2;i++) { m_pfA[i] = NULL; m_pfX[i] = NULL; m_piB[i] = NULL; m_piS[i] = NULL; m_pbSelf[i] = NULL; m_piAlt[i] = NULL; }
+	m_iCur = 0;
+	m_pfCandA = NULL; m_pfCandX = NULL; m_pfCand = NULL;
+	m_pfBest = NULL; m_piWin = NULL;
+	m_iAlts = 0; m_fBeam = 0; m_piMerge = NULL;
+	m_iTime = 0; m_dOffset = 0;
+}
+
+CDenseSearch::~CDenseSearch()
+{
+	release();
+}
+
+void CDenseSearch::release()
+{
+	if(m_piDst) delete[] m_piDst;
+	if(m_piSrc) delete[] m_piSrc;
+	if(m_piObs) delete[] m_piObs;
+	if(m_pfWeight) delete[] m_pfWeight;
+	if(m_piPath) delete[] m_piPath;
+	if(m_piSteps) delete[] m_piSteps;
+	if(m_pbLabel) delete[] m_pbLabel;
+	if(m_piPos) delete[] m_piPos;
+	if(m_piObsSrc) delete[] m_piObsSrc;
+	if(m_piObsIn) delete[] m_piObsIn;
+	if(m_pfObs) delete[] m_pfObs;
+	for(unsigned int i=0;i<2;i++)
+	{
+		if(m_pfA[i]) delete[] m_pfA[i];
+		if(m_pfX[i]) delete[] m_pfX[i];
+		if(m_piB[i]) delete[] m_piB[i];
+		if(m_piS[i]) delete[] m_piS[i];
+		if(m_pbSelf[i]) delete[] m_pbSelf[i];
+		if(m_piAlt[i]) delete[] m_piAlt[i];
+		m_pfA[i] = NULL; m_pfX[i] = NULL; m_piB[i] = NULL; m_piS[i] = NULL; m_pbSelf[i] = NULL; m_piAlt[i] = NULL;
+	}
+	if(m_pfCandA) delete[] m_pfCandA;
+	if(m_pfCandX) delete[] m_pfCandX;
+	if(m_pfCand) delete[] m_pfCand;
+	if(m_pfBest) delete[] m_pfBest;
+	if(m_piWin) delete[] m_piWin;
+	if(m_piMerge) delete[] m_piMerge;
+
+	m_piDst = NULL; m_piSrc = NULL; m_piObs = NULL; m_pfWeight = NULL;
+	m_piPath = NULL; m_piSteps = NULL; m_pbLabel = NULL; m_piPos = NULL;
+	m_piObsSrc = NULL; m_piObsIn = NULL; m_pfObs = NULL;
+	m_pfCandA = NULL; m_pfCandX = NULL; m_pfCand = NULL;
+	m_pfBest = NULL; m_piWin = NULL; m_piMerge = NULL;
+	m_iArcs = 0; m_iReset = 0; m_iSteps = 0; m_iObs = 0;
+	m_trace.clear();
+}
+
+unsigned int CDenseSearch::expand(std::vector< std::vector<unsigned int> > &_arcs, std::vector<unsigned int> &_path, unsigned int _iPos, bool _bEmit)
+{
+	unsigned int t, iStart;
+
+	/// the paths longer than the number of the states are cycles of the empty transitions
+	if(_arcs.size() > DENSE_ARCS_PER_TRANSITION * m_pNet->iSize || _path.size() > m_iStates) return EAR_FAIL;
+
+	/// the same transitions as in CSearch::propagateEmpty
+	if(_iPos != END_STATE)
+	{
+		iStart = m_pNet->pNet[_iPos].iStart;
+		for(t=_iPos;t<m_pNet->iSize && m_pNet->pNet[t].iStart == iStart;t++)
+		{
+			if(m_pNet->pNet[t].iEnd == UNDEF_STATE || m_pNet->pNet[t].iIn != EPS_SYM) continue;
+
+			_path.push_back(t);
+			if(expand(_arcs, _path, m_pNet->pNet[t].iEnd, true) == EAR_FAIL) return EAR_FAIL;
+			_path.pop_back();
+		}
+	}
+
+	/// the path itself is inserted after all its continuations
+	if(_bEmit)
+	{
+		_arcs.push_back(_path);
+		_arcs.back().push_back(state(_iPos));
+	}
+
+	return EAR_SUCCESS;
+}
+
+unsigned int CDenseSearch::initialize(EAR_FST_Net *_pNet, unsigned int _iStates, unsigned int _iEndState)
+{
+	std::vector< std::vector<unsigned int> > arcs, reset;
+	std::vector<unsigned int> path, src, obs, order;
+	unsigned int i, j, k, s, t, n;
+
+	release();
+	m_pNet = _pNet; m_iStates = _iStates; m_iEndState = _iEndState;
+
+	/// the start token is at the first transition
+	if(!m_pNet->iSize || m_pNet->pNet[0].iStart != START_STATE) return EAR_FAIL;
+
+	m_piPos = new unsigned int[m_iStates];
+	for(s=0;s<m_iStates;s++) m_piPos[s] = NONE;
+	for(t=m_pNet->iSize;t>0;t--) if(m_pNet->pNet[t - 1].iStart < m_iStates) m_piPos[m_pNet->pNet[t - 1].iStart] = t - 1;
+
+	/// the arcs of each transition consuming the vector in the order of CSearch::step, the states go one by one
+	/// and their transitions in the order of the network
+	for(s=0;s<m_iStates;s++)
+	{
+		if(s == m_iEndState || m_piPos[s] == NONE) continue;
+
+		for(t=m_piPos[s];t<m_pNet->iSize && m_pNet->pNet[t].iStart == s;t++)
+		{
+			if(m_pNet->pNet[t].iEnd == UNDEF_STATE || m_pNet->pNet[t].iIn == EPS_SYM) continue;
+
+			n = arcs.size();
+			path.assign(1, t);
+			if(expand(arcs, path, m_pNet->pNet[t].iEnd, true) == EAR_FAIL) return EAR_FAIL;
+			for(;n<arcs.size();n++) { src.push_back(s); obs.push_back(m_iObs); }
+
+			m_iObs++;
+		}
+	}
+	m_iArcs = arcs.size();
+
+	/// the empty transitions from the start token after the reset
+	path.clear();
+	if(expand(reset, path, START_STATE, false) == EAR_FAIL) return EAR_FAIL;
+	m_iReset = reset.size();
+	for(i=0;i<m_iReset;i++) { arcs.push_back(reset[i]); src.push_back(START_STATE); obs.push_back(m_iObs); }
+
+	/// the arcs are grouped by the destination state, the order stays the same in the group
+	for(i=0;i<arcs.size();i++) order.push_back(i);
+	std::stable_sort(order.begin(), order.begin() + m_iArcs, [&](unsigned int a, unsigned int b){ return arcs[a].back() < arcs[b].back(); });
+	std::stable_sort(order.begin() + m_iArcs, order.end(), [&](unsigned int a, unsigned int b){ return arcs[a].back() < arcs[b].back(); });
+
+	for(i=0, m_iSteps=0, n=0;i<arcs.size();i++)
+	{
+		if(arcs[i].size() - 1 > m_iSteps) m_iSteps = arcs[i].size() - 1;
+		n += arcs[i].size() - 1;
+	}
+
+	/// the tables of the arcs
+	k = arcs.size();
+	m_piDst = new unsigned int[k]; m_piSrc = new unsigned int[k]; m_piObs = new unsigned int[k];
+	m_pfWeight = new float[k * m_iSteps + 1];
+	m_piPath = new unsigned int[k + 1]; m_piSteps = new unsigned int[n + 1];
+	m_pbLabel = new bool[k];
+	memset(m_pfWeight, 0, sizeof(float) * (k * m_iSteps + 1));
+
+	for(i=0, n=0;i<k;i++)
+	{
+		std::vector<unsigned int> &arc = arcs[order[i]];
+
+		m_piDst[i] = arc.back(); m_piSrc[i] = src[order[i]]; m_piObs[i] = obs[order[i]];
+		m_piPath[i] = n; m_pbLabel[i] = false;
+		for(j=0;j+1<arc.size();j++)
+		{
+			m_piSteps[n++] = arc[j];
+			m_pfWeight[j * k + i] = weight(i, n - 1);
+			if(m_pNet->pNet[arc[j]].iOut) m_pbLabel[i] = true;
+		}
+	}
+	m_piPath[k] = n;
+
+	/// the transitions consuming the vector, the last score is zero for the arcs after the reset
+	m_piObsSrc = new unsigned int[m_iObs + 1]; m_piObsIn = new unsigned int[m_iObs + 1];
+	m_pfObs = new float[m_iObs + 1];
+	for(i=0;i<k;i++) if(m_piObs[i] < m_iObs) { m_piObsSrc[m_piObs[i]] = m_piSrc[i]; m_piObsIn[m_piObs[i]] = m_pNet->pNet[m_piSteps[m_piPath[i]]].iIn; }
+	m_pfObs[m_iObs] = 0.0;
+
+	/// the arrays of the states and the candidates
+	for(i=0;i<2;i++)
+	{
+		m_pfA[i] = new float[m_iStates]; m_pfX[i] = new float[m_iStates];
+		m_piB[i] = new unsigned int[m_iStates]; m_piS[i] = new unsigned int[m_iStates];
+		m_pbSelf[i] = new bool[m_iStates]; m_piAlt[i] = new unsigned int[m_iStates];
+		for(s=0;s<m_iStates;s++) { m_pfA[i][s] = -INFINITY; m_pfX[i][s] = 0.0; m_piB[i][s] = NONE; m_piS[i][s] = EPS_SYM; m_pbSelf[i][s] = false; m_piAlt[i][s] = NONE; }
+	}
+	m_pfCandA = new float[k]; m_pfCandX = new float[k]; m_pfCand = new float[k];
+	m_pfBest = new float[m_iStates]; m_piWin = new unsigned int[m_iStates];
+	m_piMerge = new unsigned int[m_iStates];
+	for(s=0;s<m_iStates;s++) m_piMerge[s] = NONE;
+
+	return EAR_SUCCESS;
+}
+
+void CDenseSearch::reset(const float *_pfPenalty)
+{
+	unsigned int s, c = m_iCur;
+
+	/// only the start token, the same as in CSearch::reset
+	for(s=0;s<m_iStates;s++) m_pfA[c][s] = -INFINITY;
+	m_pfA[c][START_STATE] = 0.0; m_pfX[c][START_STATE] = 0.0;
+	m_piB[c][START_STATE] = NONE; m_piS[c][START_STATE] = EPS_SYM; m_pbSelf[c][START_STATE] = false; m_piAlt[c][START_STATE] = NONE;
+
+	m_trace.clear();
+	m_iTime = 0;
+	m_dOffset = 0;
+
+	relax(m_iArcs, m_iArcs + m_iReset, c, _pfPenalty);
+}
+
+unsigned int CDenseSearch::collect(unsigned int *_piNeeded)
+{
+	unsigned int t, n = 0;
+	const float *A = m_pfA[m_iCur];
+
+	for(t=0;t<m_iObs;t++) if(A[m_piObsSrc[t]] != -INFINITY) _piNeeded[n++] = m_piObsIn[t];
+	return n;
+}
+
+void CDenseSearch::setFrameSkip(unsigned int _iSkip)
+{
+	unsigned int i;
+
+	/// only the first steps of the arcs consuming the vector, the arcs after the reset start by the empty transition
+	m_iSkip = _iSkip;
+	for(i=0;i<m_iArcs;i++) m_pfWeight[i] = weight(i, m_piPath[i]);
+}
+
+void CDenseSearch::step(AScorer *_pScorer, const float *_pfPenalty, int64_t _iIndex)
+{
+	unsigned int t, s, p = m_iCur;
+	const float *A = m_pfA[p];
+
+	/// the scores of the transitions from the states with the hypothesis, the others are not used
+	for(t=0;t<m_iObs;t++)
+	{
+		if(A[m_piObsSrc[t]] == -INFINITY) { m_pfObs[t] = 0.0; continue; }
+		if(m_iSkip > 1) m_pfObs[t] = m_iSkip * _pScorer->getScore(m_piObsIn[t]);
+		else m_pfObs[t] = _pScorer->getScore(m_piObsIn[t]);
+	}
+
+	/// switch the arrays, the current states are empty
+	m_iCur = 1 - m_iCur;
+	for(s=0;s<m_iStates;s++) m_pfA[m_iCur][s] = -INFINITY;
+	m_iTime = _iIndex;
+
+	relax(0, m_iArcs, p, _pfPenalty);
+
+	if(m_trace.isFull()) collectTrace();
+}
+
+void CDenseSearch::relax(unsigned int _iFirst, unsigned int _iEnd, unsigned int _iSrc, const float *_pfPenalty)
+{
+	unsigned int i, j, d, iSym, iPrev, iAlt;
+	const unsigned int iStride = m_iArcs + m_iReset;
+	const unsigned int c = m_iCur;
+	const float *A = m_pfA[_iSrc], *X = m_pfX[_iSrc];
+	float *candA = m_pfCandA, *candX = m_pfCandX, *cand = m_pfCand;
+	float x;
+	bool self;
+	EAR_FST_Trn *trn;
+
+	/// the scores of all arcs, the acoustic score is added once and the weights of the steps one by one in the same order
+	/// as the tokens add them, the padding steps add zero
+	#pragma omp simd
+	for(i=_iFirst;i<_iEnd;i++) { candA[i] = A[m_piSrc[i]] + m_pfObs[m_piObs[i]]; candX[i] = X[m_piSrc[i]]; }
+	for(j=0;j<m_iSteps;j++)
+	{
+		const float *w = m_pfWeight + j * iStride;
+		#pragma omp simd
+		for(i=_iFirst;i<_iEnd;i++) candX[i] += w[i];
+	}
+
+	/// the output symbols change the weights by the insertion penalty depending on the symbol of the source
+	for(i=_iFirst;i<_iEnd;i++)
+	{
+		if(!m_pbLabel[i]) continue;
+
+		iSym = m_piS[_iSrc][m_piSrc[i]]; x = X[m_piSrc[i]];
+		for(j=m_piPath[i];j<m_piPath[i + 1];j++)
+		{
+			trn = &m_pNet->pNet[m_piSteps[j]];
+			if(trn->iOut && trn->iOut != iSym) { x += weight(i, j) + _pfPenalty[trn->iOut]; iSym = trn->iOut; }
+			else x += weight(i, j);
+		}
+		candX[i] = x;
+	}
+
+	#pragma omp simd
+	for(i=_iFirst;i<_iEnd;i++) cand[i] = candA[i] + candX[i];
+
+	/// the arcs are inserted in the order of CSearch, the later one replaces the better one with the same score
+	for(d=0;d<m_iStates;d++) { m_pfBest[d] = m_pfA[c][d] == -INFINITY ? -INFINITY : m_pfA[c][d] + m_pfX[c][d]; m_piWin[d] = NONE; }
+	for(i=_iFirst;i<_iEnd;i++)
+	{
+		d = m_piDst[i];
+		if(cand[i] >= m_pfBest[d]) { m_pfBest[d] = cand[i]; m_piWin[d] = i; }
+	}
+
+	/// the hypotheses of the best arcs, the changes of the symbols on their paths are added to the trace
+	for(d=0;d<m_iStates;d++)
+	{
+		if((i = m_piWin[d]) == NONE || cand[i] == -INFINITY) continue;
+
+		iPrev = follow(i, _iSrc, _pfPenalty, iSym, iAlt, self);
+		m_pfA[c][d] = candA[i]; m_pfX[c][d] = candX[i];
+		m_piB[c][d] = iPrev; m_piS[c][d] = iSym; m_pbSelf[c][d] = self; m_piAlt[c][d] = iAlt;
+	}
+
+	if(m_iAlts) link(_iFirst, _iEnd, _iSrc, _pfPenalty);
+}
+
+unsigned int CDenseSearch::follow(unsigned int _iArc, unsigned int _iSrc, const float *_pfPenalty, unsigned int &_iSym, unsigned int &_iAlt, bool &_bSelf)
+{
+	unsigned int j, k = m_piSrc[_iArc], iPrev = m_piB[_iSrc][k];
+	float x = m_pfX[_iSrc][k];
+	EAR_FST_Trn *trn;
+
+	_iSym = m_piS[_iSrc][k]; _iAlt = m_piAlt[_iSrc][k]; _bSelf = false;
+	if(!m_pbLabel[_iArc]) return iPrev;
+
+	/// the new record has the alternatives of the previous one, the same as the token
+	for(j=m_piPath[_iArc];j<m_piPath[_iArc + 1];j++)
+	{
+		trn = &m_pNet->pNet[m_piSteps[j]];
+		_bSelf = trn->iOut && trn->iOut != _iSym;
+		if(_bSelf)
+		{
+			x += weight(_iArc, j) + _pfPenalty[trn->iOut]; _iSym = trn->iOut;
+			iPrev = m_trace.add(_iSym, iPrev, m_iTime, m_pfCandA[_iArc] + x + m_dOffset, _iAlt); _iAlt = NONE;
+		}
+		else x += weight(_iArc, j);
+	}
+
+	return iPrev;
+}
+
+unsigned int CDenseSearch::lastSymbol(unsigned int _iArc, unsigned int _iSrc)
+{
+	unsigned int j, iSym = m_piS[_iSrc][m_piSrc[_iArc]], iPrev = iSym;
+	bool self = false;
+	EAR_FST_Trn *trn;
+
+	/// the symbols of the changes made by the arc, without the records of follow
+	if(!m_pbLabel[_iArc]) return iSym;
+	for(j=m_piPath[_iArc];j<m_piPath[_iArc + 1];j++)
+	{
+		trn = &m_pNet->pNet[m_piSteps[j]];
+		self = trn->iOut && trn->iOut != iSym;
+		if(self) { iPrev = iSym; iSym = trn->iOut; }
+	}
+
+	/// the hypothesis in the end state holding the symbol itself has the previous one as the last event
+	return m_piDst[_iArc] == m_iEndState && self ? iPrev : iSym;
+}
+
+void CDenseSearch::link(unsigned int _iFirst, unsigned int _iEnd, unsigned int _iSrc, const float *_pfPenalty)
+{
+	unsigned int i, j, d, iSym, iAlt, iRec;
+	const unsigned int c = m_iCur;
+	const float *cand = m_pfCand;
+	bool self;
+
+	/// the insertion of CSearch once more, the arc is dropped when it loses or when the later one replaces it
+	for(d=0;d<m_iStates;d++) m_piWin[d] = NONE;
+	for(i=_iFirst;i<_iEnd;i++)
+	{
+		if(cand[i] == -INFINITY) continue;
+		d = m_piDst[i]; j = m_piWin[d];
+		if(j == NONE) { m_piWin[d] = i; continue; }
+		if(cand[i] >= cand[j]) m_piWin[d] = i;
+		else j = i;
+
+		/// only the arcs in the beam of the best one, the others are left out by the selection anyway, the same as the arcs
+		/// with the same last event as the staying one (see <i>CSearch::drop</i>)
+		if(cand[j] < m_pfBest[d] - m_fBeam || lastSymbol(j, _iSrc) == lastSymbol(m_piWin[d], _iSrc)) continue;
+		iRec = follow(j, _iSrc, _pfPenalty, iSym, iAlt, self);
+		if(d == m_iEndState && self) iRec = m_trace.get(iRec).iPrev;
+		m_piMerge[d] = m_trace.add(iRec == NONE ? EPS_SYM : m_trace.get(iRec).iSym, iRec, m_iTime, cand[j] + m_dOffset, m_piMerge[d]);
+	}
+
+	/// the alternatives are chosen the same way as in CSearch, the hypothesis in the end state holding the symbol itself is not an event
+	for(d=0;d<m_iStates;d++)
+	{
+		if(m_piMerge[d] == NONE) continue;
+
+		iRec = m_piB[c][d];
+		if(d == m_iEndState && m_pbSelf[c][d]) iRec = m_trace.get(iRec).iPrev;
+		m_piAlt[c][d] = m_trace.select(m_piMerge[d], m_pfBest[d] + m_dOffset, iRec == NONE ? EPS_SYM : m_trace.get(iRec).iSym, m_fBeam, m_iAlts, m_piAlt[c][d]);
+		m_piMerge[d] = NONE;
+	}
+}
+
+void CDenseSearch::renormalize()
+{
+	unsigned int s;
+	const unsigned int c = m_iCur;
+	float fBest = -INFINITY;
+
+	/// the same as CSearch::renormalize, the transition part is joined into the acoustic one
+	for(s=0;s<m_iStates;s++) if(m_pfA[c][s] != -INFINITY && m_pfA[c][s] + m_pfX[c][s] > fBest) fBest = m_pfA[c][s] + m_pfX[c][s];
+	if(fBest == -INFINITY) return;
+
+	for(s=0;s<m_iStates;s++) if(m_pfA[c][s] != -INFINITY) { m_pfA[c][s] = m_pfA[c][s] + m_pfX[c][s] - fBest; m_pfX[c][s] = 0.0; }
+	m_dOffset += fBest;
+}
+
+double CDenseSearch::getBestScore()
+{
+	unsigned int s;
+	const unsigned int c = m_iCur;
+	float fBest = -INFINITY;
+
+	for(s=0;s<m_iStates;s++) if(m_pfA[c][s] != -INFINITY && m_pfA[c][s] + m_pfX[c][s] > fBest) fBest = m_pfA[c][s] + m_pfX[c][s];
+	return fBest == -INFINITY ? -INFINITY : fBest + m_dOffset;
+}
+
+void CDenseSearch::save(CSnapshot &_snap)
+{
+	const unsigned int c = m_iCur;
+
+	/// only the current time, the other arrays are cleared by the next step
+	_snap.write(&m_iStates, sizeof(m_iStates));
+	_snap.write(m_pfA[c], m_iStates * sizeof(float)); _snap.write(m_pfX[c], m_iStates * sizeof(float));
+	_snap.write(m_piB[c], m_iStates * sizeof(unsigned int)); _snap.write(m_piS[c], m_iStates * sizeof(unsigned int));
+	_snap.write(m_pbSelf[c], m_iStates * sizeof(bool)); _snap.write(m_piAlt[c], m_iStates * sizeof(unsigned int));
+	_snap.write(&m_iTime, sizeof(m_iTime)); _snap.write(&m_dOffset, sizeof(m_dOffset));
+	m_trace.save(_snap);
+}
+
+unsigned int CDenseSearch::restore(CSnapshot &_snap)
+{
+	const unsigned int c = m_iCur;
+
+	if(_snap.check(m_iStates) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(m_pfA[c], m_iStates * sizeof(float)) == EAR_FAIL || _snap.read(m_pfX[c], m_iStates * sizeof(float)) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(m_piB[c], m_iStates * sizeof(unsigned int)) == EAR_FAIL || _snap.read(m_piS[c], m_iStates * sizeof(unsigned int)) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(m_pbSelf[c], m_iStates * sizeof(bool)) == EAR_FAIL || _snap.read(m_piAlt[c], m_iStates * sizeof(unsigned int)) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(&m_iTime, sizeof(m_iTime)) == EAR_FAIL || _snap.read(&m_dOffset, sizeof(m_dOffset)) == EAR_FAIL) return EAR_FAIL;
+	return m_trace.restore(_snap);
+}
+
+void CDenseSearch::collectTrace()
+{
+	unsigned int s;
+	const unsigned int c = m_iCur;
+
+	/// mark the records reachable from the states, the other ones are removed
+	m_trace.startCollect();
+	for(s=0;s<m_iStates;s++) if(m_pfA[c][s] != -INFINITY) { m_trace.mark(m_piB[c][s]); m_trace.mark(m_piAlt[c][s]); }
+	m_trace.compact();
+
+	for(s=0;s<m_iStates;s++) if(m_pfA[c][s] != -INFINITY) { m_piB[c][s] = m_trace.moved(m_piB[c][s]); m_piAlt[c][s] = m_trace.moved(m_piAlt[c][s]); }
+}
+
+void CDenseSearch::commit(CTraceArena::Event _pEvent, void *_pArg)
+{
+	unsigned int s, b = NONE;
+	bool first = true;
+	const unsigned int c = m_iCur;
+
+	/// the same as CSearch::commit
+	for(s=0;s<m_iStates;s++)
+	{
+		if(m_pfA[c][s] == -INFINITY) continue;
+		b = first ? m_piB[c][s] : m_trace.common(b, m_piB[c][s]);
+		first = false;
+		if(b == NONE) return;
+	}
+	if(b == NONE) return;
+	if(m_pfA[c][m_iEndState] != -INFINITY && m_pbSelf[c][m_iEndState] && m_piB[c][m_iEndState] == b) return;
+
+	m_trace.commit(b, _pEvent, _pArg);
+}
+
+bool CDenseSearch::getResults(CResults &_results, int64_t _iEndIndex)
+{
+	CResult newResult;
+	unsigned int b;
+	double dScore;
+	const unsigned int c = m_iCur;
+
+	_results.clear();
+
+	/// the same as CSearch::getResults, the token in the end state holding a symbol itself is not an event
+	if(m_pfA[c][m_iEndState] == -INFINITY) return false;
+	b = m_piB[c][m_iEndState];
+	if(b != NONE && m_pbSelf[c][m_iEndState]) b = m_trace.get(b).iPrev;
+	dScore = m_pfA[c][m_iEndState] + m_pfX[c][m_iEndState] + m_dOffset;
+
+	while(b != NONE)
+	{
+		const CTraceRecord &rec = m_trace.get(b);
+		newResult.iRevIndex = rec.iIndex;
+		newResult.iDur      = _iEndIndex - rec.iIndex;
+		newResult.iId       = rec.iSym;
+		newResult.fScore    = dScore - rec.dScore;
+		_results.push_front(newResult);
+
+		_iEndIndex = rec.iIndex;
+		dScore = rec.dScore;
+		b = rec.iPrev;
+	}
+
+	return true;
+}
+
+bool CDenseSearch::getNBest(CNBest &_nbest, unsigned int _iN, int64_t _iEndIndex)
+{
+	unsigned int b, iMore = NONE;
+	const unsigned int c = m_iCur;
+
+	_nbest.clear();
+
+	/// the same as CSearch::getNBest
+	if(m_pfA[c][m_iEndState] == -INFINITY) return false;
+	b = m_piB[c][m_iEndState];
+	if(b != NONE && m_pbSelf[c][m_iEndState]) { iMore = m_trace.get(b).iAlt; b = m_trace.get(b).iPrev; }
+	m_trace.nbest(b, m_piAlt[c][m_iEndState], iMore, _iEndIndex, m_pfA[c][m_iEndState] + m_pfX[c][m_iEndState] + m_dOffset, _iN, _nbest);
+
+	return true;
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+ /**
+ *	Dense Viterbi decoding for small search networks.
+ */
+
+#ifndef __EAR_DENSESEARCH_H_
+#define __EAR_DENSESEARCH_H_
+
+#include <vector>
+
+#include "../Data/Data.h"
+#include "Token.h"
+#include "Scorer.h"
+
+namespace Ear
+{
+	/**
+	*	Viterbi decoding of a small search network without the tokens. The scores of the hypotheses in all states are kept in
+	* flat arrays and each feature vector is one pass of max-plus over the table of the arcs compiled from the network. An arc
+	* is a transition consuming the feature vector followed by a path of the transitions with empty input symbol, so it covers
+	* the recursion of the empty transitions of <i>CSearch</i>. The arcs are evaluated in the same order as the tokens are
+	* inserted by <i>CSearch</i> and with the same summation of the scores, so the results are identical.
+	*
+	* Only the changes of the output symbol are remembered for the results, each as a record in the trace pointing to the
+	* previous change. The records not reachable from any state are removed when the trace grows.
+	*/
+	class CDenseSearch
+	{
+	public:
+		CDenseSearch();
+		~CDenseSearch();
+
+	private:
+		EAR_FST_Net *m_pNet; ///< search network
+		unsigned int m_iStates; ///< number of the states including the end state
+		unsigned int m_iEndState; ///< number of the end state
+
+		/// compiled arcs, grouped by the destination state and in the order of the insertion of <i>CSearch</i> in each group
+		unsigned int m_iArcs; ///< number of the arcs
+		unsigned int m_iSteps; ///< length of the longest path of the arcs
+		unsigned int *m_piDst; ///< destination state of each arc
+		unsigned int *m_piSrc; ///< source state of each arc
+		unsigned int *m_piObs; ///< transition consuming the feature vector of each arc (index to <i>m_pfObs</i>)
+		float *m_pfWeight; ///< negative weight of each step of the paths, a row of all arcs for each step, padded by zeroes
+		unsigned int m_iSkip; ///< frame skipping, the weight of the first step of the arcs consuming the vector is multiplied by it
+		unsigned int *m_piPath; ///< first step of each arc in <i>m_piSteps</i>, one more for the end
+		unsigned int *m_piSteps; ///< transitions of the paths of all arcs
+		bool *m_pbLabel; ///< true if the path of the arc has any output symbol
+		unsigned int m_iReset; ///< number of the arcs of the empty transitions from the start state, stored after the others
+		unsigned int *m_piPos; ///< position of each state in the network (its first transition), NONE if it has no transitions
+
+		/// transitions consuming the feature vector
+		unsigned int m_iObs; ///< number of the transitions
+		unsigned int *m_piObsSrc; ///< source state of each transition
+		unsigned int *m_piObsIn; ///< input symbol of each transition
+		float *m_pfObs; ///< acoustic score of each transition for the current vector
+
+		/// the hypotheses of the states, the previous and current time
+		float *m_pfA[2]; ///< acoustic part of the score, -INFINITY for the states without hypothesis
+		float *m_pfX[2]; ///< transition part of the score (weights and penalties)
+		unsigned int *m_piB[2]; ///< last change of the output symbol on the path, NONE if there was no change
+		unsigned int *m_piS[2]; ///< current output symbol
+		bool *m_pbSelf[2]; ///< the last change was made by the last transition (the token would hold the symbol itself)
+		unsigned int *m_piAlt[2]; ///< alternatives met since the last change (see <i>CSearch::changeLattice</i>), NONE for none
+		unsigned int m_iCur; ///< which of the two arrays is the current time
+
+		float *m_pfCandA; ///< acoustic score of each arc for the current vector
+		float *m_pfCandX; ///< transition score of each arc for the current vector
+		float *m_pfCand; ///< total score of each arc for the current vector
+		float *m_pfBest; ///< best score inserted into each state
+		unsigned int *m_piWin; ///< arc of the best score of each state, NONE if no arc was inserted
+		unsigned int m_iAlts; ///< the largest number of the alternatives in one state, 0 without the lattice
+		float m_fBeam; ///< the largest difference of the score of the alternative
+		unsigned int *m_piMerge; ///< the arcs dropped in each state, waiting for the selection of the alternatives
+
+		CTraceArena m_trace; ///< changes of the output symbols, the same records as of the tokens in <i>CSearch</i>
+		int64_t m_iTime; ///< time index of the hypotheses, zero after the reset
+		double m_dOffset; ///< sum of the scores subtracted by the renormalization, the same as in <i>CSearch</i>
+
+	public:
+		/// Compile the search network into the table of the arcs
+		/// @param [in] _pNet search network
+		/// @param [in] _iStates number of the states including the end state (see <i>CSearch</i>)
+		/// @param [in] _iEndState number of the end state
+		/// @return EAR_FAIL if the network can not be compiled (the paths of the empty transitions are too many or cyclic)
+		unsigned int initialize(EAR_FST_Net *_pNet, unsigned int _iStates, unsigned int _iEndState);
+		/// Start the new hypothesis in the start state and propagate it through the empty transitions
+		/// @param [in] _pfPenalty insertion penalties of the output symbols
+		void reset(const float *_pfPenalty);
+		/// Collect the input symbols needed for the next vector
+		/// @param [out] _piNeeded array of the input symbols, needs to have a place for each transition of the network
+		/// @return number of the input symbols
+		unsigned int collect(unsigned int *_piNeeded);
+		/// Propagate the hypotheses by the feature vector already set to the scorer
+		/// @param [in] _pScorer scorer of the vector
+		/// @param [in] _pfPenalty insertion penalties of the output symbols
+		/// @param [in] _iIndex time index of the vector
+		void step(AScorer *_pScorer, const float *_pfPenalty, int64_t _iIndex);
+		/// Set the frame skipping, the same as in <i>CSearch::changeFrameSkip</i>. The acoustic scores and the weights of the
+		/// transitions consuming the vector are multiplied by the number of the vectors the propagated one stands for.
+		/// @param [in] _iSkip number of the vectors, 1 without the skipping
+		void setFrameSkip(unsigned int _iSkip);
+		/// Get the acoustic events of the hypothesis in the end state
+		/// @param [out] _results list of the events
+		/// @param [in] _iEndIndex time index of the end of the last event
+		/// @return false if there is no hypothesis in the end state
+		bool getResults(CResults &_results, int64_t _iEndIndex);
+		/// Commit the events on the path shared by the hypotheses of all states (see <i>CTraceArena::commit</i>)
+		/// @param [in] _pEvent function receiving the final events
+		/// @param [in] _pArg argument of the function
+		void commit(CTraceArena::Event _pEvent, void *_pArg);
+		/// Set the lattice, the same as in <i>CSearch::changeLattice</i>
+		/// @param [in] _iAlts the largest number of the alternatives in one state, 0 for no lattice
+		/// @param [in] _fBeam the largest difference of the score of the alternative
+		void setLattice(unsigned int _iAlts, float _fBeam) {m_iAlts = _iAlts; m_fBeam = _fBeam;};
+		/// Get the best hypotheses of the lattice in the end state (see <i>CSearch::getNBest</i>)
+		/// @param [out] _nbest list of the hypotheses
+		/// @param [in] _iN the largest number of the hypotheses
+		/// @param [in] _iEndIndex time index of the end of the last event
+		/// @return false if there is no hypothesis in the end state
+		bool getNBest(CNBest &_nbest, unsigned int _iN, int64_t _iEndIndex);
+		/// Subtract the best score from the current hypotheses, the same as <i>CSearch::renormalize</i>
+		void renormalize();
+		/// @return the best score of the current hypotheses with the offset, -INFINITY for none
+		double getBestScore();
+		/// Add the score to all current hypotheses through the offset (see <i>CSearch::fastForward</i>)
+		/// @param [in] _dScore the added score
+		void addOffset(double _dScore){ m_dOffset += _dScore; }
+		/// @return number of the records in the traceback
+		unsigned int getTraceSize() {return m_trace.size();};
+		/// Write the current hypotheses and their records to the snapshot (see <i>CSearch::save</i>)
+		/// @param [in, out] _snap the snapshot
+		void save(CSnapshot &_snap);
+		/// Read the hypotheses written by <i>save</i>
+		/// @param [in, out] _snap the snapshot
+		/// @return EAR_FAIL if the snapshot was written for different network
+		unsigned int restore(CSnapshot &_snap);
+
+	private:
+		/// Append the arcs of all paths of the empty transitions from the position, the longer paths first as they are
+		/// inserted first by the recursion of <i>CSearch::propagateEmpty</i>
+		/// @param [in, out] _arcs steps of the arcs, the destination state is the last value of each arc
+		/// @param [in] _path steps of the current path
+		/// @param [in] _iPos position in the network where the path ends
+		/// @param [in] _bEmit append the current path itself
+		/// @return EAR_FAIL if there are too many arcs
+		unsigned int expand(std::vector< std::vector<unsigned int> > &_arcs, std::vector<unsigned int> &_path, unsigned int _iPos, bool _bEmit);
+		/// Compute the candidate scores and insert the best of them into the current states
+		/// @param [in] _iFirst first arc
+		/// @param [in] _iEnd end of the arcs
+		/// @param [in] _iSrc which of the two arrays holds the sources (can be the current ones)
+		/// @param [in] _pfPenalty insertion penalties of the output symbols
+		void relax(unsigned int _iFirst, unsigned int _iEnd, unsigned int _iSrc, const float *_pfPenalty);
+		/// Keep the arcs not inserted into the states as the alternatives of the inserted ones, in the same order as the
+		/// tokens dropped by <i>CSearch</i>
+		/// @param [in] _iFirst first arc
+		/// @param [in] _iEnd end of the arcs
+		/// @param [in] _iSrc which of the two arrays holds the sources
+		/// @param [in] _pfPenalty insertion penalties of the output symbols
+		void link(unsigned int _iFirst, unsigned int _iEnd, unsigned int _iSrc, const float *_pfPenalty);
+		/// Follow the path of the arc and add the records of the changes of the output symbol
+		/// @param [in] _iArc the arc
+		/// @param [in] _iSrc which of the two arrays holds the sources
+		/// @param [in] _pfPenalty insertion penalties of the output symbols
+		/// @param [out] _iSym current output symbol at the end of the arc
+		/// @param [out] _iAlt alternatives met since the last change
+		/// @param [out] _bSelf the last change was made by the last transition
+		/// @return the last record of the arc
+		unsigned int follow(unsigned int _iArc, unsigned int _iSrc, const float *_pfPenalty, unsigned int &_iSym, unsigned int &_iAlt, bool &_bSelf);
+		/// Symbol of the last event of the hypothesis after the arc, the same as of the record kept by <i>link</i>
+		/// @param [in] _iArc the arc
+		/// @param [in] _iSrc which of the two arrays holds the sources
+		/// @return the symbol, EPS_SYM for no event
+		unsigned int lastSymbol(unsigned int _iArc, unsigned int _iSrc);
+		/// Remove the records of the trace not reachable from any state
+		void collectTrace();
+		/// State of the position in the network
+		/// @param [in] _iPos index of the transition or END_STATE
+		/// @return state number
+		unsigned int state(unsigned int _iPos) {return _iPos == END_STATE ? m_iEndState : m_pNet->pNet[_iPos].iStart;};
+		/// Negative weight of the step of the arc, the first step of the arcs consuming the vector is multiplied by the frame skip
+		/// the same way as by the tokens
+		/// @param [in] _iArc the arc
+		/// @param [in] _iStep index of the step in <i>m_piSteps</i>
+		/// @return the weight
+		float weight(unsigned int _iArc, unsigned int _iStep) {return _iStep == m_piPath[_iArc] && _iArc < m_iArcs ? (-1)*m_pNet->pNet[m_piSteps[_iStep]].fWeight*m_iSkip : (-1)*m_pNet->pNet[m_piSteps[_iStep]].fWeight;};
+		/// Release the compiled tables and the arrays of the states
+		void release();
+	};
+}
+
+#endif
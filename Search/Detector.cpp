@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <string.h>
+#include <float.h>
+
+#include "Detector.h"
+#include "../Data/Snapshot.h"
+
+using namespace Ear;
+
+void CDetector::Configuration::lookUp(CConfig &_cfg)
+{
+	char strategy[100];
+	bool online = false, commit = false;
+
+	_cfg.lookUpBool("ONLINE", &online, false);
+	_cfg.lookUpBool("COMMIT_EVENTS", &commit, false);
+	_cfg.lookUpInt("BCG_IDX", &iBackground, 1);
+	_cfg.lookUpInt("BCG_DUR", &iBackgroundDur, 10);
+
+	/// the strategy given by the older settings if it is not set
+	_cfg.lookUpString("DETECT_STRATEGY", strategy, commit ? "COMMIT" : (online ? "BACKGROUND" : "OFFLINE"));
+	if(strcmp(strategy, "OFFLINE") == 0) iStrategy = OFFLINE;
+	if(strcmp(strategy, "BACKGROUND") == 0) iStrategy = BACKGROUND;
+	if(strcmp(strategy, "COMMIT") == 0) iStrategy = COMMIT;
+}
+
+CDetector::CDetector()
+{
+	m_pSearch = NULL;
+	m_pGate = NULL;
+	m_pEvent = NULL;
+	m_pArg = NULL;
+	m_iTime = 0;
+	m_iPassed = 0;
+}
+
+CDetector::~CDetector()
+{
+}
+
+unsigned int CDetector::initialize(CSearch *_pSearch, CActivityGate *_pGate, const Configuration &_cfg, CTraceArena::Event _pEvent, void *_pArg)
+{
+	if(_pSearch == NULL || _pEvent == NULL) return EAR_FAIL;
+
+	m_pSearch = _pSearch;
+	m_pGate = _pGate;
+	m_cfg = _cfg;
+	m_pEvent = _pEvent;
+	m_pArg = _pArg;
+
+	/// only the committing strategy needs the immortal prefix, the search does not look for it otherwise
+	m_pSearch->changeCommit(m_cfg.iStrategy == Configuration::COMMIT);
+	if(m_cfg.iStrategy == Configuration::COMMIT) m_pSearch->setCallback(commit, this);
+
+	start();
+	return EAR_SUCCESS;
+}
+
+void CDetector::start()
+{
+	m_pSearch->reset();
+	if(m_pGate) m_pGate->reset();
+	m_iTime = 0;
+	m_iPassed = 0;
+	m_results.clear();
+}
+
+unsigned int CDetector::process(CDataContainer &_pData, bool _bActive)
+{
+	unsigned int ret, size;
+
+	/// the time counts the vectors read, the events committed by this vector have it in their latency
+	m_iTime++;
+	ret = m_pGate ? m_pGate->process(_pData, m_iTime - 1, _bActive) : m_pSearch->process(_pData, m_iTime - 1);
+	if(ret == EAR_FAIL) return EAR_FAIL;
+
+	size = m_pSearch->getTraceSize();
+	if(size > m_stats.iPeakTrace) m_stats.iPeakTrace = size;
+
+	if(m_cfg.iStrategy != Configuration::BACKGROUND) return EAR_SUCCESS;
+
+	/// the best hypothesis ending by the long enough background is taken as final, the decoder is reset then, so it
+	/// keeps the traceback since the last background only
+	m_pSearch->getResults(m_results);
+	if(m_results.empty()) return EAR_SUCCESS;
+	CResult &last = m_results.back();
+	if((int)last.iId != m_cfg.iBackground || last.iDur <= m_cfg.iBackgroundDur) return EAR_SUCCESS;
+
+	for(CResults::iterator it = m_results.begin(); it != m_results.end(); it++) pass(*it);
+	m_pSearch->reset();
+	if(m_pGate) m_pGate->reset();
+	m_stats.iResets++;
+
+	return EAR_SUCCESS;
+}
+
+void CDetector::save(CSnapshot &_snap)
+{
+	bool bGate = m_pGate != NULL;
+
+	_snap.write(&m_cfg.iStrategy, sizeof(m_cfg.iStrategy)); _snap.write(&bGate, sizeof(bGate));
+	_snap.write(&m_iTime, sizeof(m_iTime)); _snap.write(&m_iPassed, sizeof(m_iPassed));
+	_snap.write(&m_stats, sizeof(m_stats));
+	if(m_pGate) m_pGate->save(_snap);
+	m_pSearch->save(_snap);
+}
+
+unsigned int CDetector::restore(CSnapshot &_snap)
+{
+	bool bGate;
+
+	if(_snap.check(m_cfg.iStrategy) == EAR_FAIL || _snap.read(&bGate, sizeof(bGate)) == EAR_FAIL || bGate != (m_pGate != NULL)) return EAR_FAIL;
+	if(_snap.read(&m_iTime, sizeof(m_iTime)) == EAR_FAIL || _snap.read(&m_iPassed, sizeof(m_iPassed)) == EAR_FAIL ||
+		_snap.read(&m_stats, sizeof(m_stats)) == EAR_FAIL || (m_pGate && m_pGate->restore(_snap) == EAR_FAIL) ||
+		m_pSearch->restore(_snap) == EAR_FAIL)
+	{
+		m_stats.clear(); start();
+		return EAR_FAIL;
+	}
+	return EAR_SUCCESS;
+}
+
+unsigned int CDetector::finish()
+{
+	/// the vectors skipped by the closed gate, then the feature vectors waiting for the block scoring
+	if(m_pGate) m_pGate->flush();
+	if(m_pSearch->flush() == EAR_FAIL) return EAR_FAIL;
+
+	passResults();
+	return EAR_SUCCESS;
+}
+
+void CDetector::changeThreshold(unsigned int _iSym, float _fMinScore, unsigned int _iMinDur)
+{
+	if(_iSym >= m_minScore.size()) { m_minScore.resize(_iSym + 1, -FLT_MAX); m_minDur.resize(_iSym + 1, 0); }
+	m_minScore[_iSym] = _fMinScore;
+	m_minDur[_iSym] = _iMinDur;
+}
+
+bool CDetector::accept(const CResult &_event)
+{
+	if(_event.iId >= m_minScore.size()) return true;
+	if(_event.iDur < m_minDur[_event.iId]) return false;
+	return _event.iDur == 0 || _event.fScore >= m_minScore[_event.iId] * _event.iDur;
+}
+
+void CDetector::pass(const CResult &_event)
+{
+	int64_t iEnd = _event.iRevIndex + _event.iDur, iLatency = m_iTime - iEnd;
+
+	/// the events after the reset start where the passed ones ended, the rejected ones too
+	if(_event.iRevIndex < m_iPassed) return;
+	m_iPassed = iEnd;
+	if(!accept(_event)) { m_stats.iRejected++; return; }
+
+	m_stats.iEvents++;
+	m_stats.iLatency += iLatency;
+	if(iLatency > m_stats.iMaxLatency) m_stats.iMaxLatency = iLatency;
+
+	m_pEvent(m_pArg, _event);
+}
+
+void CDetector::passResults()
+{
+	m_pSearch->getResults(m_results);
+	for(CResults::iterator it = m_results.begin(); it != m_results.end(); it++) pass(*it);
+}
+
+void CDetector::commit(void *_pArg, const CResult &_event)
+{
+	((CDetector*)_pArg)->pass(_event);
+}
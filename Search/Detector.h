@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+ /**
+ *	Detection of the acoustic events from a stream by the search process and its reset policy.
+ */
+
+#ifndef __EAR_DETECTOR_H_
+#define __EAR_DETECTOR_H_
+
+#include "../Data/Data.h"
+#include "../Data/Config.h"
+#include "Search.h"
+#include "ActivityGate.h"
+
+namespace Ear
+{
+	/**
+	* Controller of the search process over one input stream. It keeps the time of the feature vectors, decides when the
+	* events are final by one of the strategies and passes each of them once to the registered function. The strategies
+	* differ in the latency of the events and in the memory the decoder needs for a long input:
+	*
+	* - OFFLINE: the events are passed at the end of the input, the traceback of the whole input is kept.
+	* - BACKGROUND: when the best hypothesis ends by the background lasting long enough, all its events are passed and
+	*   the decoder is reset, so the traceback is kept only since the last background. The event is passed after the
+	*   following background, and the hypotheses do not cross the reset.
+	* - COMMIT: the events shared by all hypotheses (the immortal prefix of the traceback) are passed as soon as they are
+	*   committed by the decoder (see <i>CSearch::changeCommit</i>), the decoder is never reset. The events are the same
+	*   as in the OFFLINE strategy.
+	*
+	* The latency (the feature vectors between the end of the event and its passing) and the largest traceback of the
+	* decoder are measured for each strategy.
+	*
+	* Each event can have its thresholds (see <i>changeThreshold</i>), the final events shorter than the minimum duration
+	* or with lower mean score per feature vector than the minimum are not passed, they are only counted.
+	*/
+	class CDetector
+	{
+	public:
+		/**
+		* Settings of the detection.
+		*/
+		class Configuration
+		{
+		public:
+			enum _Strategy_ {
+				OFFLINE, ///< the events at the end of the input
+				BACKGROUND, ///< the events when the background is long enough, the decoder is reset then
+				COMMIT ///< the committed events
+			};
+
+		public:
+			/// Set default values of the detection
+			Configuration(){
+				iStrategy = OFFLINE; iBackground = 1; iBackgroundDur = 10;
+			}
+
+			/// Read the settings from the configuration file. The strategy is the COMMIT with the committing of the events,
+			/// otherwise the BACKGROUND in the on-line mode and the OFFLINE in the off-line mode, unless it is given.
+			/// @param [in] _cfg loaded configuration file
+			void lookUp(CConfig &_cfg);
+
+		public:
+			_Strategy_ iStrategy; ///< when the events are final
+			int iBackground; ///< output symbol of the background
+			int iBackgroundDur; ///< duration of the background (in feature vectors) resetting the decoder
+		};
+
+		/**
+		* Counters of the detection, summed over all inputs until they are cleared.
+		*/
+		class Statistics
+		{
+		public:
+			Statistics(){ clear(); }
+			/// Set all counters to zero
+			void clear(){ iEvents = 0; iRejected = 0; iResets = 0; iLatency = 0; iMaxLatency = 0; iPeakTrace = 0; }
+			/// @return mean latency of the events in feature vectors
+			double getMeanLatency(){ return iEvents ? (double)iLatency / iEvents : 0; }
+
+		public:
+			unsigned int iEvents; ///< number of the passed events
+			unsigned int iRejected; ///< number of the final events not passed for their thresholds
+			unsigned int iResets; ///< number of the resets of the decoder by the strategy
+			int64_t iLatency; ///< sum of the latencies of the events, the feature vectors after the end of the event
+			int64_t iMaxLatency; ///< the largest latency of the event
+			unsigned int iPeakTrace; ///< the largest number of the records in the traceback of the decoder
+		};
+
+	public:
+		CDetector();
+		~CDetector();
+
+	private:
+		CSearch *m_pSearch; ///< the controlled search instance
+		CActivityGate *m_pGate; ///< gate in front of the search, NULL for none
+		Configuration m_cfg; ///< the settings
+		CTraceArena::Event m_pEvent; ///< function receiving the events
+		void *m_pArg; ///< argument of the function
+		int64_t m_iTime; ///< time index of the next feature vector
+		int64_t m_iPassed; ///< end of the last passed event, the events starting before it are not passed again
+		Statistics m_stats; ///< the counters
+		CResults m_results; ///< the results of the search read by the strategy
+		std::vector<float> m_minScore; ///< the lowest mean score per feature vector of each output symbol
+		std::vector<int64_t> m_minDur; ///< the shortest duration (in feature vectors) of each output symbol
+
+	public:
+		/// Initialize the controller, the committing of the search is set for the strategy and the committed events are
+		/// received by the controller.
+		/// @param [in] _pSearch initialized search instance
+		/// @param [in] _pGate gate in front of the search instance, NULL to pass the vectors to the search directly
+		/// @param [in] _cfg the settings
+		/// @param [in] _pEvent function receiving the final events, the background included
+		/// @param [in] _pArg argument of the function
+		/// @return success of the initialization
+		unsigned int initialize(CSearch *_pSearch, CActivityGate *_pGate, const Configuration &_cfg, CTraceArena::Event _pEvent, void *_pArg);
+		/// Start a new input from the time zero, the search and the gate are reset. The scorer is reset by the caller,
+		/// as it can be shared.
+		void start();
+		/// Process the next feature vector of the input
+		/// @param [in] _pData Container containing the feature vector
+		/// @param [in] _bActive activity decision for the feature vector (used by the gate only)
+		/// @return success status of the search process
+		unsigned int process(CDataContainer &_pData, bool _bActive = true);
+		/// End of the input, the decoder is fast-forwarded over the vectors in the pre-roll of the closed gate, the feature
+		/// vectors waiting for the block scoring are decoded and all remaining events of the best hypothesis are passed
+		/// @return success status of the search process
+		unsigned int finish();
+		/// @return time index of the next feature vector
+		int64_t getTime(){ return m_iTime; }
+		/// @return the counters of the detection
+		Statistics &getStatistics(){ return m_stats; }
+		/// Set the thresholds of the final events of one output symbol, the symbols have none by default
+		/// @param [in] _iSym the output symbol (event)
+		/// @param [in] _fMinScore the lowest mean score of the event per feature vector, -FLT_MAX for none
+		/// @param [in] _iMinDur the shortest duration of the event in feature vectors, 0 for none
+		void changeThreshold(unsigned int _iSym, float _fMinScore, unsigned int _iMinDur);
+		/// @param [in] _event the event
+		/// @return whether the event passes the thresholds of its symbol
+		bool accept(const CResult &_event);
+		/// Write the state of the detection to the snapshot: the time, the passed events, the counters, the gate and the search.
+		/// The events passed after the snapshot are passed again by the restored controller.
+		/// @param [in, out] _snap the snapshot
+		void save(CSnapshot &_snap);
+		/// Continue the detection from the state written by <i>save</i>, the controller is initialized with the same settings.
+		/// @param [in, out] _snap the snapshot
+		/// @return EAR_FAIL if the snapshot does not match, the detection starts from the time zero then
+		unsigned int restore(CSnapshot &_snap);
+
+	private:
+		/// Pass the event if it was not passed yet
+		/// @param [in] _event the event
+		void pass(const CResult &_event);
+		/// Pass the events of the best hypothesis not passed yet
+		void passResults();
+		/// Receive the committed event from the search instance
+		/// @param [in] _pArg the controller
+		/// @param [in] _event the committed event
+		static void commit(void *_pArg, const CResult &_event);
+	};
+}
+
+#endif
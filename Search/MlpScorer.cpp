@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "MlpScorer.h"
+#include "../Data/Utils.h"
+#include "../Data/Snapshot.h"
+
+/// size of the tile of the weights in floats, the rows of the tile stay in the cache while all vectors go through them
+#define MLP_TILE 8192
+
+using namespace Ear;
+
+/// length of the row padded to the alignment
+static inline unsigned int padded(unsigned int _iSize)
+{
+	const unsigned int iBlock = EAR_ALIGN / sizeof(float);
+	return (_iSize + iBlock - 1) / iBlock * iBlock;
+}
+
+CMlpScorer::CMlpScorer()
+{
+	m_pMlp = NULL;
+	m_fScale = 1.0;
+	m_iLayers = 0;
+	m_ppfWeight = NULL; m_piStride = NULL;
+	m_iWidth = 0; m_iOutputs = 0; m_iFrames = 0;
+	m_pfIn = NULL; m_pfOut = NULL; m_pfScores = NULL; m_pfRow = NULL;
+	m_pfHistory = NULL; m_iHistory = 0;
+}
+
+CMlpScorer::~CMlpScorer()
+{
+	release();
+}
+
+void CMlpScorer::release()
+{
+	unsigned int i;
+
+	if(m_ppfWeight)
+	{
+		for(i=0;i<m_iLayers;i++) freeAligned(m_ppfWeight[i]);
+		delete[] m_ppfWeight;
+	}
+	if(m_piStride) delete[] m_piStride;
+	if(m_pfIn) freeAligned(m_pfIn);
+	if(m_pfOut) freeAligned(m_pfOut);
+	if(m_pfScores) freeAligned(m_pfScores);
+	if(m_pfHistory) freeAligned(m_pfHistory);
+	m_ppfWeight = NULL; m_piStride = NULL;
+	m_pfIn = NULL; m_pfOut = NULL; m_pfScores = NULL; m_pfRow = NULL; m_pfHistory = NULL;
+	m_iFrames = 0; m_iHistory = 0;
+}
+
+void CMlpScorer::setNetwork(EAR_MLP *_mlp, float _fScale)
+{
+	unsigned int i, j;
+	EAR_MLP_Layer *layer;
+
+	release();
+	m_pMlp = _mlp;
+	m_fScale = _fScale;
+
+	/// copy the weights to the aligned rows, the padding is zero so it does not change the dot products
+	m_iLayers = m_pMlp->iLayers;
+	m_ppfWeight = new float*[m_iLayers];
+	m_piStride = new unsigned int[m_pMlp->iLayers];
+	m_iWidth = 0;
+	for(i=0;i<m_pMlp->iLayers;i++)
+	{
+		layer = &m_pMlp->Layers[i];
+		m_piStride[i] = padded(layer->iIn);
+		m_ppfWeight[i] = allocAligned(layer->iOut * m_piStride[i]);
+		memset(m_ppfWeight[i], 0, sizeof(float) * layer->iOut * m_piStride[i]);
+		for(j=0;j<layer->iOut;j++) memcpy(m_ppfWeight[i] + j * m_piStride[i], layer->fWeight + j * layer->iIn, sizeof(float) * layer->iIn);
+
+		if(m_piStride[i] > m_iWidth) m_iWidth = m_piStride[i];
+		if(padded(layer->iOut) > m_iWidth) m_iWidth = padded(layer->iOut);
+	}
+	m_iOutputs = m_pMlp->Layers[m_pMlp->iLayers - 1].iOut;
+
+	m_pfHistory = allocAligned(m_pMlp->iContext * m_pMlp->iVectorSize + 1);
+	allocFrames(1);
+}
+
+void CMlpScorer::allocFrames(unsigned int _iFrames)
+{
+	if(m_pfIn) freeAligned(m_pfIn);
+	if(m_pfOut) freeAligned(m_pfOut);
+	if(m_pfScores) freeAligned(m_pfScores);
+
+	m_iFrames = _iFrames;
+	m_pfIn = allocAligned(m_iFrames * m_iWidth);
+	m_pfOut = allocAligned(m_iFrames * m_iWidth);
+	m_pfScores = allocAligned(m_iFrames * m_iOutputs);
+	/// the padding of the rows stays zero
+	memset(m_pfIn, 0, sizeof(float) * m_iFrames * m_iWidth);
+	memset(m_pfOut, 0, sizeof(float) * m_iFrames * m_iWidth);
+	m_pfRow = m_pfScores;
+}
+
+void CMlpScorer::reset()
+{
+	m_iHistory = 0;
+}
+
+unsigned int CMlpScorer::save(CSnapshot &_snap)
+{
+	unsigned int iSize = m_pMlp ? m_pMlp->iContext * m_pMlp->iVectorSize : 0;
+
+	_snap.write(&iSize, sizeof(iSize));
+	_snap.write(&m_iHistory, sizeof(m_iHistory));
+	if(iSize) _snap.write(m_pfHistory, sizeof(float) * iSize);
+	return EAR_SUCCESS;
+}
+
+unsigned int CMlpScorer::restore(CSnapshot &_snap)
+{
+	unsigned int iSize = m_pMlp ? m_pMlp->iContext * m_pMlp->iVectorSize : 0;
+
+	if(_snap.check(iSize) == EAR_FAIL || _snap.read(&m_iHistory, sizeof(m_iHistory)) == EAR_FAIL) return EAR_FAIL;
+	if(iSize && _snap.read(m_pfHistory, sizeof(float) * iSize) == EAR_FAIL) return EAR_FAIL;
+	return EAR_SUCCESS;
+}
+
+int CMlpScorer::set(CDataContainer *_vector)
+{
+	if(setBlock(_vector, 1) == EAR_FAIL) return EAR_FAIL;
+	selectFrame(0);
+	return EAR_SUCCESS;
+}
+
+void CMlpScorer::selectFrame(unsigned int _iFrame)
+{
+	m_pfRow = m_pfScores + _iFrame * m_iOutputs;
+}
+
+int CMlpScorer::setBlock(CDataContainer *_vectors, unsigned int _iFrames)
+{
+	unsigned int i, k, l;
+	const unsigned int iDim = m_pMlp->iVectorSize;
+	const unsigned int iContext = m_pMlp->iContext * iDim;
+	float *row, *tmp, max, sum;
+
+	for(k=0;k<_iFrames;k++) if(_vectors[k].size() != iDim) {
+		fprintf(stderr, "MlpScorer: Incompatible features: network: %d, input: %d\n", iDim, _vectors[k].size());
+		return EAR_FAIL;
+	}
+
+	if(_iFrames > m_iFrames) allocFrames(_iFrames);
+
+	/// the history is filled by the first vector after the reset
+	if(!m_iHistory)
+	{
+		for(i=0;i<m_pMlp->iContext;i++) memcpy(m_pfHistory + i * iDim, _vectors[0].data(), sizeof(float) * iDim);
+		m_iHistory = m_pMlp->iContext;
+	}
+
+	/// the input of each vector is the history followed by the vector, the history is shifted by one vector
+	for(k=0;k<_iFrames;k++)
+	{
+		row = m_pfIn + k * m_iWidth;
+		memcpy(row, m_pfHistory, sizeof(float) * iContext);
+		memcpy(row + iContext, _vectors[k].data(), sizeof(float) * iDim);
+		memset(row + iContext + iDim, 0, sizeof(float) * (m_iWidth - iContext - iDim));
+		if(iContext) memcpy(m_pfHistory, row + iDim, sizeof(float) * iContext);
+	}
+
+	for(l=0;l<m_pMlp->iLayers;l++)
+	{
+		layer(l, _iFrames);
+		tmp = m_pfIn; m_pfIn = m_pfOut; m_pfOut = tmp;
+	}
+
+	/// log softmax of the outputs minus the log priors
+	for(k=0;k<_iFrames;k++)
+	{
+		row = m_pfIn + k * m_iWidth;
+		for(i=0, max=row[0];i<m_iOutputs;i++) if(row[i] > max) max = row[i];
+		for(i=0, sum=0.0;i<m_iOutputs;i++) sum += expf(row[i] - max);
+		sum = max + logf(sum);
+		for(i=0;i<m_iOutputs;i++) m_pfScores[k * m_iOutputs + i] = m_fScale * (row[i] - sum - m_pMlp->fPrior[i]);
+	}
+
+	m_pfRow = m_pfScores;
+	return EAR_SUCCESS;
+}
+
+void CMlpScorer::layer(unsigned int _iLayer, unsigned int _iFrames)
+{
+	unsigned int i, j, k, o, iEnd, iTile;
+	EAR_MLP_Layer *pLayer = &m_pMlp->Layers[_iLayer];
+	const unsigned int iStride = m_piStride[_iLayer];
+	const float *w, *bias = pLayer->fBias;
+	float *y;
+
+	/// number of the rows of the weights in one tile
+	iTile = MLP_TILE / iStride; if(iTile < 4) iTile = 4;
+
+	for(o=0;o<pLayer->iOut;o+=iTile)
+	{
+		iEnd = o + iTile < pLayer->iOut ? o + iTile : pLayer->iOut;
+
+		/// four vectors at once, each row of the weights is loaded once for all of them
+		for(k=0;k+4<=_iFrames;k+=4)
+		{
+			const float *x0 = m_pfIn + k * m_iWidth, *x1 = x0 + m_iWidth, *x2 = x1 + m_iWidth, *x3 = x2 + m_iWidth;
+			y = m_pfOut + k * m_iWidth;
+			for(i=o;i<iEnd;i++)
+			{
+				float s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+				w = m_ppfWeight[_iLayer] + i * iStride;
+				#pragma omp simd reduction(+:s0,s1,s2,s3)
+				for(j=0;j<iStride;j++) { s0 += w[j] * x0[j]; s1 += w[j] * x1[j]; s2 += w[j] * x2[j]; s3 += w[j] * x3[j]; }
+				y[i] = s0 + bias[i]; y[m_iWidth + i] = s1 + bias[i];
+				y[2 * m_iWidth + i] = s2 + bias[i]; y[3 * m_iWidth + i] = s3 + bias[i];
+			}
+		}
+		for(;k<_iFrames;k++)
+		{
+			const float *x = m_pfIn + k * m_iWidth;
+			y = m_pfOut + k * m_iWidth;
+			for(i=o;i<iEnd;i++)
+			{
+				float s = 0.0;
+				w = m_ppfWeight[_iLayer] + i * iStride;
+				#pragma omp simd reduction(+:s)
+				for(j=0;j<iStride;j++) s += w[j] * x[j];
+				y[i] = s + bias[i];
+			}
+		}
+	}
+
+	/// the activation, the padding after the outputs is cleared as the previous layer could be wider
+	for(k=0;k<_iFrames;k++)
+	{
+		y = m_pfOut + k * m_iWidth;
+		switch(pLayer->iActivation)
+		{
+			case EAR_MLP_RELU: for(i=0;i<pLayer->iOut;i++) if(y[i] < 0.0) y[i] = 0.0; break;
+			case EAR_MLP_SIGMOID: for(i=0;i<pLayer->iOut;i++) y[i] = 1.0 / (1.0 + expf(-y[i])); break;
+			case EAR_MLP_TANH: for(i=0;i<pLayer->iOut;i++) y[i] = tanhf(y[i]); break;
+			default: break;
+		}
+		memset(y + pLayer->iOut, 0, sizeof(float) * (m_iWidth - pLayer->iOut));
+	}
+}
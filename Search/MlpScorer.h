@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+ /**
+ *	This file contains scorer of the states by the feed-forward neural network (hybrid neural network and HMM model).
+ */
+
+#ifndef __EAR_MLPSCORER_H_
+#define __EAR_MLPSCORER_H_
+
+#include "../Data/Data.h"
+#include "Scorer.h"
+
+namespace Ear
+{
+	/**
+	*	Scorer using the feed-forward neural network. The network estimates the posterior probability of each state for the
+	* feature vector, the score of the state is the scaled likelihood log(P(state|x)) - log(P(state)). Optionally the previous
+	* feature vectors are spliced to the input. All vectors of the block are computed at once, the layers are matrix
+	* multiplications of the block by the weights, computed in tiles of the weights that stay in the cache.
+	*/
+	class CMlpScorer : public AScorer
+	{
+	public:
+		CMlpScorer();
+		~CMlpScorer();
+
+	public:
+		/// Set the neural network used for scoring. The aligned tables of the weights are prepared here.
+		/// @param [in] _mlp neural network
+		/// @param [in] _fScale scale of the scores (acoustic scale), the range of the scaled likelihoods is much smaller
+		/// than the one of the likelihoods of the PDFs
+		void setNetwork(EAR_MLP *_mlp, float _fScale = 1.0);
+		/// Compute the scores of all states for the vector
+		/// @param [in] _vector Container containing the current input feature vector
+		/// @return success state of setting new vector for scoring (fails if the vector does not match the network)
+		int set(CDataContainer *_vector);
+		/// Getting the score of the state for the current vector
+		/// @param [in] _Index the index of the state (from one, as the input symbol of the search network)
+		/// @return scaled likelihood of the state
+		float getScore(unsigned int _Index) {return m_pfRow[_Index - 1];};
+		/// Compute the scores of all states for a block of the vectors
+		/// @param [in] _vectors array of the feature vectors
+		/// @param [in] _iFrames number of the vectors in the array
+		/// @return success state of the function (fails if a vector does not match the network)
+		int setBlock(CDataContainer *_vectors, unsigned int _iFrames);
+		/// Use the scores of one vector of the block for the following calls of <i>getScore</i>
+		/// @param [in] _iFrame index of the vector in the block passed to <i>setBlock</i>
+		void selectFrame(unsigned int _iFrame);
+		/// Forget the previous feature vectors spliced to the input
+		void reset();
+		/// @return number of the previous feature vectors spliced to the input
+		unsigned int getContext() {return m_pMlp ? m_pMlp->iContext : 0;};
+		/// Write the previous feature vectors spliced to the input to the snapshot
+		/// @param [in, out] _snap the snapshot
+		/// @return success of the writing
+		unsigned int save(CSnapshot &_snap);
+		/// Read the previous feature vectors from the snapshot
+		/// @param [in, out] _snap the snapshot
+		/// @return EAR_FAIL if the snapshot was written for the network of different context
+		unsigned int restore(CSnapshot &_snap);
+
+	private:
+		EAR_MLP *m_pMlp; ///< neural network
+		float m_fScale; ///< scale of the scores
+		unsigned int m_iLayers; ///< number of the layers the tables are allocated for
+		float **m_ppfWeight; ///< weights of each layer, the rows are aligned and padded by zeroes
+		unsigned int *m_piStride; ///< distance between the rows of the weights (padded number of inputs) of each layer
+		unsigned int m_iWidth; ///< length of the rows of the activation buffers, the widest padded layer
+		unsigned int m_iOutputs; ///< number of the outputs of the last layer (states)
+		unsigned int m_iFrames; ///< number of the vectors the buffers are allocated for
+		float *m_pfIn; ///< activations of the input of the current layer, a row for each vector
+		float *m_pfOut; ///< activations of the output of the current layer, a row for each vector
+		float *m_pfScores; ///< scores of the states, a row for each vector
+		float *m_pfRow; ///< scores of the states of the selected vector
+		float *m_pfHistory; ///< previous feature vectors for splicing, the oldest first
+		unsigned int m_iHistory; ///< number of the vectors in the history, zero after reset
+
+	private:
+		/// Allocate the buffers for the number of the vectors
+		/// @param [in] _iFrames number of the vectors
+		void allocFrames(unsigned int _iFrames);
+		/// Compute one layer for all vectors, from <i>m_pfIn</i> to <i>m_pfOut</i>
+		/// @param [in] _iLayer index of the layer
+		/// @param [in] _iFrames number of the vectors
+		void layer(unsigned int _iLayer, unsigned int _iFrames);
+		/// Release all tables and buffers
+		void release();
+	};
+}
+
+#endif
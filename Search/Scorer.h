@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+ /**
+ *	Interface of the acoustic scorers used by the search process.
+ */
+
+#ifndef __EAR_SCORER_H_
+#define __EAR_SCORER_H_
+
+#include "../Data/Data.h"
+
+namespace Ear
+{
+	/**
+	*	Scorer of the feature vectors against the states referred by the input symbols of the search network. The search
+	* sets each feature vector (or a block of them) and then asks for the scores of the states the tokens go through.
+	* The scores are logarithms of the likelihoods of the vector, or values proportional to them.
+	*/
+	class AScorer
+	{
+	public:
+		virtual ~AScorer(){}
+
+	public:
+		/// Set the current feature vector that will be used for computing scores
+		/// @param [in] _vector Container containing the current input feature vector
+		/// @return success state of setting new vector for scoring (fails if the vector does not match the model)
+		virtual int set(CDataContainer *_vector) = 0;
+		/// Getting the score of the state for the current vector
+		/// @param [in] _Index the index of the state to score, the input symbol of the search network (from one)
+		/// @return score of the state
+		virtual float getScore(unsigned int _Index) = 0;
+		/// Score a block of the feature vectors at once. The scores of the vector are used after the <i>selectFrame</i>.
+		/// @param [in] _vectors array of the feature vectors
+		/// @param [in] _iFrames number of the vectors in the array
+		/// @return success state of the function (fails if a vector does not match the model)
+		virtual int setBlock(CDataContainer *_vectors, unsigned int _iFrames) = 0;
+		/// Use the scores of one vector of the block for the following calls of <i>getScore</i>
+		/// @param [in] _iFrame index of the vector in the block passed to <i>setBlock</i>
+		virtual void selectFrame(unsigned int _iFrame) = 0;
+		/// @return true if the states needed for the current vector should be passed to <i>prefetch</i> before scoring
+		virtual bool isParallel() {return false;};
+		/// Compute the scores of the states for the current vector at once
+		/// @param [in] _piStates indexes of the states in the same form as for <i>getScore</i>, can be repeated
+		/// @param [in] _iCount number of the states
+		virtual void prefetch(const unsigned int *_piStates, unsigned int _iCount) {};
+		/// Forget the previous feature vectors, called at the beginning of a new input. The reset of the search process
+		/// in the middle of the input does not need it, the vectors still follow each other.
+		virtual void reset() {};
+		/// @return number of the previous feature vectors the scores depend on. The vectors of a block need to follow
+		/// each other in one input if it is not zero.
+		virtual unsigned int getContext() {return 0;};
+		/// Write the state depending on the previous feature vectors to the snapshot. The scorers computing each vector on
+		/// its own do not need to implement it.
+		/// @param [in, out] _snap the snapshot
+		/// @return EAR_FAIL if the state can not be saved
+		virtual unsigned int save(CSnapshot &_snap) {return EAR_SUCCESS;};
+		/// Read the state written by <i>save</i> of the scorer with the same model
+		/// @param [in, out] _snap the snapshot
+		/// @return EAR_FAIL if the snapshot does not match the model
+		virtual unsigned int restore(CSnapshot &_snap) {return EAR_SUCCESS;};
+	};
+}
+
+#endif
@@ -21,6 +21,7 @@
 #include <float.h>
 
 #include "Search.h"
+#include "../Data/Snapshot.h"
 
 using namespace Ear;
 
@@ -28,23 +29,125 @@ CSearch::CSearch()
 {
 	m_pScorer = NULL;
 	m_pNet = NULL;
-	m_pTokens = NULL;
-	m_ppStack = NULL;
+	m_pTrace = NULL;
+	m_pStack = NULL;
 	m_iDst = 0; m_iSrc = 0; m_iEndState = 0;
+	m_iIndex = 0;
+	m_iSkip = 1; m_iFrame = 0;
+	m_iBlock = 1; m_pBlock = NULL; m_piBlock = NULL;
+	m_iPending = 0; m_iLast = 0;
+	m_piNeeded = NULL;
+	m_pDense = NULL;
+	m_bCommit = false;
+	m_pCallback = NULL; m_pCallbackArg = NULL;
+	m_iAlts = 0; m_fLatticeBeam = 0; m_piMerge = NULL; m_piMerged = NULL; m_iMerged = 0;
+	m_pConfidence = NULL;
+	m_iRenorm = 0; m_iRenormStep = 0; m_dOffset = 0;
+	m_pfSymPenalty = NULL; m_pbSymPenalty = NULL; m_iSymbols = 0;
 }
 
 CSearch::~CSearch()
 {
-	if(m_pTokens) delete m_pTokens;
-	delete[] m_ppStack;
+	if(m_pTrace) delete m_pTrace;
+	if(m_pStack) delete[] m_pStack;
+	if(m_pBlock) delete[] m_pBlock;
+	if(m_piBlock) delete[] m_piBlock;
+	if(m_piNeeded) delete[] m_piNeeded;
+	if(m_pDense) delete m_pDense;
+	if(m_piMerge) delete[] m_piMerge;
+	if(m_piMerged) delete[] m_piMerged;
+	if(m_pConfidence) delete m_pConfidence;
+	if(m_pfSymPenalty) delete[] m_pfSymPenalty;
+	if(m_pbSymPenalty) delete[] m_pbSymPenalty;
 }
 
 void CSearch::changePenalty(float _fPenalty)
 {
     m_fPenalty = _fPenalty;
+    weighSymbols();
 }
 
-unsigned int CSearch::initialize(EAR_FST_Net *_pNet, CAcousticScorer *_pScorer ,float _fWordInsPenalty)
+unsigned int CSearch::changeSymbolPenalty(unsigned int _iSym, float _fPen)
+{
+	if(_iSym == EPS_SYM || _iSym >= m_iSymbols) return EAR_FAIL;
+
+	m_pbSymPenalty[_iSym] = true; m_pfSymPenalty[_iSym] = _fPen;
+	weighSymbols();
+	return EAR_SUCCESS;
+}
+
+void CSearch::clearSymbolPenalties()
+{
+	for(unsigned int i=0;i<m_iSymbols;i++) m_pbSymPenalty[i] = false;
+	weighSymbols();
+}
+
+void CSearch::weighSymbols()
+{
+	if(!m_pfSymPenalty) return;
+
+	for(unsigned int i=1;i<m_iSymbols;i++) if(!m_pbSymPenalty[i]) m_pfSymPenalty[i] = m_fPenalty;
+	m_pfSymPenalty[EPS_SYM] = 0;
+	if(m_pConfidence) m_pConfidence->weigh(m_pfSymPenalty, m_iSkip);
+}
+
+void CSearch::changeFrameSkip(unsigned int _iSkip)
+{
+    m_iSkip = _iSkip ? _iSkip : 1;
+    m_pool.clear();
+    if(m_pDense) m_pDense->setFrameSkip(m_iSkip);
+    weighSymbols();
+}
+
+void CSearch::changeRenormalization(unsigned int _iInterval)
+{
+	m_iRenorm = _iInterval;
+	m_iRenormStep = 0;
+}
+
+void CSearch::changeCommit(bool _bCommit)
+{
+	m_bCommit = _bCommit;
+}
+
+void CSearch::setCallback(CTraceArena::Event _pCallback, void *_pArg)
+{
+	m_pCallback = _pCallback;
+	m_pCallbackArg = _pArg;
+}
+
+unsigned int CSearch::changeConfidence(float _fScale, float _fBeam, unsigned int _iWindow)
+{
+	if(m_pConfidence) { delete m_pConfidence; m_pConfidence = NULL; }
+	if(_fScale <= 0) return EAR_SUCCESS;
+	if(!m_pNet) return EAR_FAIL;
+
+	m_pConfidence = new CConfidence();
+	if(m_pConfidence->initialize(m_pNet, m_iEndState, _fScale, _fBeam, _iWindow, m_pfSymPenalty, m_iSkip) == EAR_FAIL) { delete m_pConfidence; m_pConfidence = NULL; return EAR_FAIL; }
+
+	return EAR_SUCCESS;
+}
+
+void CSearch::changeLattice(unsigned int _iAlts, float _fBeam)
+{
+	m_iAlts = _iAlts;
+	m_fLatticeBeam = _fBeam;
+	if(m_pDense) m_pDense->setLattice(m_iAlts, m_fLatticeBeam);
+}
+
+void CSearch::changeBlockSize(unsigned int _iBlock)
+{
+	flush();
+
+	if(m_pBlock) delete[] m_pBlock;
+	if(m_piBlock) delete[] m_piBlock;
+	m_pBlock = NULL; m_piBlock = NULL;
+
+	m_iBlock = _iBlock ? _iBlock : 1;
+	if(m_iBlock > 1) { m_pBlock = new CDataContainer[m_iBlock]; m_piBlock = new int64_t[m_iBlock]; }
+}
+
+unsigned int CSearch::initialize(EAR_FST_Net *_pNet, AScorer *_pScorer ,float _fWordInsPenalty, unsigned int _iDenseStates)
 {
 	/// check if the network is there.
 	if(!_pNet) return EAR_FAIL; m_pNet = _pNet;
@@ -63,19 +166,50 @@ unsigned int CSearch::initialize(EAR_FST_Net *_pNet, CAcousticScorer *_pScorer ,
 	m_iEndState++;	///< use the next availabe state number
 	m_iStates = m_iEndState + 1;	///< number of states in the network including zero state that is always initial state of the network
 
-	/// create pool of tokens. Take number of states in search network times 10 number of tokens.
-	/// This needs to be optimized for larger networks, but for events detection it is not crucial
-	/// as the network tends to be really small.
-	m_pTokens = new CTokenPool(10 * m_pNet->iSize);
+	/// the table of the penalties has all output symbols of the network, without their own penalties for now
+	m_iSymbols = 1;
+	for(unsigned int i=0; i<m_pNet->iSize;i++) if(m_pNet->pNet[i].iOut >= m_iSymbols) m_iSymbols = m_pNet->pNet[i].iOut + 1;
+	if(m_pfSymPenalty) delete[] m_pfSymPenalty;
+	if(m_pbSymPenalty) delete[] m_pbSymPenalty;
+	m_pfSymPenalty = new float[m_iSymbols]; m_pbSymPenalty = new bool[m_iSymbols];
+	for(unsigned int i=0;i<m_iSymbols;i++) m_pbSymPenalty[i] = false;
+
+	/// create arena of the trace records. The unused records are collected after the number of transitions in search network
+	/// times 10 new records. At most one record is added by each transition in one time, so this is not done too often.
+	if(m_pTrace) delete m_pTrace;
+	m_pTrace = new CTraceArena(10 * m_pNet->iSize);
 
   /// Prepare viterbi decoding stack. This stack will hold current tokens and token in previous time.
 	/// This is one array divided in half to represent previous time and current time tokens respectively.
 	/// Those halves change place when new input feature vector is consumed.
   m_iSrc = 0; m_iDst = m_iStates;
 	/// allocate two stacks
-	m_ppStack = new CToken*[2 * m_iStates];
+	if(m_pStack) delete[] m_pStack;
+	m_pStack = new CToken[2 * m_iStates];
 	/// reset them
-	memset(m_ppStack, 0, 2 * m_iStates * sizeof(CToken*));
+	for(unsigned int i=0;i<2 * m_iStates;i++) m_pStack[i].clear();
+	/// each transition is taken by one token at most, so its input symbols are enough for the states needed in one time
+	if(m_piNeeded) delete[] m_piNeeded;
+	m_piNeeded = new unsigned int[m_pNet->iSize];
+	/// no tokens were dropped yet
+	if(m_piMerge) delete[] m_piMerge;
+	m_piMerge = new unsigned int[m_iStates];
+	for(unsigned int i=0;i<m_iStates;i++) m_piMerge[i] = NONE;
+	if(m_piMerged) delete[] m_piMerged;
+	m_piMerged = new unsigned int[m_iStates]; m_iMerged = 0;
+
+	/// the confidence is set for the network
+	if(m_pConfidence) { delete m_pConfidence; m_pConfidence = NULL; }
+	weighSymbols();
+
+	/// small networks are decoded without the tokens, unless the network can not be compiled for it
+	if(m_pDense) { delete m_pDense; m_pDense = NULL; }
+	if(m_iStates <= _iDenseStates)
+	{
+		m_pDense = new CDenseSearch();
+		if(m_pDense->initialize(m_pNet, m_iStates, m_iEndState) == EAR_FAIL) { delete m_pDense; m_pDense = NULL; }
+		else { m_pDense->setLattice(m_iAlts, m_fLatticeBeam); m_pDense->setFrameSkip(m_iSkip); }
+	}
 
   /// prepare the decoding process
 	reset();
@@ -85,68 +219,215 @@ unsigned int CSearch::initialize(EAR_FST_Net *_pNet, CAcousticScorer *_pScorer ,
 
 void CSearch::reset()
 {
-	/// remove all tokens from the stacks
-	unsigned int i=0; CToken *token = NULL;
-	for(i=0;i<m_iStates;i++)
-	{
-		token = prev(i); if(token) {m_pTokens->ret(token);}
-		token = cur(i);  if(token) {m_pTokens->ret(token);}
-	}
+	unsigned int i=0; CToken token;
 
-	/// reset stacks
-	memset(m_ppStack, 0, 2 * m_iStates * sizeof(CToken*));
+	/// the skip starts again by the first vector after reset
+	/// the vectors waiting for the block scoring are kept, they will be decoded in the new hypothesis
+	m_iFrame = 0; m_pool.clear();
+	/// the events committed from the previous hypothesis are forgotten as well
+	m_committed.clear();
+	m_iRenormStep = 0; m_dOffset = 0;
+	if(m_pConfidence) m_pConfidence->reset();
 
-	/// create/get from the pool new token
-	token = m_pTokens->add(NULL);
+	if(m_pDense) { m_pDense->reset(m_pfSymPenalty); return; }
+
+	/// remove all tokens from the stacks and their records from the trace
+	for(i=0;i<2 * m_iStates;i++) m_pStack[i].clear();
+	m_pTrace->clear();
+
+	/// new token in the start state of the network, without any symbol
+	token.reset();
 	/// insert it to the start state of the network
 	insert(token, START_STATE);
-	/// reset the symbol of the token
-	token->iSym = EPS_SYM;
 	/// propagate the token through empty input symbols transitions as they are not consuming input feature vectors when crossing them.
 	propagateEmpty(token);
+	if(m_iAlts) selectAlternatives();
 }
 
 unsigned int CSearch::process(CDataContainer &_pData, int64_t _iIndex)
 {
-	CToken *token = NULL;
-	unsigned int i;
+	CDataContainer *pData = &_pData;
 	int ret = 0;
 
 	/// no vector available return fail
   if(!_pData.size()){ return EAR_FAIL; }
 
+	/// skipped vector, only the time moves and the vector is pooled. The pooled vector is processed by the last vector of
+	/// the skip and its score is weighted for all of them. The vectors after the last whole skip only move the time.
+	/// When there are vectors waiting for the block scoring, the time moves after they are decoded.
+	m_iLast = _iIndex;
+	if(!m_iPending) m_iIndex = _iIndex;
+	if(m_iSkip > 1)
+	{
+		pool(_pData);
+		if(++m_iFrame % m_iSkip){ return EAR_SUCCESS; }
+		pData = &m_pool;
+	}
+	else m_iFrame++;
+
+	/// block scoring, wait until the block is full
+	if(m_iBlock > 1)
+	{
+		m_pBlock[m_iPending].copy(pData); m_piBlock[m_iPending] = _iIndex;
+		if(++m_iPending == m_iBlock) return flush();
+		return EAR_SUCCESS;
+	}
+
 	/// set new feature vector to the scorer
-	ret = m_pScorer->set(&_pData); m_iIndex = _iIndex;
+	ret = m_pScorer->set(pData);
 	/// the scorer reported wrong feature vector return fail
 	if(ret == EAR_FAIL){ return EAR_FAIL; }
 
+	step();
+	return EAR_SUCCESS;
+}
+
+void CSearch::pool(CDataContainer &_data)
+{
+	unsigned int i;
+
+	/// the first vector of the skip starts the pool, also after the reset or the fast forward
+	if(m_iFrame % m_iSkip == 0 || m_pool.size() != _data.size()) { m_pool.copy(&_data); return; }
+	for(i=0;i<_data.size();i++) if(_data[i] > m_pool[i]) m_pool[i] = _data[i];
+}
+
+unsigned int CSearch::processScored(int64_t _iIndex)
+{
+	/// the weights would be scaled by the skip while the vector is propagated alone
+	if(m_iSkip > 1 || m_iBlock > 1) return EAR_FAIL;
+	m_iLast = _iIndex; m_iIndex = _iIndex;
+	m_iFrame++;
+	step();
+	return EAR_SUCCESS;
+}
+
+unsigned int CSearch::flush()
+{
+	unsigned int k;
+	int ret = 0;
+
+	if(!m_iPending) return EAR_SUCCESS;
+
+	/// score all waiting vectors at once
+	ret = m_pScorer->setBlock(m_pBlock, m_iPending);
+	if(ret == EAR_FAIL){ m_iPending = 0; return EAR_FAIL; }
+
+	/// propagate the tokens through the vectors in their order
+	for(k=0;k<m_iPending;k++)
+	{
+		m_pScorer->selectFrame(k);
+		m_iIndex = m_piBlock[k];
+		step();
+	}
+
+	/// the time of the skipped vectors received after the last waiting one
+	m_iPending = 0;
+	m_iIndex = m_iLast;
+
+	return EAR_SUCCESS;
+}
+
+void CSearch::step()
+{
+	CToken *token = NULL;
+	unsigned int i;
+
+	/// the states needed by the tokens are scored at once by the threads of the scorer before the propagation
+	if(m_pScorer->isParallel()) prefetch();
+	/// the posteriors use the same scores, the scorer keeps them for the current vector
+	if(m_pConfidence) m_pConfidence->step(m_pScorer, m_iSkip, m_iIndex);
+
+	if(m_pDense)
+	{
+		m_pDense->step(m_pScorer, m_pfSymPenalty, m_iIndex);
+		if(m_bCommit) commit();
+		if(m_iRenorm && ++m_iRenormStep == m_iRenorm) { m_pDense->renormalize(); m_iRenormStep = 0; }
+		return;
+	}
+
+	/// the records of the tokens dropped so far are removed while only the current time stack holds tokens
+	if(m_pTrace->isFull()) collectTrace();
+
 	/// switch the stacks
 	nextTime();
 
 	/// go through all tokens from previous time, if there is token in the state, propagate it to the next transitions consuming input symbols.
-	/// return the old token from the stack to the pool as the new tokens are copies. The old token will be marked for deletion,
-	/// thus not removed to the pool if there are references to it from another tokens.
+	/// The new tokens are copies, the old ones are left in the previous time stack until it is cleared.
   for(i=0;i<m_iStates;i++) ///< we have stack of the tokens equal to the number of states, so go though all state numbers.
   {
       token = prev(i);
-      if(token){ if(token->iPos != END_STATE) propagateFull(token); m_pTokens->ret(token); }
+      if(token && token->iPos != END_STATE) propagateFull(*token);
   }
 
-	return EAR_SUCCESS;
+	/// the alternatives of the new tokens are known when all of them are inserted
+	if(m_iAlts) selectAlternatives();
+
+	/// the events shared by all new tokens are final
+	if(m_bCommit) commit();
+
+	if(m_iRenorm && ++m_iRenormStep == m_iRenorm) { renormalize(); m_iRenormStep = 0; }
+}
+
+void CSearch::renormalize()
+{
+	CToken *token = NULL;
+	unsigned int i;
+	float fBest = -FLT_MAX;
+
+	for(i=0;i<m_iStates;i++) if((token = cur(i)) && token->getScore() > fBest) fBest = token->getScore();
+	if(fBest == -FLT_MAX) return;
+
+	/// the differences of the scores stay, the records are compared with the tokens by adding the offset back
+	for(i=0;i<m_iStates;i++) if((token = cur(i))) token->shift(fBest);
+	m_dOffset += fBest;
+}
+
+double CSearch::getBestScore()
+{
+	CToken *token = NULL;
+	unsigned int i;
+	float fBest = -FLT_MAX;
+
+	for(i=0;i<m_iStates;i++) if((token = cur(i)) && token->getScore() > fBest) fBest = token->getScore();
+	return fBest == -FLT_MAX ? -FLT_MAX : fBest + m_dOffset;
+}
+
+void CSearch::prefetch()
+{
+	CToken *token = NULL;
+	unsigned int i, iPos, iStart, n = 0;
+
+	if(m_pDense) { m_pScorer->prefetch(m_piNeeded, m_pDense->collect(m_piNeeded)); return; }
+
+	/// the same transitions as in propagateFull, only their input symbols are collected
+	for(i=0;i<m_iStates;i++)
+	{
+		token = cur(i);
+		if(!token || token->iPos == END_STATE) continue;
+
+		iPos = token->iPos; iStart = m_pNet->pNet[iPos].iStart;
+		while(iPos < m_pNet->iSize && m_pNet->pNet[iPos].iStart == iStart)
+		{
+			if(m_pNet->pNet[iPos].iEnd != UNDEF_STATE && m_pNet->pNet[iPos].iIn != EPS_SYM) m_piNeeded[n++] = m_pNet->pNet[iPos].iIn;
+			iPos++;
+		}
+	}
+
+	m_pScorer->prefetch(m_piNeeded, n);
 }
 
-void CSearch::propagateEmpty(CToken *_token)
+void CSearch::propagateEmpty(const CToken &_token)
 {
 	/// loading variables
-	unsigned int iPos	= _token->iPos; ///< get position of the current token to propagate (this is the position index in the array of transitions)
+	unsigned int iPos	= _token.iPos; ///< get position of the current token to propagate (this is the position index in the array of transitions)
 	unsigned int iStart = m_pNet->pNet[iPos].iStart; ///< get start state number of the token position (because we are working with the state numbers in viterbi stacks)
-	unsigned int iSym  = _token->iSym;	/// get symbol in the token
+	unsigned int iSym  = _token.iSym;	/// get symbol in the token
 	unsigned int iState = 0;
-	CToken *token = NULL;
+	CToken token;
 
-	/// last tokens tend to have empty symbol, so we take symbol from the previous token
-	/// if it exists. The previous token is guaranteed to have non-empty symbol if it exists.
-	if(!iSym && _token->pPrev) iSym = _token->pPrev->iSym;
+	/// last tokens tend to have empty symbol, so we take symbol from the last record of the token
+	/// if it exists.
+	if(!iSym && _token.iTrace != NONE) iSym = m_pTrace->get(_token.iTrace).iSym;
 
 	/// this is empty symbol propagation, so go through all transition with empty input symbol
 	/// and propagate it through the network.
@@ -158,16 +439,12 @@ void CSearch::propagateEmpty(CToken *_token)
 		/// the transition has empty input symbol, go through that further
 		if(m_pNet->pNet[iPos].iIn == EPS_SYM)
 		{
-			/// create new token that refers to the one with non-empty output symbol
-			if(_token->iSym) token = m_pTokens->add(_token);
-			else token = m_pTokens->add(_token->pPrev);
-
-			/// initialize the token from the current one
-			token->initToken(_token);
+			/// initialize the new token from the current one, it refers to the same record of the trace
+			token.initToken(_token);
 
 			/// copy the time reference from the current token. We are not consuming input feature vector
 			/// so the time stays still.
-			token->iIndex = _token->iIndex;
+			token.iIndex = _token.iIndex;
 
       /// add score found on transition to the token auxiliary score.
 			/// include also insertion penalty if the transition has non-empty output symbol
@@ -175,21 +452,23 @@ void CSearch::propagateEmpty(CToken *_token)
 			/// on transition when we were building it.
 			if(m_pNet->pNet[iPos].iOut && m_pNet->pNet[iPos].iOut != iSym)
 			{
-			    token->addAuxScore((-1)*m_pNet->pNet[iPos].fWeight + m_fPenalty);
-			    token->iSym = m_pNet->pNet[iPos].iOut; ///< the output symbol found on the transition
+			    token.addAuxScore((-1)*m_pNet->pNet[iPos].fWeight + m_pfSymPenalty[m_pNet->pNet[iPos].iOut]);
+			    token.iSym = m_pNet->pNet[iPos].iOut; ///< the output symbol found on the transition
 			}
-			else { token->addAuxScore((-1)*m_pNet->pNet[iPos].fWeight); }
+			else { token.addAuxScore((-1)*m_pNet->pNet[iPos].fWeight); }
 
 			/// set the position of the token to the end state (the end state are here the new position in the array)
 			/// in loading the FST from file we have replaced end state numbers to the indexes of the array where the particular
 			/// transition list starts.
-			token->iPos = m_pNet->pNet[iPos].iEnd;
+			token.iPos = m_pNet->pNet[iPos].iEnd;
+			/// remember the crossed output symbol for the results
+			trace(token);
 
 			/// do not forget to propagate the token from the end state further if the new position of the token is not end state.
-			if(token->iPos != END_STATE) propagateEmpty(token);
+			if(token.iPos != END_STATE) propagateEmpty(token);
 
 			/// get the position of the new token and insert it to stack
-			iState = posToState(token->iPos);
+			iState = posToState(token.iPos);
 			insert(token, iState);
 		}
 		/// go to the next transition that belongs to this start state or until end of the transition array.
@@ -197,19 +476,18 @@ void CSearch::propagateEmpty(CToken *_token)
 	}
 }
 
-void CSearch::propagateFull(CToken *_token)
+void CSearch::propagateFull(const CToken &_token)
 {
 	//variables for cyclus
-	unsigned int iPos	= _token->iPos;			///< get the position of the token (this is position in the array of transitions)
+	unsigned int iPos	= _token.iPos;			///< get the position of the token (this is position in the array of transitions)
 	unsigned int iStart = m_pNet->pNet[iPos].iStart;	///< get actual state number of the token's position (needed to insert the token into viterbi stack)
-	unsigned int iSym  = _token->iSym; ///< get output symbol stored in the token
+	unsigned int iSym  = _token.iSym; ///< get output symbol stored in the token
 	unsigned int iState = 0;
-	CToken *token = NULL;
+	CToken token;
 
 	/// if this is new token and the token does not have crossed output symbol on the any transition so far
-	/// take the output symbol of the previous one that this token is referring to.
-	/// The previous token is guaranteed to have non-empty output symbol stored.
-	if(!iSym && _token->pPrev) iSym = _token->pPrev->iSym;
+	/// take the output symbol of the last record of the trace that this token is referring to.
+	if(!iSym && _token.iTrace != NONE) iSym = m_pTrace->get(_token.iTrace).iSym;
 
 	/// go through all transition that are starting form the same state
 	while(m_pNet->pNet[iPos].iStart == iStart)
@@ -220,39 +498,38 @@ void CSearch::propagateFull(CToken *_token)
 		/// go through transition that have non-empty output symbol
 		if(m_pNet->pNet[iPos].iIn != EPS_SYM)
 		{
-			/// create new token that is referring to the token provided
-			/// or the previous one depending on the non-empty output symbol presence in the referred token.
-			if(_token->iSym) token = m_pTokens->add(_token);
-			else token = m_pTokens->add(_token->pPrev);
-
-			/// initialize token from the previous one, copy the scores
-			token->initToken(_token);
+			/// initialize token from the previous one, copy the scores and the record of the trace
+			token.initToken(_token);
 
 			/// copy the current time reference. The number is increased each time new input feature vector is consumed
-			token->iIndex = m_iIndex;
+			token.iIndex = m_iIndex;
 
-      /// compute auxiliary score, the score found on transitions
-			/// include also the penalty if there was output symbol on the transition
+      /// compute auxiliary score, the score found on transitions, the transition consuming the pooled vector is taken once
+			/// for each vector of the skip. Include also the penalty if there was output symbol on the transition
 			if(m_pNet->pNet[iPos].iOut && m_pNet->pNet[iPos].iOut != iSym)
 			{
-			    token->addAuxScore((-1)*m_pNet->pNet[iPos].fWeight + m_fPenalty);
-			    token->iSym = m_pNet->pNet[iPos].iOut;	///< there was non-empty output symbol on this transition
+			    token.addAuxScore((-1)*m_pNet->pNet[iPos].fWeight*m_iSkip + m_pfSymPenalty[m_pNet->pNet[iPos].iOut]);
+			    token.iSym = m_pNet->pNet[iPos].iOut;	///< there was non-empty output symbol on this transition
 			}
-			else { token->addAuxScore((-1)*m_pNet->pNet[iPos].fWeight); }
+			else { token.addAuxScore((-1)*m_pNet->pNet[iPos].fWeight*m_iSkip); }
 
 			/// compute main score from PDFs. The PDFs are referred by the input symbols on the transitions.
-			token->addMainScore(m_pScorer->getScore(m_pNet->pNet[iPos].iIn));
+			/// With frame skipping the score stands for all vectors until the next processed one.
+			if(m_iSkip > 1) token.addMainScore(m_iSkip * m_pScorer->getScore(m_pNet->pNet[iPos].iIn));
+			else token.addMainScore(m_pScorer->getScore(m_pNet->pNet[iPos].iIn));
 
 			/// get new position of the token. The end state is index in the transition array.
-			token->iPos = m_pNet->pNet[iPos].iEnd;
+			token.iPos = m_pNet->pNet[iPos].iEnd;
+			/// remember the crossed output symbol for the results, the score of the token is complete now
+			trace(token);
 
 			/// do not forget to propagate the new token through any transition with empty input symbol
 			/// leaving from the new state
-			if(token->iPos != END_STATE) propagateEmpty(token);
+			if(token.iPos != END_STATE) propagateEmpty(token);
 
 			/// get the number of state from new position or number of end state if the new position is END_STATE
 			/// and insert new token into viterbi stack
-			iState = posToState(token->iPos);
+			iState = posToState(token.iPos);
 			insert(token, iState);
 		}
 		/// go to the next transition.
@@ -260,22 +537,25 @@ void CSearch::propagateFull(CToken *_token)
 	}
 }
 
-void CSearch::insert(CToken *_token, unsigned int _iState)
+void CSearch::insert(const CToken &_token, unsigned int _iState)
 {
-	/// if this is not plausible token, return it to the pool
-	if(_iState >= m_iStates){m_pTokens->ret(_token); return;}
+	/// if this is not plausible token, drop it
+	if(_iState >= m_iStates){return;}
 
 	/// correct the index in viterbi stack (convert from state number to the index in the stack's array)
 	_iState += m_iDst;
 	/// if the state already has a token, but the token has higher score
-	/// leave the one already in state intact, remove the new one instead.
-	if(m_ppStack[_iState] != NULL && m_ppStack[_iState]->getScore() > _token->getScore())
+	/// leave the one already in state intact, drop the new one instead.
+	/// Its record in the trace (if any) stays there until the next collection.
+	/// With the lattice the dropped token in the beam is kept as the alternative.
+	if(!m_pStack[_iState].isEmpty() && m_pStack[_iState].getScore() > _token.getScore())
 	{
-		m_pTokens->ret(_token); return;
+		if(m_iAlts && _token.getScore() >= m_pStack[_iState].getScore() - m_fLatticeBeam) drop(_token, m_pStack[_iState], _iState - m_iDst);
+		return;
   }
-	/// return the old token from the state to the pool and add new one
-	m_pTokens->ret(m_ppStack[_iState]);
-	m_ppStack[_iState] = _token;
+	/// replace the old token in the state by the new one
+	if(m_iAlts && !m_pStack[_iState].isEmpty() && m_pStack[_iState].getScore() >= _token.getScore() - m_fLatticeBeam) drop(m_pStack[_iState], _token, _iState - m_iDst);
+	m_pStack[_iState] = _token;
 }
 
 CToken *CSearch::prev(unsigned int _iState)
@@ -284,7 +564,7 @@ CToken *CSearch::prev(unsigned int _iState)
 
 	/// correct index depending on which half holds now the previous time tokens
 	_iState += m_iSrc;
-	return m_ppStack[_iState];
+	return m_pStack[_iState].isEmpty() ? NULL : m_pStack + _iState;
 }
 
 CToken *CSearch::cur(unsigned int _iState)
@@ -293,7 +573,7 @@ CToken *CSearch::cur(unsigned int _iState)
 
 	/// correct the index depending on which half now contains the current time tokens.
 	_iState += m_iDst;
-	return m_ppStack[_iState];
+	return m_pStack[_iState].isEmpty() ? NULL : m_pStack + _iState;
 }
 
 void CSearch::nextTime()
@@ -303,7 +583,67 @@ void CSearch::nextTime()
 	m_iDst = m_iSrc;
 	m_iSrc = i;
 
-	memset(m_ppStack + m_iDst, 0, m_iStates * sizeof(CToken*));
+	for(i=0;i<m_iStates;i++) m_pStack[m_iDst + i].clear();
+}
+
+void CSearch::trace(CToken &_token)
+{
+	/// the token crossing the output symbol starts new record, the previous one is the record the token was referring to so far
+	/// the new record has the alternatives of the previous one
+	if(_token.iSym) { _token.iTrace = m_pTrace->add(_token.iSym, _token.iTrace, _token.iIndex, _token.getScore() + m_dOffset, _token.iAlt); _token.iAlt = NONE; }
+}
+
+void CSearch::drop(const CToken &_token, const CToken &_best, unsigned int _iState)
+{
+	unsigned int iRec, iSym, iBest;
+
+	/// the same last event as the staying token, the selection would leave it out. When the staying token is replaced
+	/// later, it is dropped itself and it is better than this one.
+	iRec = lastEvent(_token, _iState); iBest = lastEvent(_best, _iState);
+	if(iRec == iBest) return;
+	iSym = iRec == NONE ? EPS_SYM : m_pTrace->get(iRec).iSym;
+	if(iSym == (iBest == NONE ? EPS_SYM : m_pTrace->get(iBest).iSym)) return;
+
+	/// the link to its path, its symbol and score are used for the selection
+	if(m_piMerge[_iState] == NONE) m_piMerged[m_iMerged++] = _iState;
+	m_piMerge[_iState] = m_pTrace->add(iSym, iRec, m_iIndex, _token.getScore() + m_dOffset, m_piMerge[_iState]);
+}
+
+void CSearch::selectAlternatives()
+{
+	CToken *token = NULL;
+	unsigned int i, n, iRec;
+
+	for(n=0;n<m_iMerged;n++)
+	{
+		i = m_piMerged[n];
+
+		/// the alternatives are before those the token already had
+		token = cur(i); iRec = lastEvent(*token, i);
+		token->iAlt = m_pTrace->select(m_piMerge[i], token->getScore() + m_dOffset, iRec == NONE ? EPS_SYM : m_pTrace->get(iRec).iSym, m_fLatticeBeam, m_iAlts, token->iAlt);
+		m_piMerge[i] = NONE;
+	}
+	m_iMerged = 0;
+}
+
+unsigned int CSearch::lastEvent(const CToken &_token, unsigned int _iState)
+{
+	if(_iState == m_iEndState && _token.iSym) return m_pTrace->get(_token.iTrace).iPrev;
+	return _token.iTrace;
+}
+
+void CSearch::collectTrace()
+{
+	CToken *token = NULL;
+	unsigned int i;
+
+	/// mark the records on the paths of all tokens, the other ones are removed
+	m_pTrace->startCollect();
+	for(i=0;i<m_iStates;i++) { token = cur(i); if(token) { m_pTrace->mark(token->iTrace); m_pTrace->mark(token->iAlt); } }
+	m_pTrace->compact();
+
+	/// the remaining records were moved
+	for(i=0;i<m_iStates;i++) { token = cur(i); if(token) { token->iTrace = m_pTrace->moved(token->iTrace); token->iAlt = m_pTrace->moved(token->iAlt); } }
 }
 
 unsigned int CSearch::posToState(unsigned int _i)
@@ -314,12 +654,201 @@ unsigned int CSearch::posToState(unsigned int _i)
 	return m_pNet->pNet[_i].iStart;
 }
 
+void CSearch::fastForward(int64_t _iIndex)
+{
+	double dBest;
+	int64_t iSkipped;
+
+	/// the waiting vectors are decoded first, they are before the skipped ones
+	flush();
+	if(_iIndex <= m_iIndex) return;
+
+	/// only the time moves, the tokens are waiting for the next feature vector. The skipped vectors are counted as
+	/// received and scored by the mean of the best hypothesis since the reset, added through the offset to all tokens,
+	/// so the mean stays the same. Nothing is added before the first vector after the reset.
+	iSkipped = _iIndex - m_iIndex;
+	m_iIndex = _iIndex;
+	m_pool.clear();
+	if(!m_iFrame) return;
+
+	dBest = m_pDense ? m_pDense->getBestScore() : getBestScore();
+	if(dBest <= -FLT_MAX) return;
+	if(m_pDense) m_pDense->addOffset(dBest / m_iFrame * iSkipped);
+	else m_dOffset += dBest / m_iFrame * iSkipped;
+	m_iFrame += iSkipped;
+}
+
 CToken *CSearch::getEndStateToken()
 {
     return cur(m_iEndState);
 }
 
+void CSearch::commit()
+{
+	CToken *token = NULL;
+	unsigned int i, iRec = NONE;
+	bool bFirst = true;
+	/// the events are passed to the registered function or kept for getCommitted, after their confidence is set
+	CTraceArena::Event pEvent = m_pConfidence ? rate : m_pCallback ? m_pCallback : keep;
+	void *pArg = m_pCallback && !m_pConfidence ? m_pCallbackArg : this;
+
+	if(m_pDense) { m_pDense->commit(pEvent, pArg); return; }
+
+	/// the newest record on the paths of all tokens, all later tokens will continue from it
+	for(i=0;i<m_iStates;i++)
+	{
+		token = cur(i); if(!token) continue;
+		iRec = bFirst ? token->iTrace : m_pTrace->common(iRec, token->iTrace);
+		bFirst = false;
+		if(iRec == NONE) return;
+	}
+	if(iRec == NONE) return;
+
+	/// the symbol crossed by the token itself on the way to the end state is not an event (see <i>traceBack</i>),
+	/// so its record can not end the previous event
+	token = cur(m_iEndState);
+	if(token && token->iSym && token->iTrace == iRec) return;
+
+	m_pTrace->commit(iRec, pEvent, pArg);
+}
+
+void CSearch::save(CSnapshot &_snap)
+{
+	unsigned int i, iCommitted = m_committed.size();
+	CResults::iterator it;
+	bool bConfidence = m_pConfidence != NULL;
+
+	_snap.write(&m_iStates, sizeof(m_iStates)); _snap.write(&m_iBlock, sizeof(m_iBlock));
+	_snap.write(&bConfidence, sizeof(bConfidence));
+	_snap.write(&m_iFrame, sizeof(m_iFrame)); _snap.write(&m_iIndex, sizeof(m_iIndex)); _snap.write(&m_iLast, sizeof(m_iLast));
+	_snap.write(&m_iRenormStep, sizeof(m_iRenormStep)); _snap.write(&m_dOffset, sizeof(m_dOffset));
+
+	/// the waiting vectors are not scored here, the block is scored when it is full the same as without the snapshot
+	_snap.write(&m_iPending, sizeof(m_iPending));
+	for(i=0;i<m_iPending;i++) { _snap.write(m_pBlock[i]); _snap.write(&m_piBlock[i], sizeof(int64_t)); }
+	_snap.write(m_pool);
+
+	_snap.write(&iCommitted, sizeof(iCommitted));
+	for(it=m_committed.begin();it!=m_committed.end();it++) _snap.write(&(*it), sizeof(CResult));
+
+	if(m_pConfidence) m_pConfidence->save(_snap);
+
+	if(m_pDense) { m_pDense->save(_snap); return; }
+
+	/// only the tokens of the current time, the previous time stack is cleared by the next step.
+	/// The lists of the dropped tokens are empty between the steps.
+	_snap.write(m_pStack + m_iDst, m_iStates * sizeof(CToken));
+	m_pTrace->save(_snap);
+}
+
+unsigned int CSearch::restore(CSnapshot &_snap)
+{
+	/// the partly read state is not used, the search starts again
+	reset(); m_iPending = 0;
+	if(restoreState(_snap) == EAR_SUCCESS) return EAR_SUCCESS;
+
+	m_iPending = 0; m_committed.clear();
+	reset(); m_iIndex = 0; m_iLast = 0;
+	return EAR_FAIL;
+}
+
+unsigned int CSearch::restoreState(CSnapshot &_snap)
+{
+	unsigned int i, iCommitted;
+	CResult event;
+	bool bConfidence;
+
+	if(_snap.check(m_iStates) == EAR_FAIL || _snap.check(m_iBlock) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(&bConfidence, sizeof(bConfidence)) == EAR_FAIL || bConfidence != (m_pConfidence != NULL)) return EAR_FAIL;
+
+	if(_snap.read(&m_iFrame, sizeof(m_iFrame)) == EAR_FAIL || _snap.read(&m_iIndex, sizeof(m_iIndex)) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(&m_iLast, sizeof(m_iLast)) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(&m_iRenormStep, sizeof(m_iRenormStep)) == EAR_FAIL || _snap.read(&m_dOffset, sizeof(m_dOffset)) == EAR_FAIL) return EAR_FAIL;
+
+	if(_snap.read(&i, sizeof(i)) == EAR_FAIL || i >= m_iBlock) return EAR_FAIL;
+	for(m_iPending=0;m_iPending<i;m_iPending++)
+		if(_snap.read(m_pBlock[m_iPending]) == EAR_FAIL || _snap.read(&m_piBlock[m_iPending], sizeof(int64_t)) == EAR_FAIL) return EAR_FAIL;
+	if(_snap.read(m_pool) == EAR_FAIL) return EAR_FAIL;
+
+	if(_snap.read(&iCommitted, sizeof(iCommitted)) == EAR_FAIL) return EAR_FAIL;
+	for(i=0;i<iCommitted;i++) { if(_snap.read(&event, sizeof(CResult)) == EAR_FAIL) return EAR_FAIL; m_committed.push_back(event); }
+
+	if(m_pConfidence && m_pConfidence->restore(_snap) == EAR_FAIL) return EAR_FAIL;
+
+	if(m_pDense) return m_pDense->restore(_snap);
+
+	for(i=0;i<2 * m_iStates;i++) m_pStack[i].clear();
+	if(_snap.read(m_pStack + m_iDst, m_iStates * sizeof(CToken)) == EAR_FAIL) return EAR_FAIL;
+	return m_pTrace->restore(_snap);
+}
+
+void CSearch::keep(void *_pArg, const CResult &_event)
+{
+	((CSearch*)_pArg)->m_committed.push_back(_event);
+}
+
+void CSearch::rate(void *_pArg, const CResult &_event)
+{
+	CSearch *pSearch = (CSearch*)_pArg;
+	CResult event = _event;
+
+	/// no following event starts before the end of this one
+	event.fConfidence = pSearch->m_pConfidence->get(event);
+	pSearch->m_pConfidence->release(event.iRevIndex + event.iDur);
+
+	if(pSearch->m_pCallback) pSearch->m_pCallback(pSearch->m_pCallbackArg, event);
+	else keep(pSearch, event);
+}
+
+void CSearch::rateResults(CResults &_results)
+{
+	CResults::iterator it;
+
+	for(it=_results.begin();it!=_results.end();it++) it->fConfidence = m_pConfidence->get(*it);
+}
+
+void CSearch::getCommitted(CResults &_results)
+{
+	_results.splice(_results.end(), m_committed);
+}
+
 void CSearch::getResults(CResults &_results)
+{
+	bool bEnd = m_pDense ? m_pDense->getResults(_results, m_iIndex) : traceBack(_results);
+	if(m_pConfidence) rateResults(_results);
+
+	/// the committed events are before the ones still in the traceback, the same as without the committing,
+	/// there are no results until some hypothesis reaches the end state
+	if(bEnd) _results.insert(_results.begin(), m_committed.begin(), m_committed.end());
+}
+
+void CSearch::getNBest(CNBest &_nbest, unsigned int _iN)
+{
+	CToken *pToken = NULL;
+	unsigned int iRec, iMore = NONE;
+	bool bEnd = true;
+	CNBest::iterator it;
+
+	if(m_pDense) bEnd = m_pDense->getNBest(_nbest, _iN, m_iIndex);
+	else
+	{
+		_nbest.clear();
+		pToken = getEndStateToken();
+		if(pToken == NULL) return;
+
+		/// the alternatives met by the token and those of its own record, which is not an event (see <i>traceBack</i>)
+		iRec = lastEvent(*pToken, m_iEndState);
+		if(pToken->iSym) iMore = m_pTrace->get(pToken->iTrace).iAlt;
+		m_pTrace->nbest(iRec, pToken->iAlt, iMore, m_iIndex, pToken->getScore() + m_dOffset, _iN, _nbest);
+	}
+
+	if(m_pConfidence) for(it=_nbest.begin();it!=_nbest.end();it++) rateResults(it->events);
+
+	/// the committed events are the same for all hypotheses
+	if(bEnd) for(it=_nbest.begin();it!=_nbest.end();it++) it->events.insert(it->events.begin(), m_committed.begin(), m_committed.end());
+}
+
+bool CSearch::traceBack(CResults &_results)
 {
 	/// clear the result structure
   _results.clear();
@@ -327,28 +856,36 @@ void CSearch::getResults(CResults &_results)
   /// get token from end state
   CToken *pToken = getEndStateToken();
 
-  /// if there is no token in the end state or there is no previous token
-	/// return, we do not have any results yet.
-  if(pToken == NULL || pToken->pPrev == NULL) return;
+  /// if there is no token in the end state return, we do not have any results yet.
+  if(pToken == NULL) return false;
 
   CResult newResult;
-	//int64_t iEndIndex = pToken->iIndex;
-
-  //go through all tokens
-  while(pToken->pPrev)
+	/// the last event lasts up to the current time, this differs from the token's time only if the decoder was fast-forwarded
+	int64_t iEndIndex = m_iIndex;
+	/// the output symbol crossed by the token itself on the way to the end state is not an event, the events are the records before it
+	unsigned int iRec = pToken->iSym ? m_pTrace->get(pToken->iTrace).iPrev : pToken->iTrace;
+	double dScore = pToken->getScore() + m_dOffset;
+
+  //go through all records on the path of the token
+  while(iRec != NONE)
 	{
+		const CTraceRecord &rec = m_pTrace->get(iRec);
 		/// start time of the event in number of frames received.
-		newResult.iRevIndex = pToken->pPrev->iIndex;
-		/// duration of the event (subtracting current and previous tokens indexes)
-		newResult.iDur      = pToken->iIndex - pToken->pPrev->iIndex;
+		newResult.iRevIndex = rec.iIndex;
+		/// duration of the event (subtracting current and previous records indexes)
+		newResult.iDur      = iEndIndex - rec.iIndex;
 		/// number of the acoustic event
-		newResult.iId       = pToken->pPrev->iSym;
-		/// score of the acoustic event as difference between current and previous token.
-		newResult.fScore    = pToken->getScore() - pToken->pPrev->getScore();
+		newResult.iId       = rec.iSym;
+		/// score of the acoustic event as difference between current and previous record.
+		newResult.fScore    = dScore - rec.dScore;
 
 		//copy into list of events
 		_results.push_front(newResult);
 
-    pToken = pToken->pPrev;
+    iEndIndex = rec.iIndex;
+    dScore = rec.dScore;
+    iRec = rec.iPrev;
   }
+
+  return true;
 }
@@ -26,13 +26,18 @@
 
 #include "../Data/Data.h"
 #include "Token.h"
-#include "AcousticScorer.h"
+#include "Scorer.h"
+#include "DenseSearch.h"
+#include "Confidence.h"
+
+/// the largest search network (number of the states) decoded by the dense Viterbi instead of the tokens
+#define SEARCH_DENSE_STATES 256
 
 namespace Ear
 {
 	/**
 	*	Search/decoding process implementation. Uses the acoustic model, acoustic scorer and finite state network.
-	* Makes usage of the tokens for searching and retrieving the results.
+	* Makes usage of the tokens for searching and the trace of the output symbols crossed by them for retrieving the results.
 	*/
 	class CSearch
 	{
@@ -41,7 +46,7 @@ namespace Ear
 		~CSearch();
 
 	private:
-		CAcousticScorer *m_pScorer; ///< scorer instance to use
+		AScorer *m_pScorer; ///< scorer instance to use
 		EAR_FST_Net *m_pNet; ///< FST network to use
 		 /// End state number of the whole network. As the search network can possess more than one end state and in each of them the results of detection can be found
 		 /// this class created virtual end state, with this number to connect all end states into one by empty symbols on the transitions. This way the network will have
@@ -51,9 +56,54 @@ namespace Ear
 		/// penalty payed when crossing output symbol in the search network. The higher value the more acoustic events detections on output, the lower the value the less
 		/// detections or merged into one. The right value needs to be found on development set, or otherwise experimentally set.
 		float m_fPenalty;
+		/// Insertion penalty of each output symbol (the index), the propagation takes the penalty of the crossed symbol
+		/// from this table, so the penalties of the symbols do not cost any decision. The empty symbol has zero, the symbols
+		/// without their own penalty have <i>m_fPenalty</i>.
+		float *m_pfSymPenalty;
+		bool *m_pbSymPenalty;	///< whether the symbol has its own penalty set by <i>changeSymbolPenalty</i>
+		unsigned int m_iSymbols;	///< number of the output symbols (the largest one plus one), size of the tables
+		/// Frame skipping. The feature vectors are pooled by <i>m_iSkip</i> and only the pooled vector is scored and propagated,
+		/// its acoustic score and the weights of the transitions consuming it are multiplied by the number of the vectors
+		/// it stands for. The insertion penalty is payed once per event, so it stays the same.
+		unsigned int m_iSkip;
+		unsigned int m_iFrame;	///< number of feature vectors received since the reset (for the frame skipping)
+		/// Element-wise maximum of the feature vectors received since the last propagated one. A short event is not lost
+		/// when its strongest vector falls between the propagated ones.
+		CDataContainer m_pool;
+		/// Block scoring. The feature vectors are collected until <i>m_iBlock</i> of them are available, then they are
+		/// scored at once by the scorer and the tokens are propagated through all of them. The decoding is delayed by
+		/// up to <i>m_iBlock</i> - 1 vectors.
+		unsigned int m_iBlock;
+		CDataContainer *m_pBlock;	///< feature vectors waiting for the block scoring
+		int64_t *m_piBlock;	///< time indexes of the waiting feature vectors
+		unsigned int m_iPending;	///< number of the waiting feature vectors
+		int64_t m_iLast;	///< time index of the last feature vector received
+		unsigned int *m_piNeeded;	///< input symbols (states) needed by the tokens in one time, passed to the scorer with more threads
+		CDenseSearch *m_pDense;	///< dense Viterbi decoding used instead of the tokens for small networks, NULL for the tokens
+		CConfidence *m_pConfidence;	///< posteriors of the output symbols for the confidence of the events, NULL without it
+		/// Partial traceback. After each feature vector the events on the path shared by all hypotheses are committed,
+		/// they are final as no later vector can change them.
+		bool m_bCommit;
+		CResults m_committed;	///< committed events not taken by <i>getCommitted</i> yet
+		CTraceArena::Event m_pCallback;	///< function receiving the committed events instead of <i>m_committed</i>, NULL for none
+		void *m_pCallbackArg;	///< argument of the function
+		/// Lattice. The tokens dropped in a state by the better one are kept as its alternatives, only those with another
+		/// last symbol and not worse than by the beam, at most <i>m_iAlts</i> of them in each state and time. The alternatives
+		/// are passed to the next record of the token (see <i>CTraceRecord</i>), so they cost nothing between the symbols.
+		unsigned int m_iAlts;
+		float m_fLatticeBeam;	///< the largest difference of the score of the alternative
+		unsigned int *m_piMerge;	///< tokens dropped in each state in the current time, waiting for the selection
+		unsigned int *m_piMerged;	///< states with the dropped tokens in the current time, the selection visits only them
+		unsigned int m_iMerged;	///< number of the states in <i>m_piMerged</i>
+		/// Renormalization of the scores. Each <i>m_iRenorm</i>-th time the best score of the tokens is subtracted from all
+		/// of them and added to the offset, so the float scores of the tokens stay small on continuous input without
+		/// resetting the decoder. The records of the trace keep the scores with the offset, so the events are the same.
+		unsigned int m_iRenorm;
+		unsigned int m_iRenormStep;	///< number of the times since the last renormalization
+		double m_dOffset;	///< sum of the scores subtracted from the tokens since the reset
 
-		CTokenPool *m_pTokens; 	///< token pool
-		CToken **m_ppStack;	///< stacks of the tokens, half referring to tokens in previous time and the other half to current time.
+		CTraceArena *m_pTrace; 	///< records of the output symbols crossed by the tokens
+		CToken *m_pStack;	///< stacks of the tokens, half holding tokens in previous time and the other half in current time (empty tokens in the states without token).
 		unsigned int m_iSrc;	///< beginning of the tokens in previous time in the stack
 		unsigned int m_iDst;	///< beginning of the tokens in current time in stack
 		unsigned int m_iStates;	///< maximum number of states in the search network
@@ -66,56 +116,195 @@ namespace Ear
 		/// @param [in] _iIndex time reference to include into tokens (NOTE: this is no longer used, but the time reference is rather computed reversely from last token)
 		/// @return success status of the process (when the container is empty or does not match with the acoustic model EAR_FAIL is returned)
 		unsigned int process(CDataContainer &_pData, int64_t _iIndex);
+		/// Propagate the tokens by the feature vector already scored and selected in the scorer by the caller. This is used
+		/// when more search instances share one scorer (see <i>CBatchSearch</i>), the frame skipping and the block scoring
+		/// can not be used by this instance, as the vector is neither pooled nor waiting in the block.
+		/// @param [in] _iIndex time index of the vector
+		/// @return EAR_FAIL if the frame skipping or the block scoring is set
+		unsigned int processScored(int64_t _iIndex);
 		/// Initialize the decoding process. Search for the end state. Creates instance of the pool.
 		/// @param [in] _pNet search network
 		/// @param [in] _pScorer scorer instance
 		/// @param [in] _fWordInsPenalty insertion penalty payed when crossing transitions with non-empty output symbol
+		/// @param [in] _iDenseStates the networks up to this number of the states are decoded by the dense Viterbi (see CDenseSearch)
+		/// with the same results, 0 to use the tokens always
 		/// @return success of the initialization process
-		unsigned int initialize(EAR_FST_Net *_pNet, CAcousticScorer *_pScorer, float _fWordInsPenalty);
-		/// Reset the decoding process and prepares new one. All tokens in the stacks are removed (returned to the pool)
-		/// the stack are cleared. To the current time stack new token is placed referring to the initial state of the network.
+		unsigned int initialize(EAR_FST_Net *_pNet, AScorer *_pScorer, float _fWordInsPenalty, unsigned int _iDenseStates = SEARCH_DENSE_STATES);
+		/// Reset the decoding process and prepares new one. All tokens in the stacks and the trace are removed. To the current time stack new token is placed referring to the initial state of the network.
 		/// next the propagation of the token through transitions with empty input symbol to another states is done.
 		void reset();
 		/// Getting the virtual end state token from the current stack
-		/// @return pointer to the token.
+		/// @return pointer to the token, NULL with the dense Viterbi decoding as it does not use the tokens
 		CToken *getEndStateToken();
 		/// Set penalty that is payed when crossing non-empty output symbol on the search network.
 		/// @param [in] _fPen new penalty to set
 		void changePenalty(float _fPen);
+		/// Set the penalty of one output symbol, used instead of the global one (see <i>changePenalty</i>) when the symbol is
+		/// crossed. Lower penalty of an event means less false alarms of it. It can be changed any time, the hypotheses
+		/// already decoded keep their scores.
+		/// @param [in] _iSym the output symbol (event), from one
+		/// @param [in] _fPen new penalty of the symbol
+		/// @return EAR_FAIL if the symbol is not in the network
+		unsigned int changeSymbolPenalty(unsigned int _iSym, float _fPen);
+		/// The penalties of all symbols set by <i>changeSymbolPenalty</i> are replaced by the global one
+		void clearSymbolPenalties();
+		/// Set the frame skipping. The acoustic scorer is evaluated and the tokens are propagated only on each <i>_iSkip</i>-th
+		/// feature vector, the element-wise maximum of the vectors since the last propagated one is scored instead of it and
+		/// the score and the weights are reused for the vectors in between. The time indexes in the results stay in the original
+		/// frames.
+		/// @param [in] _iSkip propagate each <i>_iSkip</i>-th vector (1 or 0 to process all vectors)
+		void changeFrameSkip(unsigned int _iSkip);
+		/// Set the number of the feature vectors scored at once. The waiting vectors are decoded before the change.
+		/// @param [in] _iBlock number of the vectors in the block (1 or 0 to score each vector when received)
+		void changeBlockSize(unsigned int _iBlock);
+		/// Decode all feature vectors waiting for the block scoring. Needs to be called at the end of the input before
+		/// reading the final results, otherwise the results are behind the input by the waiting vectors.
+		/// @return success status of the decoding (EAR_FAIL if the vectors do not match with the acoustic model)
+		unsigned int flush();
+		/// Advance the time of the decoding process without consuming any feature vector. The hypotheses stay
+		/// intact, only the last detected event is prolonged up to the new time index. This is used to hold the
+		/// decoder in the background while there is no activity in the input signal. The skipped vectors are not scored,
+		/// all hypotheses get the mean score per vector of the best one instead, so the score of the prolonged event
+		/// stays comparable with the decoding of all vectors (the thresholds of <i>CDetector</i> are applied to it).
+		/// @param [in] _iIndex time index of the last skipped feature vector
+		void fastForward(int64_t _iIndex);
+		/// @return true if the network is decoded by the dense Viterbi instead of the tokens
+		bool isDense() {return m_pDense != NULL;};
+		/// Set the partial traceback. The events shared by all hypotheses are committed as soon as they are final and
+		/// their traceback is released, so the memory stays bounded on continuous input without resetting the decoder.
+		/// @param [in] _bCommit commit the final events after each feature vector
+		void changeCommit(bool _bCommit);
 		/// Get the acoustic events list detected so far.
 		/// @param [out] _results reference to the list that will be filled with the acoustic events detected.
 		void getResults(CResults &_results);
+		/// Take the committed events. They are moved to the list, so they are not returned by <i>getResults</i> anymore and
+		/// the next call returns only the events committed since this one.
+		/// @param [out] _results list the committed events are appended to, the oldest one first
+		void getCommitted(CResults &_results);
+		/// Set the function receiving the committed events. The events are passed to it from <i>process</i>, <i>flush</i>
+		/// and <i>fastForward</i> as soon as they are committed, instead of keeping them for <i>getCommitted</i> and
+		/// <i>getResults</i>. This costs nothing for the frames without new events and allocates no memory.
+		/// The committing needs to be enabled by <i>changeCommit</i>.
+		/// @param [in] _pCallback function receiving the events, NULL to keep them in the decoder again
+		/// @param [in] _pArg argument of the function
+		void setCallback(CTraceArena::Event _pCallback, void *_pArg);
+		/// Set the lattice of the alternative hypotheses, read by <i>getNBest</i>. It takes effect for the hypotheses
+		/// continuing from the current time.
+		/// @param [in] _iAlts the largest number of the alternatives kept in one state and time, 0 for no lattice
+		/// @param [in] _fBeam the largest difference of the score of the alternative from the best hypothesis in the state
+		void changeLattice(unsigned int _iAlts, float _fBeam);
+		/// Get the best hypotheses of the lattice reaching the end state. Without the lattice only the best one is found, the
+		/// same as by <i>getResults</i>. The hypotheses with the same events as a better one are left out, the events are
+		/// preceded by the committed ones.
+		/// @param [out] _nbest list to fill, the best hypothesis first
+		/// @param [in] _iN the largest number of the hypotheses
+		void getNBest(CNBest &_nbest, unsigned int _iN);
+		/// Set the confidence of the events, the posterior probability of their symbols from the forward pass summing all
+		/// paths of the network (see <i>CConfidence</i>). The events of <i>getResults</i>, <i>getNBest</i> and the committed
+		/// ones have it in <i>CResult::fConfidence</i>. It starts from the start state, so it should be set before the
+		/// decoding or together with the reset. It needs to be set again after <i>initialize</i>.
+		/// @param [in] _fScale scale of the scores, 0 for no confidence
+		/// @param [in] _fBeam pruning beam of the forward pass, in the scaled scores
+		/// @param [in] _iWindow number of the following feature vectors seen by the backward pass, 0 for the forward pass only
+		/// @return success of the setting, fails if the network has a loop of the empty transitions
+		unsigned int changeConfidence(float _fScale, float _fBeam, unsigned int _iWindow);
+		/// Set the renormalization of the scores of the hypotheses (see <i>m_iRenorm</i>). The scores of the events change
+		/// only by the rounding, the renormalization costs one pass over the states each time it is done.
+		/// @param [in] _iInterval number of the processed feature vectors between the renormalizations, 0 for none
+		void changeRenormalization(unsigned int _iInterval);
+		/// @return number of the records in the traceback of the hypotheses, the memory used by the search grows with it
+		unsigned int getTraceSize() {return m_pDense ? m_pDense->getTraceSize() : m_pTrace->size();};
+		/// Write the state of the decoding to the snapshot: the hypotheses, their traceback, the feature vectors waiting for
+		/// the block scoring, the events committed and not taken yet, the posteriors and the time. The settings are not written,
+		/// the restoring search needs the same network and the same <i>change*</i> calls.
+		/// @param [in, out] _snap the snapshot
+		void save(CSnapshot &_snap);
+		/// Continue the decoding from the state written by <i>save</i>, the decoding goes on exactly as it would without
+		/// the snapshot. The scorer is restored separately.
+		/// @param [in, out] _snap the snapshot
+		/// @return EAR_FAIL if the snapshot does not match the network or the settings, the search is reset then
+		unsigned int restore(CSnapshot &_snap);
 
 	private:
 		/// Propagate token through all transitions that have empty input symbol. The empty input symbol means that no input feature vector is consumed
 		/// @param [in] _token token to be propagated through the empty transitions
-		void propagateEmpty(CToken *_token);
+		void propagateEmpty(const CToken &_token);
 		/// Propagate token through all transition that non-empty input symbol. This function uses current set feature vector to score against states of acoustic model
 		/// represented by input symbol.
 		/// param [in] _token token to propagate through the non-empty transitions.
-		void propagateFull(CToken *_token);
+		void propagateFull(const CToken &_token);
 		/// Inserts token to the state. Meaning that it inserts token into stack of current time while performing the viterbi conditions.
-		/// The token is inserted into state only if its score is larger than the one that is already there. The token with the lowest score
-		/// is returned to the pool. If there is no token in the state, the new one is simply inserted there.
+		/// The token is copied into state only if its score is larger than the one that is already there, replacing it. The token with the lowest score
+		/// is dropped. If there is no token in the state, the new one is simply copied there.
 		/// @param [in] _token token to insert
 		/// @param [in] _iState state of the token to insert to.
-		void insert(CToken *_token, unsigned int _iState);
+		void insert(const CToken &_token, unsigned int _iState);
 		/// Get token from previos time stack
 		/// @param [in] _iState state from which we want to retrieve the token
-		/// @return pointer to token
+		/// @return pointer to token, NULL if there is no token in the state
 		CToken *prev(unsigned int _iState);
 		/// Get token from current time stack
 		/// @param [in] _iState state from which we want to retrieve the token
-		/// @return pointer to the token.
+		/// @return pointer to the token, NULL if there is no token in the state
 		CToken *cur(unsigned int _iState);
+		/// Set the record of the output symbol crossed by the token, when it crosses one
+		/// @param [in, out] _token token that crossed the output symbol
+		void trace(CToken &_token);
+		/// Remove the records of the trace not reachable from the tokens in the current time stack (see <i>CTraceArena</i>)
+		void collectTrace();
+		/// Commit the events on the path shared by all tokens in the current time stack
+		void commit();
+		/// Keep the token dropped in the state in the beam of the lattice as the alternative of the token staying there. The token
+		/// with the same last event as the staying one is not kept, it is worse than the staying one.
+		/// @param [in] _token the dropped token
+		/// @param [in] _best the token staying in the state
+		/// @param [in] _iState the state
+		void drop(const CToken &_token, const CToken &_best, unsigned int _iState);
+		/// Choose the alternatives of the tokens from those dropped in their states in the current time
+		void selectAlternatives();
+		/// @param [in] _token the token
+		/// @param [in] _iState state of the token
+		/// @return record of the last event of the token, the own symbol of the token in the end state is not an event
+		unsigned int lastEvent(const CToken &_token, unsigned int _iState);
+		/// Keep the committed event for <i>getCommitted</i>, used when no function receives the events
+		/// @param [in] _pArg the search instance
+		/// @param [in] _event the committed event
+		static void keep(void *_pArg, const CResult &_event);
+		/// Set the confidence of the committed event and pass it on, used instead of the function receiving the events
+		/// @param [in] _pArg the search instance
+		/// @param [in] _event the committed event
+		static void rate(void *_pArg, const CResult &_event);
+		/// Set the confidence of the events not committed yet
+		/// @param [in, out] _results the events
+		void rateResults(CResults &_results);
+		/// Get the events on the path of the token in the end state, the uncommitted ones
+		/// @param [out] _results list to fill
+		/// @return false if there is no token in the end state
+		bool traceBack(CResults &_results);
 		/// Converting position of the token to state number. The position of the token is referring to the position in the transitions array
 		/// and not directly to state number. The state number can be obtained by looking to the index of the array and getting the start state number.
 		/// @param [in] _i position to convert.
 		/// @return state number (if the end state is marked as end state, the new end state number is returned)
 		unsigned int posToState(unsigned int _i);
 		/// switches the stacks. Modifies the indexes <i>m_iSrc</i> and <i>m_iDst</i> and clears the new current time stack from all tokens.
-		/// The pointers of the tokens are removed not the actual tokens.
 		void nextTime();
+		/// Propagate the tokens from the previous time by the feature vector already set to the scorer
+		void step();
+		/// Add the feature vector to the pool of the skip (see <i>m_pool</i>)
+		/// @param [in] _data feature vector
+		void pool(CDataContainer &_data);
+		/// Subtract the best score of the current tokens from all of them and add it to the offset
+		void renormalize();
+		/// @return the best score of the current tokens with the offset, -FLT_MAX for none
+		double getBestScore();
+		/// Fill the global penalty to the symbols without their own one and pass the penalties to the posteriors
+		void weighSymbols();
+		/// Read the state written by <i>save</i>, the search is left partly restored on failure
+		/// @param [in, out] _snap the snapshot
+		/// @return EAR_FAIL if the snapshot does not match
+		unsigned int restoreState(CSnapshot &_snap);
+		/// Collect the states needed by the tokens from the previous time and let the scorer compute them at once
+		void prefetch();
 	};
 } //end of Ear namespace
 
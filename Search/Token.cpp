@@ -17,101 +17,295 @@
  * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
  */
 
+
 #include <string.h>
+#include <stdint.h>
+#include <float.h>
+#include <queue>
+#include <algorithm>
+#include <unordered_set>
 #include "Token.h"
+#include "../Data/Snapshot.h"
 
 #include <stdio.h>
 
+/// the largest number of the partial paths searched for the N best ones
+#define NBEST_PATHS 65536
+
 using namespace Ear;
 
-CTokenPool::CHolder::CHolder(unsigned int _iMax)
+CTraceArena::CTraceArena(unsigned int _iYoung)
+{
+	m_iYoung = _iYoung ? _iYoung : 1;
+	m_iMax = 2 * m_iYoung;
+	m_pRecs = new CTraceRecord[m_iMax];
+	m_piMap = new unsigned int[m_iMax];
+	m_iFrom = 0;
+	clear();
+}
+
+CTraceArena::~CTraceArena()
+{
+	delete[] m_pRecs;
+	delete[] m_piMap;
+}
+
+void CTraceArena::clear()
+{
+	m_iSize = 0; m_iOld = 0;
+	m_iMajor = m_iYoung;
+	m_iCommitted = 0;
+}
+
+void CTraceArena::save(CSnapshot &_snap)
+{
+	_snap.write(&m_iYoung, sizeof(m_iYoung));
+	_snap.write(&m_iSize, sizeof(m_iSize)); _snap.write(&m_iOld, sizeof(m_iOld));
+	_snap.write(&m_iMajor, sizeof(m_iMajor)); _snap.write(&m_iFrom, sizeof(m_iFrom));
+	_snap.write(&m_iCommitted, sizeof(m_iCommitted));
+	/// the records are plain data, the unused ones after them are not needed
+	_snap.write(m_pRecs, m_iSize * sizeof(CTraceRecord));
+}
+
+unsigned int CTraceArena::restore(CSnapshot &_snap)
+{
+	unsigned int iSize;
+
+	if(_snap.check(m_iYoung) == EAR_FAIL || _snap.read(&iSize, sizeof(iSize)) == EAR_FAIL) return EAR_FAIL;
+	/// nothing is kept from the current records
+	m_iSize = 0;
+	while(m_iMax < iSize) grow();
+	if(_snap.read(&m_iOld, sizeof(m_iOld)) == EAR_FAIL || _snap.read(&m_iMajor, sizeof(m_iMajor)) == EAR_FAIL) { clear(); return EAR_FAIL; }
+	if(_snap.read(&m_iFrom, sizeof(m_iFrom)) == EAR_FAIL || _snap.read(&m_iCommitted, sizeof(m_iCommitted)) == EAR_FAIL) { clear(); return EAR_FAIL; }
+	if(_snap.read(m_pRecs, iSize * sizeof(CTraceRecord)) == EAR_FAIL) { clear(); return EAR_FAIL; }
+	m_iSize = iSize;
+	return EAR_SUCCESS;
+}
+
+void CTraceArena::grow()
 {
-    iMax = _iMax;
-    pAllocs = new CToken[_iMax];
-    pLink = NULL;
+	/// the records are plain data, they are moved by copying
+	CTraceRecord *pRecs = new CTraceRecord[2 * m_iMax];
+	memcpy(pRecs, m_pRecs, m_iSize * sizeof(CTraceRecord));
+	delete[] m_pRecs; m_pRecs = pRecs;
+
+	delete[] m_piMap; m_piMap = new unsigned int[2 * m_iMax];
+	m_iMax *= 2;
 }
 
-CTokenPool::CHolder::~CHolder()
+unsigned int CTraceArena::add(unsigned int _iSym, unsigned int _iPrev, int64_t _iIndex, double _dScore, unsigned int _iAlt)
 {
-    delete[] pAllocs;
+	if(m_iSize == m_iMax) grow();
+
+	/// take the next record from the array
+	CTraceRecord &rec = m_pRecs[m_iSize];
+	rec.iSym = _iSym; rec.iPrev = _iPrev;
+	rec.iIndex = _iIndex; rec.dScore = _dScore;
+	rec.iAlt = _iAlt;
+
+	return m_iSize++;
 }
 
-CTokenPool::CTokenPool(unsigned int _iNum)
+void CTraceArena::startCollect()
 {
-	m_iNum = _iNum;
-	m_pEls = NULL;
-	m_pHld = new CHolder(m_iNum);
-	chain(m_pHld->pAllocs, m_pHld->iMax);
+	/// the old records are collected too only if they have grown enough since the last time
+	m_iFrom = m_iOld > m_iMajor ? 0 : m_iOld;
+
+	memset(m_piMap, 0xff, (m_iSize - m_iFrom) * sizeof(unsigned int));
 }
 
-CTokenPool::~CTokenPool()
+void CTraceArena::mark(unsigned int _iRec)
 {
-	CHolder *tmp = m_pHld;
-	while(tmp)
+	/// go back on the path until the older generation or the record already marked by another token,
+	/// the paths of the alternatives are marked after it
+	while(1)
 	{
-		m_pHld = m_pHld->pLink;
-		delete tmp;
-		tmp = m_pHld;
+		while(_iRec != NONE && _iRec >= m_iFrom && m_piMap[_iRec - m_iFrom] == NONE)
+		{
+			m_piMap[_iRec - m_iFrom] = 0;
+			if(m_pRecs[_iRec].iAlt != NONE) m_stack.push_back(m_pRecs[_iRec].iAlt);
+			_iRec = m_pRecs[_iRec].iPrev;
+		}
+		if(m_stack.empty()) break;
+		_iRec = m_stack.back(); m_stack.pop_back();
 	}
 }
 
-void CTokenPool::chain(CToken *_p, unsigned int _iMax)
+void CTraceArena::compact()
 {
-	unsigned int i;
-  /// go through the inner array of the tokens and prepend them into token's pool linked list of free tokens.
-	for(i=0;i<_iMax;i++)
+	unsigned int i, n = m_iFrom;
+
+	/// move the marked records to the beginning of the generation, the previous records are always older,
+	/// so they are already moved
+	for(i=m_iFrom;i<m_iSize;i++)
 	{
-		_p[i].pPrev = m_pEls;
-		m_pEls = _p + i;
+		if(m_piMap[i - m_iFrom] == NONE) continue;
+		m_pRecs[n] = m_pRecs[i];
+		m_pRecs[n].iPrev = moved(m_pRecs[n].iPrev);
+		m_pRecs[n].iAlt = moved(m_pRecs[n].iAlt);
+		m_piMap[i - m_iFrom] = n++;
 	}
 
-	m_iNum += _iMax;
+	/// all remaining records are old now
+	if(!m_iFrom) m_iMajor = 2 * n > m_iYoung ? 2 * n : m_iYoung;
+	m_iSize = n; m_iOld = n;
 }
 
-void CTokenPool::allocate(unsigned int _iMax)
+unsigned int CTraceArena::common(unsigned int _iA, unsigned int _iB)
 {
-  /// allocate new holder and thus new tokens.
-	CHolder *tmp = new CHolder(_iMax);
-	tmp->pLink = m_pHld;
-	m_pHld = tmp;
-  /// stack them into linked list of the token pool
-	chain(tmp->pAllocs, tmp->iMax);
+	/// the previous records are always older (lower index), so the newer one of the two goes back until they meet
+	while(_iA != _iB)
+	{
+		if(_iA == NONE || _iB == NONE) return NONE;
+		if(_iA > _iB) _iA = m_pRecs[_iA].iPrev;
+		else _iB = m_pRecs[_iB].iPrev;
+	}
+
+	return _iA;
 }
 
-CToken *CTokenPool::add(CToken *_p)
+void CTraceArena::commit(unsigned int _iRec, Event _pEvent, void *_pArg)
 {
-  /// take the previous token and increase its usage
-	if(_p) _p->iUsage++;
-  /// if there is not any token available in pool create new holder and allocated next ones
-	if(!m_pEls) allocate(m_pHld->iMax);
-
-  /// get the top token from linked list
-	CToken *tmp = m_pEls;
-	m_pEls = tmp->pPrev;
-
-  /// initialize it, chain with the previous provided and return
-  /// increase also the usage of the new token as the token is needed.
-  /// token that usage drops to zero will be removed
-	tmp->reset(); tmp->iUsage++; tmp->pPrev = _p;
-	return tmp;
+	CResult event;
+	unsigned int iRec = m_pRecs[_iRec].iPrev, iNext = _iRec, iTmp;
+
+	/// nothing to commit, the alternatives stay too
+	if(iRec == NONE) return;
+
+	/// turn the links of the older records the other way round, so they can be reported from the oldest one without
+	/// any memory, they are not reachable after the commit anyway
+	while(iRec != NONE) { iTmp = m_pRecs[iRec].iPrev; m_pRecs[iRec].iPrev = iNext; iNext = iRec; iRec = iTmp; }
+
+	/// the same events as reported from the token, each one ends by the next record
+	for(iRec = iNext; iRec != _iRec; iRec = iNext)
+	{
+		iNext = m_pRecs[iRec].iPrev;
+		event.iRevIndex = m_pRecs[iRec].iIndex;
+		event.iDur      = m_pRecs[iNext].iIndex - m_pRecs[iRec].iIndex;
+		event.iId       = m_pRecs[iRec].iSym;
+		event.fScore    = m_pRecs[iNext].dScore - m_pRecs[iRec].dScore;
+		_pEvent(_pArg, event);
+
+		/// the committed record can be still reached by an alternative, it is its end
+		m_pRecs[iRec].iPrev = NONE; m_pRecs[iRec].iAlt = NONE; m_pRecs[iRec].iSym = EPS_SYM;
+	}
+
+	/// the older records are not reachable anymore
+	m_pRecs[_iRec].iPrev = NONE; m_pRecs[_iRec].iAlt = NONE;
+	m_iCommitted = m_pRecs[_iRec].iIndex;
 }
 
-void CTokenPool::ret(CToken *_p)
+unsigned int CTraceArena::select(unsigned int _iList, double _dBest, unsigned int _iSym, float _fBeam, unsigned int _iMax, unsigned int _iTail)
 {
-  ///temporaty variable to go through all token that this token is referring to
-	CToken *tmp = NULL;
-  /// decrease usage of this token as want to delete it
-	if(_p) _p->iUsage--;
-
-  /// if the usage of this token is zero after decresing means that,
-  /// no other token is referring to this one...
-  /// we will go through the references of the tokens and remove one by one
-	while(_p && _p->iUsage == 0)
+	unsigned int i, n, iHead = _iTail, *piLast = &iHead;
+	float fLimit = FLT_MAX;
+
+	/// the differences of the alternatives that can be kept, those out of the beam are marked as the same symbol
+	m_select.clear();
+	for(i=_iList;i!=NONE;i=m_pRecs[i].iAlt)
 	{
-    /// return the tokens into linked list
-		tmp = _p->pPrev; _p->pPrev = m_pEls;
-		m_pEls = _p; _p = tmp;
-    /// go to next and decrease its usage.
-		if(_p) _p->iUsage--;
+		if(m_pRecs[i].dScore < _dBest - _fBeam) m_pRecs[i].iSym = _iSym;
+		m_pRecs[i].dScore = (float)(_dBest - m_pRecs[i].dScore);
+		if(m_pRecs[i].iSym != _iSym) m_select.push_back(m_pRecs[i].dScore);
+	}
+	if(m_select.empty()) return _iTail;
+
+	/// the difference of the worst one of the best alternatives
+	if(m_select.size() > _iMax)
+	{
+		std::nth_element(m_select.begin(), m_select.begin() + (_iMax - 1), m_select.end());
+		fLimit = m_select[_iMax - 1];
+	}
+
+	/// the kept ones stay in the same order, they still refer to the older records only
+	for(i=_iList, n=0;i!=NONE && n<_iMax;i=m_pRecs[i].iAlt)
+	{
+		if(m_pRecs[i].iSym == _iSym || m_pRecs[i].dScore > fLimit) continue;
+		*piLast = i; piLast = &m_pRecs[i].iAlt; n++;
+	}
+	*piLast = _iTail;
+
+	return iHead;
+}
+
+unsigned int CTraceArena::cut(unsigned int _iRec)
+{
+	/// the committed records and the records before them are not part of the lattice
+	if(_iRec == NONE || m_pRecs[_iRec].iSym == EPS_SYM || m_pRecs[_iRec].iIndex < m_iCommitted) return NONE;
+	return _iRec;
+}
+
+void CTraceArena::nbest(unsigned int _iBest, unsigned int _iAlts, unsigned int _iMoreAlts, int64_t _iEnd, double _dScore, unsigned int _iN, CNBest &_nbest)
+{
+	/// partial path from the end, the record and the choice of it at the next record of the path (the previous entry),
+	/// the events after the record are hashed to the signature and the oldest one of them is kept
+	typedef struct { unsigned int iRec; unsigned int iNext; float fDelta; uint64_t iSig; unsigned int iFirst; } path_t;
+	typedef std::pair<float, unsigned int> item_t;
+	std::vector<path_t> paths;
+	std::priority_queue<item_t, std::vector<item_t>, std::greater<item_t> > queue;
+	std::unordered_set<uint64_t> seen;
+	CHypothesis hyp;
+	CResult event;
+	unsigned int i, e, n, iAlt, iLists[2] = {_iAlts, _iMoreAlts};
+	uint64_t iSig;
+	float fCost;
+	path_t path;
+
+	_nbest.clear();
+	if(!_iN) return;
+
+	/// the choices at the end
+	path.iNext = NONE; path.iSig = 14695981039346656037ULL; path.iFirst = EPS_SYM;
+	path.iRec = cut(_iBest); path.fDelta = 0; paths.push_back(path); queue.push(item_t(0, 0));
+	for(n=0;n<2;n++) for(iAlt=iLists[n];iAlt!=NONE;iAlt=m_pRecs[iAlt].iAlt)
+	{
+		path.iRec = cut(m_pRecs[iAlt].iPrev); path.fDelta = m_pRecs[iAlt].dScore;
+		queue.push(item_t(path.fDelta, paths.size())); paths.push_back(path);
+	}
+
+	/// the cheapest partial path is extended first, so the complete paths come from the best one
+	while(!queue.empty() && _nbest.size() < _iN)
+	{
+		fCost = queue.top().first; e = queue.top().second; queue.pop();
+
+		/// the path reaching the record with the same events after it as a better path can not make another sequence
+		/// of the events, the same symbol following itself is one event
+		path = paths[e];
+		iSig = path.iSig;
+		if(path.iRec != NONE && m_pRecs[path.iRec].iSym != path.iFirst) { path.iFirst = m_pRecs[path.iRec].iSym; iSig = (iSig ^ path.iFirst) * 1099511628211ULL; }
+		if(!seen.insert(iSig ^ ((uint64_t)path.iRec * 0x9E3779B97F4A7C15ULL)).second) continue;
+
+		/// extend the path by the previous record or by its alternatives
+		if(path.iRec != NONE)
+		{
+			if(paths.size() >= NBEST_PATHS) continue;
+			const CTraceRecord &rec = m_pRecs[path.iRec];
+			path.iNext = e; path.iSig = iSig;
+			path.iRec = cut(rec.iPrev); path.fDelta = 0; queue.push(item_t(fCost, paths.size())); paths.push_back(path);
+			for(iAlt=rec.iAlt;iAlt!=NONE;iAlt=m_pRecs[iAlt].iAlt)
+			{
+				path.iRec = cut(m_pRecs[iAlt].iPrev); path.fDelta = m_pRecs[iAlt].dScore;
+				queue.push(item_t(fCost + path.fDelta, paths.size())); paths.push_back(path);
+			}
+			continue;
+		}
+
+		/// the complete path, its events from the oldest one
+		hyp.events.clear();
+		hyp.fScore = _dScore - fCost;
+		for(i=paths[e].iNext;i!=NONE;i=paths[i].iNext)
+		{
+			const CTraceRecord &rec = m_pRecs[paths[i].iRec];
+			n = paths[i].iNext;
+			event.iRevIndex = rec.iIndex;
+			event.iDur      = (n == NONE ? _iEnd : m_pRecs[paths[n].iRec].iIndex) - rec.iIndex;
+			event.iId       = rec.iSym;
+			event.fScore    = (n == NONE ? _dScore : m_pRecs[paths[n].iRec].dScore) - paths[i].fDelta - rec.dScore;
+
+			if(!hyp.events.empty() && hyp.events.back().iId == event.iId) { hyp.events.back().iDur += event.iDur; hyp.events.back().fScore += event.fScore; }
+			else hyp.events.push_back(event);
+		}
+
+		_nbest.push_back(hyp);
 	}
 }
@@ -17,26 +17,27 @@
  * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
  */
 
+
  /**
- *  This file contains the Token and Token Poll definition. Token is and object traveling
- * the search finite state transducer network. Token pool is preallocated memory, from which
- * tokens are created.
+ *  This file contains the Token and the Trace Arena definition. Token is the hypothesis traveling the search finite state
+ * transducer network. Trace arena is the preallocated memory of the records of the output symbols crossed by the tokens,
+ * from which the results are retrieved.
  */
 
 #ifndef __EAR_TOKEN_H_
 #define __EAR_TOKEN_H_
 
 #include <stdlib.h>
+#include <vector>
 #include "../Data/Data.h"
 
 namespace Ear
 {
     /**
-    * Token, an object traveling the finite state transducer search network. The token is holding curcial information
-    * about the search process and score. From the token at the end of decoding or in the process of the decoding
-    * a final or partial results respectively can be retrieved.
-    * The tokens in the network are refering to each other. Each time new input vector is consumed new copies of the current tokens
-    * are created. The new token are referring the older ones that have crossed non-empty output symbol on transition of the serch network
+    * Token, the hypothesis traveling the finite state transducer search network. The token is holding the position in the
+    * network and the score. The tokens are kept by value in the states of the search, each time new input vector is consumed
+    * new copies of the current tokens are created in the states of the next time. The path of the token is not kept in the token
+    * itself, only the last output symbol crossed by it, referring to the record in the trace arena (see <i>CTraceArena</i>).
     */
     class CToken
     {
@@ -46,9 +47,9 @@ namespace Ear
 
     public:
         unsigned int iPos;    ///< position of the token in the search network (index in the array of transitions marking the beginning of the transitions for particular state.)
-        unsigned int iSym;  ///< consumed output symbol from the search network transition
-        unsigned int iUsage; ///< number of references to this token by another tokens. If this drops to zero, the token is removed from the memory
-        CToken *pPrev;  ///< reference pointer to the previous non-empty (containing symbol) token
+        unsigned int iSym;  ///< output symbol crossed by the last transition of the token, EPS_SYM if the transition did not have any
+        unsigned int iTrace; ///< record of the last output symbol crossed on the path of the token (the own one if <i>iSym</i> is not empty), NONE for none
+        unsigned int iAlt; ///< alternatives of the path met since the last record (see <i>CTraceArena::select</i>), NONE for none
         int64_t iIndex; ///< time index of the token in number of feature vectors.
     private:
         float fMainScore; ///<
@@ -57,79 +58,174 @@ namespace Ear
 
     public:
         /// Reset the state of the token to default values
-        void reset(){iPos = START_STATE; iSym = EPS_SYM; iIndex = 0; fMainScore = 0; fAuxScore = 0; fNextMainScore = 0; pPrev = NULL; iUsage = 0;}
+        void reset(){iPos = START_STATE; iSym = EPS_SYM; iTrace = NONE; iAlt = NONE; iIndex = 0; fMainScore = 0; fAuxScore = 0; fNextMainScore = 0;}
+        /// Mark the token as not existent, used for the states of the search without token
+        void clear(){iPos = UNDEF_STATE;}
+        /// @return true if the token does not exist
+        inline bool isEmpty() const { return iPos == UNDEF_STATE; }
 
         inline void addAuxScore (float _fScore){ fAuxScore  += _fScore; }
         inline void addMainScore(float _fScore){ fMainScore += fNextMainScore; fNextMainScore = _fScore; }
 
-        inline float getMainScore()     { return fMainScore; }
-        inline float getScore()         { return fMainScore + fNextMainScore + fAuxScore; }
+        inline float getMainScore() const { return fMainScore; }
+        inline float getScore() const     { return fMainScore + fNextMainScore + fAuxScore; }
+        /// Subtract the offset from the score, all parts of the score are joined into the main one
+        /// @param [in] _fOffset the subtracted score (the best score of the current time)
+        inline void shift(float _fOffset){ fMainScore = getScore() - _fOffset; fNextMainScore = 0; fAuxScore = 0; }
 
-        /// initialize token with existent token. Copy the values of the token to this instance
+        /// initialize token with existent token. Copy the values of the token to this instance, the new token continues
+        /// the path of the existent one
         /// @param [in] _token the token from which copy the values
-        inline void initToken( CToken *_token )
+        inline void initToken( const CToken &_token )
         {
-            fMainScore = _token->fMainScore + _token->fNextMainScore;
-            fAuxScore  = _token->fAuxScore;
+            fMainScore = _token.fMainScore + _token.fNextMainScore;
+            fAuxScore  = _token.fAuxScore;
 
             fNextMainScore = 0;
+
+            iTrace = _token.iTrace; iAlt = _token.iAlt; iSym = EPS_SYM;
         }
     };
 
+    /**
+    * Record of the output symbol crossed by the token. The records are chained from the newest to the oldest one
+    * and this chain is the path of the token reported as the detected acoustic events.
+    *
+    * With the lattice, the record also refers to the alternatives of its previous record. Each alternative is a link record
+    * of the hypothesis dropped where it met the better one: its <i>iPrev</i> is the last record of the dropped hypothesis,
+    * <i>dScore</i> is how much worse it was, <i>iIndex</i> is the time where they met and <i>iAlt</i> is the next link.
+    */
+    class CTraceRecord
+    {
+    public:
+        unsigned int iSym; ///< the crossed output symbol
+        unsigned int iPrev; ///< record of the previous output symbol on the path, NONE for the first one
+        int64_t iIndex; ///< time index of the token crossing the symbol
+        double dScore; ///< score of the token crossing the symbol, including the offset of the renormalized scores of the tokens
+        unsigned int iAlt; ///< first link of the alternatives of the previous record, NONE for none
+    };
+
   /**
-  * Pool of tokens that were preallocated or allocated during search process. This is faster than allocating new tokens
-  * from operating system. The tokens are allocated by the inner holder class and chained for use. The reason behind this
-  * is simple. The holders are allocating the tokens in one go, while the pool have linked list of them. The deallocation
-  * is simple too. Dealocating the holders removes all the tokens, so no token will be forgotten in the memory. This prevents
-  * memory leaks.
+  * Arena of the trace records. The records are allocated one after another from one array (this is only increasing of the
+  * counter) and they are never released one by one. Instead the records not reachable from any token are removed at once
+  * by the garbage collection and the remaining ones are moved to the beginning of the array.
+  *
+  * The records always refer to the older ones, the collection is therefore generational. The records that survived
+  * a collection are old, they mostly belong to the paths of the tokens for a long time. Usually only the new records
+  * (the young generation) are collected, the old ones are collected only when their number grows twice since the last
+  * time. The collection is done in three steps by the owner of the tokens: <i>startCollect</i>, <i>mark</i> for each token
+  * and <i>compact</i>, after which the records of the tokens are changed to the ones returned by <i>moved</i>.
+  *
+  * The path shared by all tokens does not change anymore. Its events can be committed, so they are reported immediately
+  * and their records are removed by the next collections.
+  *
+  * The alternatives of the records (see <i>CTraceRecord</i>) make the trace the lattice of the hypotheses. They always
+  * refer to the older records too, so the same collection keeps them. The best paths of the lattice are found by
+  * <i>nbest</i>.
   */
-	class CTokenPool
+	class CTraceArena
 	{
+	public:
+		/// Function receiving the committed events
+		/// @param [in] _pArg argument given to <i>commit</i>
+		/// @param [in] _event the final event
+		typedef void (*Event)(void *_pArg, const CResult &_event);
 
 	private:
-    /**
-    * Holder of the tokens. Inner class of one time allocated resources. Holds token and it is also part of the
-    * linked list of the holders. Each time all tokens are used from the pool new tokens are allocated by creating
-    * new holder.
-    */
-		class CHolder
-		{
-		public:
-      /// Allocate new tokens.
-      /// @param [in] _iMax maximum tokens to create
-			CHolder(unsigned int _iMax);
-			~CHolder();
-
-		public:
-			unsigned int iMax; ///< remembering maximum number of tokens
-			CToken *pAllocs; ///< allocated tokens array
-			CHolder *pLink; ///< link to next token holder
-		};
-
-	private:
-		CToken *m_pEls; ///< Tokens allocated by the holders and created a linked list of them here (this are free tokens available to the search process)
-		CHolder *m_pHld;  ///< Linked list of the holders
-		unsigned int m_iNum; ///< NUmber of tokens created by the pool (increases each time new holder is created)
+		CTraceRecord *m_pRecs; ///< the records
+		unsigned int *m_piMap; ///< new indexes of the collected records, NONE for the unreachable ones
+		unsigned int m_iSize; ///< number of the used records
+		unsigned int m_iMax; ///< number of the allocated records
+		unsigned int m_iYoung; ///< number of the new records when the collection should be done
+		unsigned int m_iOld; ///< number of the old records (those that survived the last collection)
+		unsigned int m_iMajor; ///< number of the old records when they are collected too
+		unsigned int m_iFrom; ///< first record of the running collection
+		int64_t m_iCommitted; ///< time index of the first record not committed, the alternatives do not go before it
+		std::vector<unsigned int> m_stack; ///< alternatives waiting for the marking
+		std::vector<float> m_select; ///< differences of the alternatives waiting for the selection
 
 	public:
-    /// Creating token pool
-    /// @param [in] _iNum number of token to preallocate for one holder. Each time no more tokens are available the next specified number will be allocated.
-		CTokenPool(unsigned int _iNum);
-		~CTokenPool();
-    /// Take one token from the pool chaing with the provided one and return new initialized token.
-    /// This also increases the usage of the previous token for counting references. The new token has initial usage equal to one as we need it.
-    /// If we want to delete it we will decrease the usage later.
-    /// @param [in] _p previous token to link the new one
-    /// @return new allocated token take from the pool
-		CToken *add(CToken *_p);
-    /// Return token back to the pool. This also decreases the usage/reference of the previous token.
-    /// @param [in] _p token to return
-		void ret(CToken *_p);
+    /// Creating arena
+    /// @param [in] _iYoung number of the new records after which the collection should be done, twice as many records are preallocated
+		CTraceArena(unsigned int _iYoung);
+		~CTraceArena();
+    /// Add new record
+    /// @param [in] _iSym crossed output symbol
+    /// @param [in] _iPrev previous record on the path
+    /// @param [in] _iIndex time index of the token
+    /// @param [in] _dScore score of the token, including the offset of the renormalized scores
+    /// @param [in] _iAlt alternatives of the previous record (see <i>CTraceRecord</i>)
+    /// @return index of the new record, it is valid until the next collection
+		unsigned int add(unsigned int _iSym, unsigned int _iPrev, int64_t _iIndex, double _dScore, unsigned int _iAlt = NONE);
+    /// @param [in] _iRec index of the record
+    /// @return the record (the reference is valid until the next record is added)
+		inline const CTraceRecord &get(unsigned int _iRec){ return m_pRecs[_iRec]; }
+    /// @return true if there are enough new records to do the collection
+		inline bool isFull(){ return m_iSize - m_iOld > m_iYoung; }
+    /// @return number of the used records
+		inline unsigned int size(){ return m_iSize; }
+    /// Find the newest record on the paths of both records
+    /// @param [in] _iA the last record of one token
+    /// @param [in] _iB the last record of another token
+    /// @return the common record, NONE if the paths do not share any
+		unsigned int common(unsigned int _iA, unsigned int _iB);
+    /// Commit the path up to the record. The events of the older records are final, they are passed to the function
+    /// from the oldest one and the record becomes the first one of the path. No memory is allocated. The alternatives
+    /// going before the record are cut off.
+    /// @param [in] _iRec the newest record shared by all tokens
+    /// @param [in] _pEvent function receiving the final events
+    /// @param [in] _pArg argument of the function
+		void commit(unsigned int _iRec, Event _pEvent, void *_pArg);
+    /// Choose the alternatives of the hypothesis from those that met it in one state. They were added by <i>add</i> with the
+    /// last symbol, the last record and the score of each dropped hypothesis, chained by <i>iAlt</i>. Those with the same
+    /// last symbol as the best one or worse by more than the beam are left out, from the others at most the given number of
+    /// the best ones is kept. The differences of the scores are stored in the kept links and they are chained before the
+    /// alternatives the best hypothesis already had.
+    /// @param [in] _iList the newest link of the dropped hypotheses, NONE for none
+    /// @param [in] _dBest score of the best hypothesis, including the offset of the renormalized scores
+    /// @param [in] _iSym last symbol of the best hypothesis
+    /// @param [in] _fBeam the largest difference of the score
+    /// @param [in] _iMax the largest number of the alternatives kept
+    /// @param [in] _iTail alternatives the best hypothesis had so far
+    /// @return the first alternative of the best hypothesis
+		unsigned int select(unsigned int _iList, double _dBest, unsigned int _iSym, float _fBeam, unsigned int _iMax, unsigned int _iTail);
+    /// Find the best paths of the lattice ending by the hypothesis. The paths go back from the end by the previous records
+    /// or by their alternatives, the score of the path is lower by the differences of the chosen alternatives. The paths with
+    /// the same sequence of the events as a better one are left out.
+    /// @param [in] _iBest the last record of the hypothesis, NONE for none
+    /// @param [in] _iAlts the alternatives of the last record, NONE for none
+    /// @param [in] _iMoreAlts more alternatives of the last record, NONE for none
+    /// @param [in] _iEnd time index of the end of the last event
+    /// @param [in] _dScore score of the hypothesis, including the offset of the renormalized scores
+    /// @param [in] _iN the largest number of the paths
+    /// @param [out] _nbest list of the paths, the best one first
+		void nbest(unsigned int _iBest, unsigned int _iAlts, unsigned int _iMoreAlts, int64_t _iEnd, double _dScore, unsigned int _iN, CNBest &_nbest);
+    /// Remove all records
+		void clear();
+    /// Write the records and the state of the collection to the snapshot
+    /// @param [in, out] _snap the snapshot
+		void save(CSnapshot &_snap);
+    /// Read the records written by <i>save</i>, the arrays grow if needed
+    /// @param [in, out] _snap the snapshot
+    /// @return EAR_FAIL if the snapshot was written by the arena of different collection interval
+		unsigned int restore(CSnapshot &_snap);
+    /// Start the collection, choose the generation to collect
+		void startCollect();
+    /// Mark the records on the path of the token and on the paths of its alternatives as reachable
+    /// @param [in] _iRec the last record of the token
+		void mark(unsigned int _iRec);
+    /// Remove the unmarked records of the collected generation, all remaining records become old
+		void compact();
+    /// @param [in] _iRec index of the record before the collection
+    /// @return index of the record after the collection
+		inline unsigned int moved(unsigned int _iRec){ return (_iRec == NONE || _iRec < m_iFrom) ? _iRec : m_piMap[_iRec - m_iFrom]; }
 
 	private:
-    /// Chaining tokens.
-		void chain(CToken *_p, unsigned int _iMax);
-		void allocate(unsigned int _iMax);
+    /// Allocate twice larger arrays when all records are used
+		void grow();
+    /// @param [in] _iRec index of the record reached by the path of the lattice
+    /// @return the record, NONE if it is committed or before the committed ones
+		unsigned int cut(unsigned int _iRec);
 	};
 }
 
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "WorkerPool.h"
+
+/// number of the checks for new job before the worker falls asleep
+#define WORKER_SPIN 20000
+
+using namespace Ear;
+
+CWorkerPool::CWorkerPool()
+{
+	m_iJob = 0; m_iBusy = 0;
+	m_bStop = false;
+	m_pJob = NULL; m_pArg = NULL;
+}
+
+CWorkerPool::~CWorkerPool()
+{
+	stop();
+}
+
+void CWorkerPool::start(unsigned int _iWorkers)
+{
+	unsigned int i;
+
+	stop();
+	m_bStop = false;
+	for(i=1;i<_iWorkers;i++) m_threads.push_back(std::thread(&CWorkerPool::loop, this, i, m_iJob.load()));
+}
+
+void CWorkerPool::stop()
+{
+	unsigned int i;
+
+	if(m_threads.empty()) return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_bStop = true;
+		m_iJob++;
+	}
+	m_wake.notify_all();
+
+	for(i=0;i<m_threads.size();i++) m_threads[i].join();
+	m_threads.clear();
+}
+
+void CWorkerPool::run(Job _pJob, void *_pArg)
+{
+	/// without the threads the job is simply called
+	if(m_threads.empty()) { _pJob(_pArg, 0); return; }
+
+	m_pJob = _pJob; m_pArg = _pArg;
+	m_iBusy = m_threads.size();
+
+	/// the job number is changed under the lock, so no sleeping worker misses the notification
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_iJob++;
+	}
+	m_wake.notify_all();
+
+	/// the calling thread is the worker 0
+	_pJob(_pArg, 0);
+
+	/// the others finish in about the same time, so they are waited for actively
+	while(m_iBusy.load(std::memory_order_acquire)) std::this_thread::yield();
+}
+
+void CWorkerPool::loop(unsigned int _iWorker, unsigned int _iJob)
+{
+	unsigned int iSeen = _iJob, i;
+
+	while(1)
+	{
+		/// wait for the next job, actively for a while and then asleep
+		for(i=0;i<WORKER_SPIN && m_iJob.load(std::memory_order_acquire) == iSeen;i++);
+		if(m_iJob.load(std::memory_order_acquire) == iSeen)
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+			m_wake.wait(lock, [&]{ return m_iJob.load() != iSeen; });
+		}
+
+		iSeen = m_iJob.load(std::memory_order_acquire);
+		if(m_bStop) return;
+
+		m_pJob(m_pArg, _iWorker);
+		m_iBusy.fetch_sub(1, std::memory_order_release);
+	}
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+ /**
+ *	Persistent pool of the worker threads for splitting the work of one feature vector.
+ */
+
+#ifndef __EAR_WORKERPOOL_H_
+#define __EAR_WORKERPOOL_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+
+namespace Ear
+{
+	/**
+	* Pool of the threads created once and reused for each job. The job is run by all workers at once (fork) and the caller
+	* waits until all of them finish it (join). The calling thread is the worker 0, so the pool of N workers has N - 1 threads.
+	* The workers spin for a while after each job before they fall asleep, so the jobs coming each frame are started without
+	* the wake up latency of the operating system.
+	*/
+	class CWorkerPool
+	{
+	public:
+		/// Function run by each worker
+		/// @param [in] _pArg argument given to <i>run</i>
+		/// @param [in] _iWorker index of the worker, from zero to the number of workers - 1
+		typedef void (*Job)(void *_pArg, unsigned int _iWorker);
+
+		CWorkerPool();
+		~CWorkerPool();
+
+	private:
+		std::vector<std::thread> m_threads; ///< threads of the workers 1 to N - 1
+		std::mutex m_lock; ///< lock for the sleeping workers
+		std::condition_variable m_wake; ///< notification of the sleeping workers about new job
+		std::atomic<unsigned int> m_iJob; ///< sequence number of the current job, increased to start the next one
+		std::atomic<unsigned int> m_iBusy; ///< number of the threads still running the current job
+		bool m_bStop; ///< the threads are finishing
+		Job m_pJob; ///< function of the current job
+		void *m_pArg; ///< argument of the current job
+
+	public:
+		/// Create the threads of the pool, the previous ones are finished first
+		/// @param [in] _iWorkers number of the workers including the calling thread (1 or 0 for no threads)
+		void start(unsigned int _iWorkers);
+		/// Finish all threads of the pool
+		void stop();
+		/// @return number of the workers including the calling thread
+		unsigned int size() {return m_threads.size() + 1;};
+		/// Run the job on all workers and wait until all of them finish it
+		/// @param [in] _pJob function to run
+		/// @param [in] _pArg argument of the function
+		void run(Job _pJob, void *_pArg);
+
+	private:
+		/// Main loop of the worker thread, waits for the jobs and runs them
+		/// @param [in] _iWorker index of the worker
+		/// @param [in] _iJob number of the last job before the thread was created
+		void loop(unsigned int _iWorker, unsigned int _iJob);
+	};
+}
+
+#endif
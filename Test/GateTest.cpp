@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2017 Technical University of Košice (author: Martin Lojka)
+ *
+ * This file is part of EAR-TUKE.
+ *
+ * EAR-TUKE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EAR-TUKE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EAR-TUKE. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "../Search/Search.h"
+#include "../Search/ActivityGate.h"
+
+using namespace Ear;
+
+/// Scorer giving each state a score derived from the first coefficient of the feature vector, so the score depends only
+/// on the vector and a vector replayed from the pre-roll is scored the same as when it is decoded directly
+class CTestScorer : public AScorer
+{
+	private:
+		unsigned int m_iValue;
+
+	public:
+		CTestScorer(){ m_iValue = 0; }
+		int set(CDataContainer *_pData){ m_iValue = (unsigned int)(*_pData)[0]; return EAR_SUCCESS; }
+		float getScore(unsigned int _iState)
+		{
+			unsigned int h = (m_iValue * 2654435761u) ^ (_iState * 40503u);
+			h ^= h >> 13; h *= 0x5bd1e995; h ^= h >> 15;
+			return -(float)(h % 10000) / 137.0f;
+		}
+		int setBlock(CDataContainer *_pData, unsigned int _iSize){ return EAR_SUCCESS; }
+		void selectFrame(unsigned int _iFrame){}
+};
+
+/// Network of three looping states, each state may pass into the others emitting its symbol or end the search
+static void buildNet(std::vector<EAR_FST_Trn> &_net)
+{
+	unsigned int s, t;
+	EAR_FST_Trn x;
+
+	for(s = 0; s < 3; s++)
+	{
+		x.iStart = s; x.iIn = s + 1; x.iEnd = s; x.iOut = 0; x.fWeight = 0.1f; _net.push_back(x);
+		for(t = 0; t < 3; t++) if(t != s)
+		{
+			x.iStart = s; x.iIn = t + 1; x.iEnd = t; x.iOut = t + 1; x.fWeight = 4.0f; _net.push_back(x);
+		}
+		x.iStart = s; x.iIn = 0; x.iEnd = END_STATE; x.iOut = 0; x.fWeight = 0.0f; _net.push_back(x);
+	}
+	/// the end states are positions of the first transitions of the states
+	for(s = 0; s < _net.size(); s++) if(_net[s].iEnd != END_STATE) _net[s].iEnd *= 4;
+}
+
+/// Decodes the frames with the given activity, without the gate if the pre-roll is negative
+static void decode(EAR_FST_Net *_pNet, unsigned int _iDense, const char *_pActivity, int _iPreRoll, CResults &_results)
+{
+	CTestScorer scorer;
+	CSearch search;
+	CActivityGate gate;
+	CDataContainer data;
+	int64_t i;
+
+	search.initialize(_pNet, &scorer, -10.0f, _iDense);
+	if(_iPreRoll >= 0) gate.initialize(&search, _iPreRoll);
+	data.resize(1);
+	for(i = 0; _pActivity[i]; i++)
+	{
+		data[0] = (float)(i % 97);
+		if(_iPreRoll >= 0) gate.process(data, i, _pActivity[i] == '1');
+		else search.process(data, i);
+	}
+	if(_iPreRoll >= 0) gate.flush();
+	search.flush();
+	search.getResults(_results);
+}
+
+static bool same(const CResults &_a, const CResults &_b)
+{
+	CResults::const_iterator i, j;
+
+	if(_a.size() != _b.size() || _a.empty()) return false;
+	for(i = _a.begin(), j = _b.begin(); i != _a.end(); i++, j++)
+		if(i->iRevIndex != j->iRevIndex || i->iDur != j->iDur || i->iId != j->iId || i->fScore != j->fScore) return false;
+	return true;
+}
+
+/// Checks that a gated run with the pre-roll matches the ungated run when the input is all active and when all the
+/// pauses are shorter than the pre-roll, for both the token and the dense search
+int main()
+{
+	std::vector<EAR_FST_Trn> trn;
+	EAR_FST_Net net;
+	std::string active, pauses;
+	unsigned int d, f;
+	int fail = 0;
+	CResults ref, gated;
+
+	buildNet(trn);
+	net.pNet = &trn[0]; net.iSize = trn.size();
+
+	active.assign(400, '1');
+	for(f = 0; f < 400; f++) pauses += (f % 80 >= 60 || (f >= 150 && f < 170)) ? '0' : '1';
+	pauses[399] = '1';
+
+	for(d = 0; d <= 256; d += 256)
+	{
+		decode(&net, d, active.c_str(), -1, ref);
+		decode(&net, d, active.c_str(), 50, gated);
+		if(!same(ref, gated)) { printf("FAIL: all active input, dense %u\n", d); fail++; }
+		gated.clear();
+		decode(&net, d, active.c_str(), 0, gated);
+		if(!same(ref, gated)) { printf("FAIL: all active input without pre-roll, dense %u\n", d); fail++; }
+		gated.clear();
+		decode(&net, d, pauses.c_str(), 50, gated);
+		if(!same(ref, gated)) { printf("FAIL: pauses shorter than the pre-roll, dense %u\n", d); fail++; }
+		ref.clear(); gated.clear();
+	}
+	printf(fail ? "gate test failed\n" : "gate test passed\n");
+	return fail ? 1 : 0;
+}